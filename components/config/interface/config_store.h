@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2021-2025, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -37,6 +37,9 @@ enum config_classifier
 	/* A classifier to describe a hardware feature's availability */
 	CONFIG_CLASSIFIER_HW_FEATURE,
 
+	/* A classifier for a numeric tuning parameter of the deployment */
+	CONFIG_CLASSIFIER_PARAMETER,
+
 	/* A classifier for an opaque configuration blob */
 	CONFIG_CLASSIFIER_BLOB
 };
@@ -1,6 +1,6 @@
 // SPDX-License-Identifier: BSD-3-Clause
 /*
- * Copyright (c) 2021-2024, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2021-2025, Arm Limited and Contributors. All rights reserved.
  */
 
 #include <common/fdt/fdt_helpers.h>
@@ -109,6 +109,40 @@ static bool load_blob(const struct ffa_name_value_pair_v1_0 *value_pair)
 	return true;
 }
 
+/*
+ * Add every u32 property of the node with the given compatible string to the config store
+ * under the property's name. A missing node isn't an error.
+ */
+static bool load_u32_properties(const void *fdt, int root, const char *compatible,
+				enum config_classifier classifier)
+{
+	const char *prop_name = NULL;
+	uint32_t prop_value = 0;
+	int prop_offset = 0;
+	int node = 0;
+
+	node = fdt_node_offset_by_compatible(fdt, root, compatible);
+	if (node < 0) {
+		DMSG("%s node not present in SP manifest", compatible);
+		return true;
+	}
+
+	fdt_for_each_property_offset(prop_offset, fdt, node) {
+		if (!dt_get_u32_by_offset(fdt, prop_offset, &prop_name, &prop_value)) {
+			/* skip other properties in the node, e.g. the compatible string */
+			DMSG("skipping non-u32 property '%s' in %s", prop_name, compatible);
+			continue;
+		}
+
+		if (!config_store_add(classifier, prop_name, 0, &prop_value, sizeof(prop_value))) {
+			EMSG("failed to add %s property to config store", compatible);
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static bool load_fdt(const void *fdt, size_t fdt_size)
 {
 	int root = -1, node = -1, subnode = -1, rc = -1;
@@ -263,28 +297,12 @@ static bool load_fdt(const void *fdt, size_t fdt_size)
 	}
 
 	/* Find hardware features */
-	node = fdt_node_offset_by_compatible(fdt, root, "arm,hw-features");
-	if (node >= 0) {
-		const char *prop_name = NULL;
-		uint32_t prop_value = 0;
-		int prop_offset = 0;
-
-		fdt_for_each_property_offset(prop_offset, fdt, node) {
-			if (!dt_get_u32_by_offset(fdt, prop_offset, &prop_name, &prop_value)) {
-				/* skip other properties in the node, e.g. the compatible string */
-				DMSG("skipping non-u32 property '%s' in hw-features", prop_name);
-				continue;
-			}
+	if (!load_u32_properties(fdt, root, "arm,hw-features", CONFIG_CLASSIFIER_HW_FEATURE))
+		return false;
 
-			if (!config_store_add(CONFIG_CLASSIFIER_HW_FEATURE, prop_name, 0,
-					      &prop_value, sizeof(prop_value))) {
-				EMSG("failed to add HW feature to config store");
-				return false;
-			}
-		}
-	} else {
-		DMSG("arm,hw-features node not present in SP manifest");
-	}
+	/* Find deployment specific tuning parameters */
+	if (!load_u32_properties(fdt, root, "arm,sp-parameters", CONFIG_CLASSIFIER_PARAMETER))
+		return false;
 
 	return true;
 }
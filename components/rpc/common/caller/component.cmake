@@ -14,10 +14,12 @@ target_include_directories(${TGT} PRIVATE
 
 set_property(TARGET ${TGT} APPEND PROPERTY PUBLIC_HEADER
 	"${CMAKE_CURRENT_LIST_DIR}/rpc_caller_session.h"
+	"${CMAKE_CURRENT_LIST_DIR}/rpc_caller_batch.h"
 	"${CMAKE_CURRENT_LIST_DIR}/rpc_caller.h"
 	)
 
 target_sources(${TGT} PRIVATE
 	"${CMAKE_CURRENT_LIST_DIR}/rpc_caller_session.c"
+	"${CMAKE_CURRENT_LIST_DIR}/rpc_caller_batch.c"
 	"${CMAKE_CURRENT_LIST_DIR}/rpc_caller.c"
 	)
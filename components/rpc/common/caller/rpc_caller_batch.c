@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "rpc_caller_batch.h"
+#include "protocols/rpc/common/packed-c/batch.h"
+#include <string.h>
+
+static size_t batch_align(size_t offset)
+{
+	return (offset + TS_RPC_BATCH_ALIGNMENT - 1) & ~((size_t)TS_RPC_BATCH_ALIGNMENT - 1);
+}
+
+rpc_status_t rpc_caller_batch_begin(struct rpc_caller_batch *batch,
+				    struct rpc_caller_session *session,
+				    size_t buffer_size)
+{
+	if (!batch || !session || buffer_size < sizeof(struct ts_rpc_batch_hdr))
+		return RPC_ERROR_INVALID_VALUE;
+
+	batch->handle = rpc_caller_session_begin(session, &batch->buffer, buffer_size,
+						 buffer_size);
+	if (!batch->handle)
+		return RPC_ERROR_INTERNAL;
+
+	batch->buffer_size = buffer_size;
+	batch->offset = sizeof(struct ts_rpc_batch_hdr);
+	batch->count = 0;
+	batch->index = 0;
+	batch->response_length = 0;
+	batch->is_invoked = false;
+
+	return RPC_SUCCESS;
+}
+
+uint8_t *rpc_caller_batch_add(struct rpc_caller_batch *batch, uint32_t opcode,
+			      size_t request_length)
+{
+	struct ts_rpc_batch_req_entry entry = { 0 };
+	size_t offset = 0;
+
+	if (!batch || !batch->handle || batch->is_invoked)
+		return NULL;
+
+	if (opcode > UINT16_MAX || opcode >= TS_RPC_OPCODE_RESERVED_BASE || request_length > UINT32_MAX)
+		return NULL;
+
+	offset = batch_align(batch->offset);
+	if (offset > batch->buffer_size ||
+	    batch->buffer_size - offset < sizeof(entry) ||
+	    batch->buffer_size - offset - sizeof(entry) < request_length)
+		return NULL;
+
+	entry.opcode = (uint16_t)opcode;
+	entry.param_len = (uint32_t)request_length;
+	memcpy(&batch->buffer[offset], &entry, sizeof(entry));
+
+	/* Padding is left unset, it is skipped by the service */
+	batch->offset = offset + sizeof(entry) + request_length;
+	batch->count++;
+
+	return &batch->buffer[offset + sizeof(entry)];
+}
+
+rpc_status_t rpc_caller_batch_invoke(struct rpc_caller_batch *batch)
+{
+	struct ts_rpc_batch_hdr hdr = { 0 };
+	uint8_t *response_buffer = NULL;
+	service_status_t service_status = 0;
+	rpc_status_t status = RPC_ERROR_INTERNAL;
+
+	if (!batch || !batch->handle || batch->is_invoked)
+		return RPC_ERROR_INVALID_STATE;
+
+	hdr.count = batch->count;
+	memcpy(batch->buffer, &hdr, sizeof(hdr));
+
+	/* Only send the part of the buffer that holds requests */
+	status = rpc_caller_session_set_request_length(batch->handle, batch->offset);
+	if (status)
+		return status;
+
+	batch->is_invoked = true;
+
+	status = rpc_caller_session_invoke(batch->handle, TS_RPC_OPCODE_BATCH, &response_buffer,
+					   &batch->response_length, &service_status);
+	if (status)
+		return status;
+
+	if (batch->response_length < sizeof(hdr))
+		return RPC_ERROR_INVALID_RESPONSE_BODY;
+
+	memcpy(&hdr, response_buffer, sizeof(hdr));
+	if (hdr.count > batch->count)
+		return RPC_ERROR_INVALID_RESPONSE_BODY;
+
+	batch->buffer = response_buffer;
+	batch->offset = sizeof(hdr);
+	batch->count = hdr.count;
+	batch->index = 0;
+
+	return RPC_SUCCESS;
+}
+
+rpc_status_t rpc_caller_batch_next_response(struct rpc_caller_batch *batch,
+					    rpc_status_t *rpc_status,
+					    service_status_t *service_status,
+					    uint8_t **response_buffer,
+					    size_t *response_length)
+{
+	struct ts_rpc_batch_resp_entry entry = { 0 };
+	size_t offset = 0;
+
+	if (!batch || !rpc_status || !service_status || !response_buffer || !response_length)
+		return RPC_ERROR_INVALID_VALUE;
+
+	if (!batch->is_invoked)
+		return RPC_ERROR_INVALID_STATE;
+
+	if (batch->index >= batch->count)
+		return RPC_ERROR_NOT_FOUND;
+
+	offset = batch_align(batch->offset);
+	if (offset > batch->response_length ||
+	    batch->response_length - offset < sizeof(entry))
+		return RPC_ERROR_INVALID_RESPONSE_BODY;
+
+	memcpy(&entry, &batch->buffer[offset], sizeof(entry));
+	offset += sizeof(entry);
+
+	if (entry.param_len > batch->response_length - offset)
+		return RPC_ERROR_INVALID_RESPONSE_BODY;
+
+	*rpc_status = entry.rpc_status;
+	*service_status = entry.service_status;
+	*response_buffer = entry.param_len ? &batch->buffer[offset] : NULL;
+	*response_length = entry.param_len;
+
+	batch->offset = offset + entry.param_len;
+	batch->index++;
+
+	return RPC_SUCCESS;
+}
+
+rpc_status_t rpc_caller_batch_end(struct rpc_caller_batch *batch)
+{
+	rpc_status_t status = RPC_ERROR_INTERNAL;
+
+	if (!batch || !batch->handle)
+		return RPC_ERROR_INVALID_VALUE;
+
+	status = rpc_caller_session_end(batch->handle);
+	if (status)
+		return status;
+
+	*batch = (struct rpc_caller_batch){ 0 };
+
+	return RPC_SUCCESS;
+}
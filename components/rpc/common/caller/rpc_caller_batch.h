@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RPC_CALLER_BATCH_H
+#define RPC_CALLER_BATCH_H
+
+#include "rpc_caller_session.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief RPC caller batch
+ *
+ * Builds a batch of independent requests to the service of a session and sends them in a
+ * single RPC call. Any service built on service_provider handles batches, the requests are
+ * serialized exactly as for individual calls. The requests are built in place in the
+ * shared memory of the session, the responses are read from it after the call.
+ */
+struct rpc_caller_batch {
+	/** Handle of the batch call */
+	rpc_call_handle handle;
+
+	/** Shared memory buffer of the call */
+	uint8_t *buffer;
+
+	/** Size of the buffer */
+	size_t buffer_size;
+
+	/** Number of bytes used by the requests or read from the response */
+	size_t offset;
+
+	/** Number of requests or responses in the buffer */
+	uint32_t count;
+
+	/** Number of responses read */
+	uint32_t index;
+
+	/** Length of the response */
+	size_t response_length;
+
+	/** Indicates if the batch has been invoked */
+	bool is_invoked;
+};
+
+/**
+ * @brief Begins a batch call
+ *
+ * The requests and the responses of the batch share a buffer of buffer_size bytes.
+ *
+ * @param batch Batch instance
+ * @param session Caller session instance
+ * @param buffer_size Size of the buffer for the requests and the responses
+ * @return RPC_CALLER_EXPORTED
+ */
+RPC_CALLER_EXPORTED
+rpc_status_t rpc_caller_batch_begin(struct rpc_caller_batch *batch,
+				    struct rpc_caller_session *session,
+				    size_t buffer_size);
+
+/**
+ * @brief Adds a request to the batch
+ *
+ * Returns the buffer where the service caller can build the request parameters.
+ *
+ * @param batch Batch instance
+ * @param opcode The opcode of the remote function
+ * @param request_length Length of the request parameters
+ * @return Request buffer or NULL if the request doesn't fit or the opcode is reserved
+ */
+RPC_CALLER_EXPORTED
+uint8_t *rpc_caller_batch_add(struct rpc_caller_batch *batch, uint32_t opcode,
+			      size_t request_length);
+
+/**
+ * @brief Invokes the batch call
+ *
+ * After this call the request buffers are not available for the service caller, the
+ * responses are read with rpc_caller_batch_next_response.
+ *
+ * @param batch Batch instance
+ * @return RPC_CALLER_EXPORTED
+ */
+RPC_CALLER_EXPORTED
+rpc_status_t rpc_caller_batch_invoke(struct rpc_caller_batch *batch);
+
+/**
+ * @brief Reads the response of the next request
+ *
+ * The responses are returned in the order of the requests. The service may return fewer
+ * responses than requests if the responses don't fit in the buffer, the remaining requests
+ * were not called.
+ *
+ * @param batch Batch instance
+ * @param rpc_status RPC status of the request
+ * @param service_status Service specific status code
+ * @param response_buffer Pointer of the response buffer
+ * @param response_length Length of the response buffer
+ * @return RPC_SUCCESS, or RPC_ERROR_NOT_FOUND if there are no more responses
+ */
+RPC_CALLER_EXPORTED
+rpc_status_t rpc_caller_batch_next_response(struct rpc_caller_batch *batch,
+					    rpc_status_t *rpc_status,
+					    service_status_t *service_status,
+					    uint8_t **response_buffer,
+					    size_t *response_length);
+
+/**
+ * @brief Ends the batch call
+ *
+ * @param batch Batch instance
+ * @return RPC_CALLER_EXPORTED
+ */
+RPC_CALLER_EXPORTED
+rpc_status_t rpc_caller_batch_end(struct rpc_caller_batch *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RPC_CALLER_BATCH_H */
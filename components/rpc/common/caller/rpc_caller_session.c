@@ -8,6 +8,105 @@
 #include "util.h"
 #include <string.h>
 
+/* Size of the smallest buffers of the pool class */
+static size_t pool_class_size(unsigned int pool_class)
+{
+	return (size_t)RPC_CALLER_SESSION_POOL_MIN_SIZE << pool_class;
+}
+
+/* Takes a buffer of at least length bytes from the pool or creates one */
+static rpc_status_t pool_get(struct rpc_caller_session *session, size_t length,
+			     struct rpc_caller_shared_memory *shared_memory)
+{
+	struct rpc_caller_session_pool *pool = &session->pool;
+	unsigned int pool_class = 0;
+
+	/* Zero length calls don't need shared memory from the pool */
+	if (length) {
+		while (pool_class < RPC_CALLER_SESSION_POOL_CLASSES &&
+		       pool_class_size(pool_class) < length)
+			pool_class++;
+	} else {
+		pool_class = RPC_CALLER_SESSION_POOL_CLASSES;
+	}
+
+	/* Calls larger than the largest class bypass the pool */
+	if (pool_class >= RPC_CALLER_SESSION_POOL_CLASSES) {
+		pool->stats.misses++;
+		return rpc_caller_create_shared_memory(session->caller, length, shared_memory);
+	}
+
+	/* A buffer of a larger class is still better than creating a new one */
+	for (unsigned int i = pool_class; i < RPC_CALLER_SESSION_POOL_CLASSES; i++) {
+		if (pool->buffers[i].buffer) {
+			*shared_memory = pool->buffers[i];
+			pool->buffers[i] = (struct rpc_caller_shared_memory){ 0 };
+			pool->stats.held_bytes -= shared_memory->size;
+			pool->stats.hits++;
+
+			return RPC_SUCCESS;
+		}
+	}
+
+	pool->stats.misses++;
+
+	return rpc_caller_create_shared_memory(session->caller, pool_class_size(pool_class),
+					       shared_memory);
+}
+
+/* Returns the buffer to the pool or releases it if the pool can't hold it */
+static rpc_status_t pool_put(struct rpc_caller_session *session,
+			     struct rpc_caller_shared_memory *shared_memory)
+{
+	struct rpc_caller_session_pool *pool = &session->pool;
+	unsigned int pool_class = 0;
+
+	if (!shared_memory->buffer || shared_memory->size < RPC_CALLER_SESSION_POOL_MIN_SIZE ||
+	    shared_memory->size >= pool_class_size(RPC_CALLER_SESSION_POOL_CLASSES))
+		return rpc_caller_release_shared_memory(session->caller, shared_memory);
+
+	/* The implementation may have rounded up the size, use the largest class it fits */
+	while (pool_class + 1 < RPC_CALLER_SESSION_POOL_CLASSES &&
+	       pool_class_size(pool_class + 1) <= shared_memory->size)
+		pool_class++;
+
+	if (pool->buffers[pool_class].buffer ||
+	    pool->stats.held_bytes + shared_memory->size > RPC_CALLER_SESSION_POOL_CAP) {
+		pool->stats.evictions++;
+		return rpc_caller_release_shared_memory(session->caller, shared_memory);
+	}
+
+	pool->buffers[pool_class] = *shared_memory;
+	pool->stats.held_bytes += shared_memory->size;
+	if (pool->stats.held_bytes > pool->stats.high_water_mark)
+		pool->stats.high_water_mark = pool->stats.held_bytes;
+
+	return RPC_SUCCESS;
+}
+
+static rpc_status_t pool_release_all(struct rpc_caller_session *session)
+{
+	struct rpc_caller_session_pool *pool = &session->pool;
+
+	for (unsigned int i = 0; i < RPC_CALLER_SESSION_POOL_CLASSES; i++) {
+		if (pool->buffers[i].buffer) {
+			rpc_status_t status = RPC_ERROR_INTERNAL;
+			size_t size = pool->buffers[i].size;
+
+			/* Releasing the memory clears the descriptor, including its size */
+			status = rpc_caller_release_shared_memory(session->caller,
+								  &pool->buffers[i]);
+			if (status)
+				return status;
+
+			pool->stats.held_bytes -= size;
+			pool->buffers[i] = (struct rpc_caller_shared_memory){ 0 };
+		}
+	}
+
+	return RPC_SUCCESS;
+}
+
 static rpc_status_t initalize_shared_memory(struct rpc_caller_session *session,
 					    struct rpc_caller_interface *caller,
 					    size_t shared_memory_size)
@@ -28,6 +127,8 @@ static rpc_status_t initalize_shared_memory(struct rpc_caller_session *session,
 		session->shared_memory_policy = alloc_for_each_call;
 	}
 
+	session->pool = (struct rpc_caller_session_pool){ 0 };
+
 	return RPC_SUCCESS;
 }
 
@@ -97,6 +198,12 @@ rpc_status_t rpc_caller_session_close(struct rpc_caller_session *session)
 							      &session->shared_memory);
 		if (rpc_status != RPC_SUCCESS)
 			return rpc_status;
+	} else {
+		rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+
+		rpc_status = pool_release_all(session);
+		if (rpc_status != RPC_SUCCESS)
+			return rpc_status;
 	}
 
 	return rpc_caller_close_session(session->caller);
@@ -120,8 +227,7 @@ rpc_call_handle rpc_caller_session_begin(struct rpc_caller_session *session,
 		if (session->shared_memory.buffer || session->shared_memory.size)
 			return NULL; /* There's already a shared memory */
 
-		status = rpc_caller_create_shared_memory(session->caller, required_buffer_length,
-							 &session->shared_memory);
+		status = pool_get(session, required_buffer_length, &session->shared_memory);
 		if (status)
 			return NULL; /* Failed to create shared memory */
 		break;
@@ -147,6 +253,25 @@ rpc_call_handle rpc_caller_session_begin(struct rpc_caller_session *session,
 	return (rpc_call_handle)session;
 }
 
+rpc_status_t rpc_caller_session_set_request_length(rpc_call_handle handle,
+						   size_t request_length)
+{
+	struct rpc_caller_session *session = (struct rpc_caller_session *)handle;
+
+	if (!handle)
+		return RPC_ERROR_INVALID_VALUE;
+
+	if (!session->is_call_transaction_in_progress)
+		return RPC_ERROR_INVALID_STATE;
+
+	if (request_length > session->shared_memory.size)
+		return RPC_ERROR_INVALID_VALUE;
+
+	session->request_length = request_length;
+
+	return RPC_SUCCESS;
+}
+
 rpc_status_t rpc_caller_session_invoke(rpc_call_handle handle, uint32_t opcode,
 				       uint8_t **response_buffer, size_t *response_length,
 				       service_status_t *service_status)
@@ -194,8 +319,7 @@ rpc_status_t rpc_caller_session_end(rpc_call_handle handle)
 
 	switch (session->shared_memory_policy) {
 	case alloc_for_each_call:
-		status = rpc_caller_release_shared_memory(session->caller,
-								&session->shared_memory);
+		status = pool_put(session, &session->shared_memory);
 		if (status)
 			return status; /* Failed to release shared memory */
 
@@ -215,3 +339,14 @@ rpc_status_t rpc_caller_session_end(rpc_call_handle handle)
 
 	return RPC_SUCCESS;
 }
+
+rpc_status_t rpc_caller_session_get_pool_stats(const struct rpc_caller_session *session,
+					       struct rpc_caller_session_pool_stats *stats)
+{
+	if (!session || !stats)
+		return RPC_ERROR_INVALID_VALUE;
+
+	*stats = session->pool.stats;
+
+	return RPC_SUCCESS;
+}
@@ -25,6 +25,57 @@ enum rpc_caller_memory_policy {
 	alloc_for_session,
 };
 
+/**
+ * With the alloc_for_each_call policy the shared memory of finished calls is kept in a pool
+ * of the session and reused by later calls instead of being released. The pool has a size
+ * class for each power of two from RPC_CALLER_SESSION_POOL_MIN_SIZE and holds at most one
+ * buffer per class. Calls that need more than the largest class allocate and release their
+ * shared memory as before. These may be overridden to meet the needs of a particular
+ * deployment, an RPC_CALLER_SESSION_POOL_CAP of zero disables the pool.
+ */
+#ifndef RPC_CALLER_SESSION_POOL_MIN_SIZE
+#define RPC_CALLER_SESSION_POOL_MIN_SIZE	(4096)
+#endif
+
+#ifndef RPC_CALLER_SESSION_POOL_CLASSES
+#define RPC_CALLER_SESSION_POOL_CLASSES		(5)
+#endif
+
+/** Maximal number of bytes the pool holds while no call is in progress */
+#ifndef RPC_CALLER_SESSION_POOL_CAP
+#define RPC_CALLER_SESSION_POOL_CAP		(64 * 1024)
+#endif
+
+/**
+ * @brief Statistics of the shared memory pool of a session
+ */
+struct rpc_caller_session_pool_stats {
+	/** Calls served by a buffer of the pool */
+	uint64_t hits;
+
+	/** Calls that created shared memory */
+	uint64_t misses;
+
+	/** Buffers released at the end of a call because the pool couldn't hold them */
+	uint64_t evictions;
+
+	/** Number of bytes currently held by the pool */
+	size_t held_bytes;
+
+	/** Highest number of bytes held by the pool */
+	size_t high_water_mark;
+};
+
+/**
+ * @brief Shared memory pool of a session
+ */
+struct rpc_caller_session_pool {
+	/** Free buffers, the buffer of class n holds at least RPC_CALLER_SESSION_POOL_MIN_SIZE << n bytes */
+	struct rpc_caller_shared_memory buffers[RPC_CALLER_SESSION_POOL_CLASSES];
+
+	struct rpc_caller_session_pool_stats stats;
+};
+
 /**
  * @brief RPC caller session
  *
@@ -52,6 +103,9 @@ struct rpc_caller_session {
 	 * function and then used in the invoke step.
 	 */
 	size_t request_length;
+
+	/** Reusable shared memory of the alloc_for_each_call policy */
+	struct rpc_caller_session_pool pool;
 };
 
 /**
@@ -112,6 +166,21 @@ rpc_call_handle rpc_caller_session_begin(struct rpc_caller_session *session,
 					 size_t request_length,
 					 size_t response_max_length);
 
+/**
+ * @brief Sets the length of the request
+ *
+ * Changes the request length given to rpc_caller_session_begin, for callers that only know the
+ * final length after writing the request, e.g. while packing a batch. The request must still fit
+ * in the buffer returned by rpc_caller_session_begin.
+ *
+ * @param handle RPC call handle
+ * @param request_length The new length of the request
+ * @return RPC_CALLER_EXPORTED
+ */
+RPC_CALLER_EXPORTED
+rpc_status_t rpc_caller_session_set_request_length(rpc_call_handle handle,
+						   size_t request_length);
+
 /**
  * @brief Invoke phase of the RPC call
  *
@@ -144,6 +213,16 @@ rpc_status_t rpc_caller_session_invoke(rpc_call_handle handle, uint32_t opcode,
 RPC_CALLER_EXPORTED
 rpc_status_t rpc_caller_session_end(rpc_call_handle handle);
 
+/**
+ * @brief Gets the statistics of the shared memory pool of the session
+ *
+ * @param session Caller session instance
+ * @param stats Statistics of the pool
+ * @return RPC_CALLER_EXPORTED
+ */
+RPC_CALLER_EXPORTED
+rpc_status_t rpc_caller_session_get_pool_stats(const struct rpc_caller_session *session,
+					       struct rpc_caller_session_pool_stats *stats);
 
 #ifdef __cplusplus
 }
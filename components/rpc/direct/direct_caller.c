@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2020-2025, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -23,10 +23,11 @@ static uint16_t allocate_caller_endpoint_id(void)
 	/*
 	 * By default, each caller is assigned a unique ID to represent
 	 * callers operating from different security domains. This may be
-	 * overridden after initialization if necessary.
+	 * overridden after initialization if necessary. Sessions may be opened
+	 * from several threads.
 	 */
 	static uint32_t next_caller_id = DIRECT_CALLER_BASE_DEFAULT_ID;
-	uint32_t assigned_id = next_caller_id++;
+	uint32_t assigned_id = __atomic_fetch_add(&next_caller_id, 1, __ATOMIC_RELAXED);
 	return assigned_id;
 }
 
@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ */
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTestExt/MockSupport.h>
+#include <string.h>
+#include "mock_sp_discovery.h"
+#include "mock_sp_memory_management.h"
+#include "../ts_rpc_endpoint_sp.h"
+
+static const uint16_t own_id = 0x8000;
+static const uint16_t owner_id = 0x8001;
+
+/*
+ * With four slots the hash table has eight entries. The home entry of the handles 5, 16 and 21
+ * is the last one, the home entry of handle 6 is the first one for owner_id.
+ */
+static const uint64_t handle_a = 5;
+static const uint64_t handle_b = 16;
+static const uint64_t handle_c = 6;
+static const uint64_t handle_d = 21;
+
+static void *memory_address(uint64_t handle)
+{
+	return (void *)(uintptr_t)(0x10000000 + handle * FFA_MEM_TRANSACTION_PAGE_SIZE);
+}
+
+static rpc_status_t service_receive(void *context, struct rpc_request *request)
+{
+	*(void **)context = request->request.data;
+	request->service_status = 0;
+
+	return RPC_SUCCESS;
+}
+
+TEST_GROUP(ts_rpc_endpoint_sp)
+{
+	TEST_SETUP()
+	{
+		const uint16_t major = FFA_VERSION_MAJOR;
+		const uint16_t minor = FFA_VERSION_MINOR;
+
+		memset(&endpoint, 0x00, sizeof(endpoint));
+		memset(&service, 0x00, sizeof(service));
+		received_data = NULL;
+
+		expect_sp_discovery_ffa_version_get(&major, &minor, SP_RESULT_OK);
+		expect_sp_discovery_own_id_get(&own_id, SP_RESULT_OK);
+		LONGS_EQUAL(RPC_SUCCESS, ts_rpc_endpoint_sp_init(&endpoint, 1, 4));
+		UNSIGNED_LONGS_EQUAL(8, endpoint.shared_memory_table_size);
+
+		service.context = &received_data;
+		service.receive = service_receive;
+		LONGS_EQUAL(RPC_SUCCESS, ts_rpc_endpoint_sp_add_service(&endpoint, &service));
+	}
+
+	TEST_TEARDOWN()
+	{
+		LONGS_EQUAL(RPC_SUCCESS, ts_rpc_endpoint_sp_deinit(&endpoint));
+
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	rpc_status_t management_call(uint16_t opcode, uint64_t handle)
+	{
+		struct sp_msg request = { };
+		struct sp_msg response = { };
+
+		request.source_id = owner_id;
+		request.destination_id = own_id;
+		ts_rpc_abi_set_management_interface_id(request.args.args32);
+		ts_rpc_abi_set_opcode(request.args.args32, opcode);
+		ts_rpc_abi_set_memory_handle(request.args.args32, handle);
+
+		ts_rpc_endpoint_sp_receive(&endpoint, &request, &response);
+
+		return (rpc_status_t)ts_rpc_abi_get_rpc_status(response.args.args32);
+	}
+
+	/* The mocks compare the parameters at the actual call, they must outlive the expectation */
+	void expect_retrieve(uint64_t handle)
+	{
+		memset(&desc, 0x00, sizeof(desc));
+		memset(&acc_desc, 0x00, sizeof(acc_desc));
+		memset(&region, 0x00, sizeof(region));
+
+		desc.sender_id = owner_id;
+		desc.memory_type = sp_memory_type_not_specified;
+		desc.flags.transaction_type = sp_memory_transaction_type_share;
+		acc_desc.receiver_id = own_id;
+		acc_desc.data_access = sp_data_access_read_write;
+
+		region.address = memory_address(handle);
+		region.page_count = 1;
+		out_region_count = 1;
+
+		expect_sp_memory_retrieve(&desc, &acc_desc, &acc_desc, &region, &region, 0,
+					  &out_region_count, handle, SP_RESULT_OK);
+	}
+
+	void retrieve(uint64_t handle)
+	{
+		expect_retrieve(handle);
+		LONGS_EQUAL(RPC_SUCCESS,
+			    management_call(TS_RPC_ABI_MANAGEMENT_OPCODE_MEMORY_RETRIEVE, handle));
+	}
+
+	void expect_relinquish(uint64_t handle)
+	{
+		memset(&flags, 0x00, sizeof(flags));
+		expect_sp_memory_relinquish(handle, &own_id, 1, &flags, SP_RESULT_OK);
+	}
+
+	void relinquish(uint64_t handle)
+	{
+		expect_relinquish(handle);
+		LONGS_EQUAL(RPC_SUCCESS,
+			    management_call(TS_RPC_ABI_MANAGEMENT_OPCODE_MEMORY_RELINQUISH, handle));
+	}
+
+	rpc_status_t service_call(uint64_t handle)
+	{
+		struct sp_msg request = { };
+		struct sp_msg response = { };
+
+		received_data = NULL;
+
+		request.source_id = owner_id;
+		request.destination_id = own_id;
+		ts_rpc_abi_set_interface_id(request.args.args32, 0);
+		ts_rpc_abi_set_memory_handle(request.args.args32, handle);
+		ts_rpc_abi_set_request_length(request.args.args32, 0);
+
+		ts_rpc_endpoint_sp_receive(&endpoint, &request, &response);
+
+		return (rpc_status_t)ts_rpc_abi_get_rpc_status(response.args.args32);
+	}
+
+	void check_lookup(uint64_t handle)
+	{
+		LONGS_EQUAL(RPC_SUCCESS, service_call(handle));
+		POINTERS_EQUAL(memory_address(handle), received_data);
+	}
+
+	void check_entry(size_t index, uint64_t handle)
+	{
+		CHECK_TRUE(endpoint.shared_memories[index].used);
+		UNSIGNED_LONGS_EQUAL(handle, endpoint.shared_memories[index].handle);
+	}
+
+	struct ts_rpc_endpoint_sp endpoint;
+	struct rpc_service_interface service;
+	struct sp_memory_descriptor desc;
+	struct sp_memory_access_descriptor acc_desc;
+	struct sp_memory_transaction_flags flags;
+	struct sp_memory_region region;
+	uint32_t out_region_count;
+	void *received_data;
+};
+
+TEST(ts_rpc_endpoint_sp, insertAndLookup)
+{
+	retrieve(handle_a);
+	retrieve(handle_c);
+	UNSIGNED_LONGS_EQUAL(2, endpoint.shared_memory_used);
+
+	check_lookup(handle_a);
+	check_lookup(handle_c);
+	LONGS_EQUAL(RPC_ERROR_NOT_FOUND, service_call(handle_b));
+
+	relinquish(handle_a);
+	LONGS_EQUAL(RPC_ERROR_NOT_FOUND, service_call(handle_a));
+	check_lookup(handle_c);
+
+	relinquish(handle_c);
+	UNSIGNED_LONGS_EQUAL(0, endpoint.shared_memory_used);
+	LONGS_EQUAL(RPC_ERROR_NOT_FOUND,
+		    management_call(TS_RPC_ABI_MANAGEMENT_OPCODE_MEMORY_RELINQUISH, handle_c));
+}
+
+TEST(ts_rpc_endpoint_sp, repeatedRetrieve)
+{
+	/* Every retrieve request reaches the SPMC and needs its own relinquish */
+	retrieve(handle_a);
+	retrieve(handle_a);
+	UNSIGNED_LONGS_EQUAL(1, endpoint.shared_memory_used);
+
+	relinquish(handle_a);
+	check_lookup(handle_a);
+
+	relinquish(handle_a);
+	LONGS_EQUAL(RPC_ERROR_NOT_FOUND, service_call(handle_a));
+	UNSIGNED_LONGS_EQUAL(0, endpoint.shared_memory_used);
+}
+
+TEST(ts_rpc_endpoint_sp, growthAndLimit)
+{
+	LONGS_EQUAL(RPC_ERROR_INVALID_VALUE,
+		    ts_rpc_endpoint_sp_configure_shared_memory(&endpoint, 3));
+	LONGS_EQUAL(RPC_SUCCESS, ts_rpc_endpoint_sp_configure_shared_memory(&endpoint, 5));
+
+	for (uint64_t handle = 1; handle <= 5; handle++)
+		retrieve(handle);
+
+	UNSIGNED_LONGS_EQUAL(5, endpoint.shared_memory_count);
+	UNSIGNED_LONGS_EQUAL(16, endpoint.shared_memory_table_size);
+
+	/* The limit is reached, the memory isn't retrieved from the SPMC */
+	LONGS_EQUAL(RPC_ERROR_NOT_FOUND,
+		    management_call(TS_RPC_ABI_MANAGEMENT_OPCODE_MEMORY_RETRIEVE, 6));
+
+	for (uint64_t handle = 1; handle <= 5; handle++)
+		check_lookup(handle);
+
+	for (uint64_t handle = 1; handle <= 5; handle++)
+		relinquish(handle);
+}
+
+TEST(ts_rpc_endpoint_sp, deleteWraparound)
+{
+	retrieve(handle_a);
+	retrieve(handle_b);
+	retrieve(handle_c);
+
+	/* handle_b wraps around to the first entry and pushes handle_c out of its home entry */
+	check_entry(7, handle_a);
+	check_entry(0, handle_b);
+	check_entry(1, handle_c);
+
+	/* Both entries of the probe sequence move back across the end of the table */
+	relinquish(handle_a);
+	check_entry(7, handle_b);
+	check_entry(0, handle_c);
+	CHECK_FALSE(endpoint.shared_memories[1].used);
+
+	LONGS_EQUAL(RPC_ERROR_NOT_FOUND, service_call(handle_a));
+	check_lookup(handle_b);
+	check_lookup(handle_c);
+
+	retrieve(handle_d);
+	check_entry(1, handle_d);
+
+	/* handle_c is in its home entry and stays, handle_d moves into the hole */
+	relinquish(handle_b);
+	check_entry(7, handle_d);
+	check_entry(0, handle_c);
+	CHECK_FALSE(endpoint.shared_memories[1].used);
+
+	check_lookup(handle_c);
+	check_lookup(handle_d);
+
+	relinquish(handle_c);
+	relinquish(handle_d);
+	UNSIGNED_LONGS_EQUAL(0, endpoint.shared_memory_used);
+}
+
+TEST(ts_rpc_endpoint_sp, deinitRelinquishesMemories)
+{
+	retrieve(handle_a);
+	retrieve(handle_a);
+	retrieve(handle_b);
+
+	expect_relinquish(handle_a);
+	expect_relinquish(handle_a);
+	expect_relinquish(handle_b);
+	LONGS_EQUAL(RPC_SUCCESS, ts_rpc_endpoint_sp_deinit(&endpoint));
+}
@@ -0,0 +1,40 @@
+#
+# Copyright (c) 2025, Arm Limited. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+
+include(UnitTest)
+
+unit_test_add_suite(
+	NAME ts_rpc_endpoint_sp
+	SOURCES
+		${CMAKE_CURRENT_LIST_DIR}/ts_rpc_endpoint_sp.c
+		${CMAKE_CURRENT_LIST_DIR}/test/test_ts_rpc_endpoint_sp.cpp
+		${UNIT_TEST_PROJECT_PATH}/components/rpc/ts_rpc/common/ts_rpc_abi.c
+		${UNIT_TEST_PROJECT_PATH}/components/rpc/common/endpoint/rpc_service_interface.c
+		${UNIT_TEST_PROJECT_PATH}/components/rpc/common/interface/rpc_uuid.c
+		${UNIT_TEST_PROJECT_PATH}/components/messaging/ffa/libsp/mock/mock_sp_discovery.cpp
+		${UNIT_TEST_PROJECT_PATH}/components/messaging/ffa/libsp/mock/mock_sp_memory_management.cpp
+	INCLUDE_DIRECTORIES
+		${UNIT_TEST_PROJECT_PATH}
+		${UNIT_TEST_PROJECT_PATH}/components/common/utils/include
+		${UNIT_TEST_PROJECT_PATH}/components/messaging/ffa/libsp/include
+		${UNIT_TEST_PROJECT_PATH}/components/messaging/ffa/libsp/mock
+		${UNIT_TEST_PROJECT_PATH}/components/rpc/common/interface
+		${UNIT_TEST_PROJECT_PATH}/components/rpc/common/endpoint
+	COMPILE_DEFINITIONS
+		-DARM64
+		-DCFG_FFA_VERSION=0x00010001
+)
+
+target_compile_definitions(ts_rpc_endpoint_sp PRIVATE
+	"TRACE_PREFIX=UT"
+	"TRACE_LEVEL=0"
+)
+
+add_components(TARGET ts_rpc_endpoint_sp
+	BASE_DIR ${TS_ROOT}
+	COMPONENTS
+		"components/common/trace"
+)
@@ -15,50 +15,125 @@ static const struct ts_rpc_shared_memory null_shared_memory = {
 	.owner_id = 0xffff, .handle = FFA_MEM_HANDLE_INVALID, .data = NULL, .size = 0, .used = true
 };
 
-static struct ts_rpc_shared_memory *find_free_shared_memory_descriptor(
-	struct ts_rpc_endpoint_sp *endpoint)
+/* The hash table has at least twice as many entries as slots */
+static size_t shared_memory_table_size(size_t shared_memory_count)
 {
-	struct ts_rpc_shared_memory *memory = endpoint->shared_memories;
-	struct ts_rpc_shared_memory *end = memory + endpoint->shared_memory_count;
+	size_t table_size = 2;
 
-	for (; memory < end; memory++)
-		if (!memory->used)
-			return memory;
+	while (table_size < 2 * shared_memory_count)
+		table_size <<= 1;
 
-	return NULL;
+	return table_size;
+}
+
+static size_t shared_memory_hash(uint16_t owner_id, uint64_t handle, size_t table_size)
+{
+	uint64_t key = (handle ^ ((uint64_t)owner_id << 48)) * 0x9e3779b97f4a7c15ULL;
+
+	return (size_t)(key >> 32) & (table_size - 1);
 }
 
 static struct ts_rpc_shared_memory *find_shared_memory_descriptor(
 	struct ts_rpc_endpoint_sp *endpoint, uint16_t owner_id, uint64_t handle)
 {
-	struct ts_rpc_shared_memory *memory = endpoint->shared_memories;
-	struct ts_rpc_shared_memory *end = memory + endpoint->shared_memory_count;
+	size_t mask = endpoint->shared_memory_table_size - 1;
+	size_t index = shared_memory_hash(owner_id, handle, endpoint->shared_memory_table_size);
+
+	/* The table is never full, the probe ends at an unused entry */
+	for (; endpoint->shared_memories[index].used; index = (index + 1) & mask) {
+		struct ts_rpc_shared_memory *memory = &endpoint->shared_memories[index];
 
-	for (; memory < end; memory++)
-		if (memory->used && memory->owner_id == owner_id && memory->handle == handle)
+		if (memory->owner_id == owner_id && memory->handle == handle)
 			return memory;
+	}
 
 	return NULL;
 }
 
-static rpc_status_t handle_memory_retrieve(struct ts_rpc_endpoint_sp *endpoint, uint16_t source_id,
-					   uint64_t memory_handle, uint64_t memory_tag)
+static struct ts_rpc_shared_memory *find_free_shared_memory_descriptor(
+	struct ts_rpc_shared_memory *table, size_t table_size, uint16_t owner_id,
+	uint64_t handle)
+{
+	size_t index = shared_memory_hash(owner_id, handle, table_size);
+
+	while (table[index].used)
+		index = (index + 1) & (table_size - 1);
+
+	return &table[index];
+}
+
+/* Grows the table if all slots are used. Returns false if the limit has been reached. */
+static bool reserve_shared_memory_slot(struct ts_rpc_endpoint_sp *endpoint)
+{
+	struct ts_rpc_shared_memory *table = NULL;
+	size_t count = 0;
+	size_t table_size = 0;
+
+	if (endpoint->shared_memory_used < endpoint->shared_memory_count)
+		return true;
+
+	if (endpoint->shared_memory_count >= endpoint->shared_memory_limit)
+		return false;
+
+	count = endpoint->shared_memory_count * 2;
+	if (count > endpoint->shared_memory_limit)
+		count = endpoint->shared_memory_limit;
+
+	table_size = shared_memory_table_size(count);
+	table = calloc(table_size, sizeof(struct ts_rpc_shared_memory));
+	if (!table)
+		return false;
+
+	for (size_t i = 0; i < endpoint->shared_memory_table_size; i++) {
+		const struct ts_rpc_shared_memory *memory = &endpoint->shared_memories[i];
+
+		if (memory->used)
+			*find_free_shared_memory_descriptor(table, table_size, memory->owner_id,
+							    memory->handle) = *memory;
+	}
+
+	free(endpoint->shared_memories);
+	endpoint->shared_memories = table;
+	endpoint->shared_memory_count = count;
+	endpoint->shared_memory_table_size = table_size;
+
+	return true;
+}
+
+/* Removes the descriptor and moves back the entries of its probe sequence */
+static void remove_shared_memory_descriptor(struct ts_rpc_endpoint_sp *endpoint,
+					    struct ts_rpc_shared_memory *memory)
+{
+	size_t mask = endpoint->shared_memory_table_size - 1;
+	size_t hole = memory - endpoint->shared_memories;
+	size_t index = hole;
+
+	endpoint->shared_memories[hole] = (struct ts_rpc_shared_memory){ 0 };
+	endpoint->shared_memory_used--;
+
+	for (index = (index + 1) & mask; endpoint->shared_memories[index].used;
+	     index = (index + 1) & mask) {
+		struct ts_rpc_shared_memory *entry = &endpoint->shared_memories[index];
+		size_t home = shared_memory_hash(entry->owner_id, entry->handle,
+						 endpoint->shared_memory_table_size);
+
+		/* The entry can fill the hole if its probe sequence passes through it */
+		if (((index - home) & mask) >= ((index - hole) & mask)) {
+			endpoint->shared_memories[hole] = *entry;
+			*entry = (struct ts_rpc_shared_memory){ 0 };
+			hole = index;
+		}
+	}
+}
+
+static rpc_status_t retrieve_memory(struct ts_rpc_endpoint_sp *endpoint, uint16_t source_id,
+				    uint64_t memory_handle, struct sp_memory_region *region)
 {
 	sp_result sp_res = SP_RESULT_INTERNAL_ERROR;
 	struct sp_memory_descriptor desc = { 0 };
 	struct sp_memory_access_descriptor acc_desc = { 0 };
-	struct sp_memory_region region = { 0 };
 	uint32_t in_region_count = 0;
 	uint32_t out_region_count = 1;
-	struct ts_rpc_shared_memory *memory = NULL;
-
-	(void)memory_tag;
-
-	memory = find_free_shared_memory_descriptor(endpoint);
-	if (!memory) {
-		EMSG("No available shared memory slot");
-		return RPC_ERROR_NOT_FOUND;
-	}
 
 	desc.sender_id = source_id;
 	desc.memory_type = sp_memory_type_not_specified;
@@ -66,18 +141,80 @@ static rpc_status_t handle_memory_retrieve(struct ts_rpc_endpoint_sp *endpoint,
 	acc_desc.receiver_id = endpoint->own_id;
 	acc_desc.data_access = sp_data_access_read_write;
 
-	sp_res = sp_memory_retrieve(&desc, &acc_desc, &region, in_region_count,
+	sp_res = sp_memory_retrieve(&desc, &acc_desc, region, in_region_count,
 				    &out_region_count, memory_handle);
 	if (sp_res != SP_RESULT_OK) {
 		EMSG("Failed to retrieve memory: %d", sp_res);
 		return RPC_ERROR_TRANSPORT_LAYER;
 	}
 
+	return RPC_SUCCESS;
+}
+
+static rpc_status_t relinquish_memory(struct ts_rpc_endpoint_sp *endpoint, uint64_t memory_handle)
+{
+	sp_result sp_res = SP_RESULT_INTERNAL_ERROR;
+	uint16_t endpoints[1] = { 0 };
+	uint32_t endpoint_count = 1;
+	struct sp_memory_transaction_flags flags = {
+		.zero_memory = false,
+		.operation_time_slicing = false,
+	};
+
+	endpoints[0] = endpoint->own_id;
+
+	sp_res = sp_memory_relinquish(memory_handle, endpoints, endpoint_count, &flags);
+	if (sp_res != SP_RESULT_OK) {
+		EMSG("Failed to relinquish memory: %d", sp_res);
+		return RPC_ERROR_TRANSPORT_LAYER;
+	}
+
+	return RPC_SUCCESS;
+}
+
+static rpc_status_t handle_memory_retrieve(struct ts_rpc_endpoint_sp *endpoint, uint16_t source_id,
+					   uint64_t memory_handle, uint64_t memory_tag)
+{
+	struct sp_memory_region region = { 0 };
+	struct ts_rpc_shared_memory *memory = NULL;
+	rpc_status_t status = RPC_ERROR_INTERNAL;
+
+	(void)memory_tag;
+
+	memory = find_shared_memory_descriptor(endpoint, source_id, memory_handle);
+	if (memory) {
+		if (memory->retrieve_count == UINT32_MAX)
+			return RPC_ERROR_RESOURCE_FAILURE;
+
+		/* The SPMC counts the retrieve requests too, each needs a relinquish */
+		status = retrieve_memory(endpoint, source_id, memory_handle, &region);
+		if (status != RPC_SUCCESS)
+			return status;
+
+		memory->retrieve_count++;
+
+		return RPC_SUCCESS;
+	}
+
+	if (!reserve_shared_memory_slot(endpoint)) {
+		EMSG("No available shared memory slot");
+		return RPC_ERROR_NOT_FOUND;
+	}
+
+	status = retrieve_memory(endpoint, source_id, memory_handle, &region);
+	if (status != RPC_SUCCESS)
+		return status;
+
+	memory = find_free_shared_memory_descriptor(endpoint->shared_memories,
+						    endpoint->shared_memory_table_size,
+						    source_id, memory_handle);
 	memory->owner_id = source_id;
 	memory->handle = memory_handle;
 	memory->data = region.address;
 	memory->size = region.page_count * FFA_MEM_TRANSACTION_PAGE_SIZE;
 	memory->used = true;
+	memory->retrieve_count = 1;
+	endpoint->shared_memory_used++;
 
 	return RPC_SUCCESS;
 }
@@ -85,14 +222,8 @@ static rpc_status_t handle_memory_retrieve(struct ts_rpc_endpoint_sp *endpoint,
 static rpc_status_t handle_memory_relinquish(struct ts_rpc_endpoint_sp *endpoint,
 					     uint16_t source_id, uint64_t memory_handle)
 {
-	sp_result sp_res = SP_RESULT_INTERNAL_ERROR;
-	uint16_t endpoints[1] = { 0 };
-	uint32_t endpoint_count = 1;
-	struct sp_memory_transaction_flags flags = {
-		.zero_memory = false,
-		.operation_time_slicing = false,
-	};
 	struct ts_rpc_shared_memory *memory = NULL;
+	rpc_status_t status = RPC_ERROR_INTERNAL;
 
 	memory = find_shared_memory_descriptor(endpoint, source_id, memory_handle);
 	if (!memory) {
@@ -100,15 +231,13 @@ static rpc_status_t handle_memory_relinquish(struct ts_rpc_endpoint_sp *endpoint
 		return RPC_ERROR_NOT_FOUND;
 	}
 
-	endpoints[0] = endpoint->own_id;
-
-	sp_res = sp_memory_relinquish(memory->handle, endpoints, endpoint_count, &flags);
-	if (sp_res != SP_RESULT_OK) {
-		EMSG("Failed to relinquish memory: %d", sp_res);
-		return RPC_ERROR_TRANSPORT_LAYER;
-	}
+	status = relinquish_memory(endpoint, memory->handle);
+	if (status != RPC_SUCCESS)
+		return status;
 
-	*memory = (struct ts_rpc_shared_memory){ 0 };
+	/* The descriptor is kept until the last relinquish request */
+	if (--memory->retrieve_count == 0)
+		remove_shared_memory_descriptor(endpoint, memory);
 
 	return RPC_SUCCESS;
 }
@@ -267,7 +396,12 @@ rpc_status_t ts_rpc_endpoint_sp_init(struct ts_rpc_endpoint_sp *endpoint, size_t
 		return RPC_ERROR_RESOURCE_FAILURE;
 
 	endpoint->service_count = service_count;
-	endpoint->shared_memories = calloc(shared_memory_count,
+
+	if (!shared_memory_count)
+		shared_memory_count = 1;
+
+	endpoint->shared_memory_table_size = shared_memory_table_size(shared_memory_count);
+	endpoint->shared_memories = calloc(endpoint->shared_memory_table_size,
 					   sizeof(struct ts_rpc_shared_memory));
 	if (!endpoint->shared_memories) {
 		free(endpoint->services);
@@ -275,6 +409,25 @@ rpc_status_t ts_rpc_endpoint_sp_init(struct ts_rpc_endpoint_sp *endpoint, size_t
 	}
 
 	endpoint->shared_memory_count = shared_memory_count;
+	endpoint->shared_memory_used = 0;
+	endpoint->shared_memory_limit = TS_RPC_ENDPOINT_SP_SHARED_MEMORY_LIMIT;
+	if (endpoint->shared_memory_limit < shared_memory_count)
+		endpoint->shared_memory_limit = shared_memory_count;
+
+	return RPC_SUCCESS;
+}
+
+rpc_status_t ts_rpc_endpoint_sp_configure_shared_memory(struct ts_rpc_endpoint_sp *endpoint,
+							size_t shared_memory_limit)
+{
+	if (!endpoint || !endpoint->shared_memories)
+		return RPC_ERROR_INVALID_VALUE;
+
+	/* The table doesn't shrink */
+	if (shared_memory_limit < endpoint->shared_memory_count)
+		return RPC_ERROR_INVALID_VALUE;
+
+	endpoint->shared_memory_limit = shared_memory_limit;
 
 	return RPC_SUCCESS;
 }
@@ -289,12 +442,16 @@ rpc_status_t ts_rpc_endpoint_sp_deinit(struct ts_rpc_endpoint_sp *endpoint)
 		return RPC_ERROR_INVALID_VALUE;
 
 	memory = endpoint->shared_memories;
-	end = memory + endpoint->shared_memory_count;
+	end = memory + endpoint->shared_memory_table_size;
 
+	/* Relinquishing may move another descriptor into the same entry */
 	for (; memory < end; memory++) {
-		status = handle_memory_relinquish(endpoint, memory->owner_id, memory->handle);
-		if (status)
-			return status;
+		while (memory->used) {
+			status = handle_memory_relinquish(endpoint, memory->owner_id,
+							  memory->handle);
+			if (status)
+				return status;
+		}
 	}
 
 	free(endpoint->services);
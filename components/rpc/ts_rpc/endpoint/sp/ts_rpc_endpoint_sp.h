@@ -18,13 +18,24 @@
 extern "C" {
 #endif
 
+/**
+ * The default upper limit of the shared memory slot count. The slot count given to
+ * ts_rpc_endpoint_sp_init is doubled on demand until it reaches the limit. This may be
+ * overridden to meet the needs of a particular deployment or set per endpoint by
+ * ts_rpc_endpoint_sp_configure_shared_memory.
+ */
+#ifndef TS_RPC_ENDPOINT_SP_SHARED_MEMORY_LIMIT
+#define TS_RPC_ENDPOINT_SP_SHARED_MEMORY_LIMIT	(256)
+#endif
+
 /**
  * @brief TS RPC shared memory
  *
  * The structure describes an FF-A shared memory slot in the endpoint implementation. The shared
  * memory is identified by its owner (FF-A ID) and handle (FF-A memory handle). After retrieval the
  * data and size fields are filled. The used field indicates if a given memory slot of the pool is
- * used and contains valid information.
+ * used and contains valid information. The retrieve count tracks the retrieve requests of the
+ * owner that were not relinquished yet.
  */
 struct ts_rpc_shared_memory {
 	uint16_t owner_id;
@@ -32,6 +43,7 @@ struct ts_rpc_shared_memory {
 	void *data;
 	size_t size;
 	bool used;
+	uint32_t retrieve_count;
 };
 
 /**
@@ -42,13 +54,22 @@ struct ts_rpc_shared_memory {
  * The structure contains the endpoint's own FF-A ID to be used in FF-A calls.
  * It also contains of list of services. These services are selected based on the interface ID of
  * the RPC request. The endpoint handles the shared memory pool.
+ * The shared memory descriptors are kept in an open addressing hash table keyed by owner and
+ * handle. The table has twice as many entries as there are slots, so lookups stay short.
  */
 struct ts_rpc_endpoint_sp {
 	uint16_t own_id;
 	struct rpc_service_interface **services;
 	size_t service_count;
 	struct ts_rpc_shared_memory *shared_memories;
+	/* Number of retrieved shared memories the table holds before it grows */
 	size_t shared_memory_count;
+	/* Number of retrieved shared memories */
+	size_t shared_memory_used;
+	/* Number of entries of the hash table, a power of two */
+	size_t shared_memory_table_size;
+	/* Upper limit of shared_memory_count */
+	size_t shared_memory_limit;
 };
 
 /**
@@ -56,12 +77,25 @@ struct ts_rpc_endpoint_sp {
  *
  * @param endpoint The endpoint instance
  * @param service_count Service count
- * @param shared_memory_count Shared memory pool size
+ * @param shared_memory_count Initial shared memory pool size
  * @return rpc_status_t
  */
 rpc_status_t ts_rpc_endpoint_sp_init(struct ts_rpc_endpoint_sp *endpoint, size_t service_count,
 				     size_t shared_memory_count);
 
+/**
+ * @brief Configure the shared memory handling of the endpoint
+ *
+ * The slot count grows on demand up to shared_memory_limit. The limit can't be lower than the
+ * current slot count, as the table doesn't shrink.
+ *
+ * @param endpoint The endpoint instance
+ * @param shared_memory_limit Upper limit of the shared memory slot count
+ * @return rpc_status_t
+ */
+rpc_status_t ts_rpc_endpoint_sp_configure_shared_memory(struct ts_rpc_endpoint_sp *endpoint,
+							size_t shared_memory_limit);
+
 /**
  * @brief Deinit TS RPC endpoint
  *
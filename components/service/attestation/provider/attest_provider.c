@@ -47,7 +47,7 @@ struct rpc_service_interface *attest_provider_init(struct attest_provider *conte
 
 void attest_provider_deinit(struct attest_provider *context)
 {
-	(void)context;
+	service_provider_deinit(&context->base_provider);
 }
 
 void attest_provider_register_serializer(struct attest_provider *context,
@@ -53,7 +53,7 @@ struct rpc_service_interface *block_storage_provider_init(
 void block_storage_provider_deinit(
 	struct block_storage_provider *context)
 {
-	(void)context;
+	service_provider_deinit(&context->base_provider);
 }
 
 void block_storage_provider_register_serializer(
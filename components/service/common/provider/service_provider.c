@@ -5,8 +5,10 @@
  */
 
 #include "service_provider.h"
+#include <protocols/rpc/common/packed-c/batch.h>
 #include <protocols/rpc/common/packed-c/status.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const struct service_handler *find_handler(const struct service_provider *sp,
@@ -50,6 +52,313 @@ static void set_opcode_range(struct service_provider *sp)
 	sp->opcode_range_hi = hi;
 }
 
+/*
+ * Dispatch tables are dense if the opcodes of the chain fill at least 1 in
+ * SERVICE_DISPATCH_DENSE_RATIO of their range.  Otherwise up to
+ * SERVICE_DISPATCH_HASH_ATTEMPTS multipliers are tried for each hash table size
+ * before the size is doubled.  If no collision free hash is found the handlers
+ * are searched as before.
+ */
+#ifndef SERVICE_DISPATCH_DENSE_RATIO
+#define SERVICE_DISPATCH_DENSE_RATIO	(4)
+#endif
+
+#ifndef SERVICE_DISPATCH_HASH_ATTEMPTS
+#define SERVICE_DISPATCH_HASH_ATTEMPTS	(64)
+#endif
+
+static rpc_status_t receive(void *context, struct rpc_request *req);
+
+/* The successor is a service_provider whose handlers can be flattened into the table */
+static struct service_provider *successor_provider(struct rpc_service_interface *successor)
+{
+	if (!successor || successor->receive != receive)
+		return NULL;
+
+	return (struct service_provider *)((char *)successor -
+					   offsetof(struct service_provider, iface));
+}
+
+/*
+ * Changed whenever the provider is extended or linked to a successor.  A provider
+ * can be part of the chain of any provider before it, so the head of a chain
+ * sums up the generations of all providers of the chain.  Chains are normally
+ * final before the first call, so tables are rarely rebuilt.
+ */
+static void chain_changed(struct service_provider *sp)
+{
+	sp->generation++;
+}
+
+static uint32_t chain_generation(const struct service_provider *sp)
+{
+	uint32_t generation = 0;
+
+	for (const struct service_provider *p = sp; p; p = successor_provider(p->successor))
+		generation += p->generation;
+
+	return generation;
+}
+
+static uint32_t dispatch_index(const struct service_dispatch *dispatch, uint32_t opcode)
+{
+	if (dispatch->multiplier)
+		return (uint32_t)(opcode * dispatch->multiplier) >> dispatch->shift;
+
+	return opcode - dispatch->base;
+}
+
+static const struct service_dispatch_entry *dispatch_lookup(const struct service_dispatch *dispatch,
+							    uint32_t opcode)
+{
+	const struct service_dispatch_entry *entry = NULL;
+
+	if (!dispatch->multiplier &&
+	    (opcode < dispatch->base || opcode - dispatch->base >= dispatch->size))
+		return NULL;
+
+	entry = &dispatch->table[dispatch_index(dispatch, opcode)];
+	if (!entry->handler || service_handler_get_opcode(entry->handler) != opcode)
+		return NULL;
+
+	return entry;
+}
+
+/*
+ * Fills the table with the handlers of the chain, earlier providers take precedence like
+ * they do when the chain is walked.  Returns false if two opcodes map to the same entry.
+ */
+static bool dispatch_fill(struct service_provider *sp, struct service_dispatch *dispatch)
+{
+	memset(dispatch->table, 0, dispatch->size * sizeof(dispatch->table[0]));
+
+	for (struct service_provider *p = sp; p; p = successor_provider(p->successor)) {
+		for (size_t i = 0; i < p->num_handlers; i++) {
+			uint32_t opcode = service_handler_get_opcode(&p->handlers[i]);
+			struct service_dispatch_entry *entry =
+				&dispatch->table[dispatch_index(dispatch, opcode)];
+
+			if (entry->handler) {
+				if (service_handler_get_opcode(entry->handler) != opcode)
+					return false;
+
+				continue;
+			}
+
+			entry->handler = &p->handlers[i];
+			entry->context = p->iface.context;
+		}
+	}
+
+	return true;
+}
+
+static bool dispatch_build_hashed(struct service_provider *sp, struct service_dispatch *dispatch,
+				  size_t num_handlers)
+{
+	uint32_t bits = 1;
+
+	while (((size_t)1 << bits) < 2 * num_handlers)
+		bits++;
+
+	/* Give up once the table would be eight times larger than needed */
+	for (uint32_t max_bits = bits + 3; bits <= max_bits && bits < 32; bits++) {
+		uint32_t multiplier = 0x9e3779b1u;
+
+		dispatch->size = (uint32_t)1 << bits;
+		dispatch->shift = 32 - bits;
+		dispatch->table = calloc(dispatch->size, sizeof(dispatch->table[0]));
+		if (!dispatch->table)
+			return false;
+
+		for (unsigned int attempt = 0; attempt < SERVICE_DISPATCH_HASH_ATTEMPTS; attempt++) {
+			/* Odd multipliers from a simple LCG */
+			dispatch->multiplier = multiplier | 1u;
+			if (dispatch_fill(sp, dispatch))
+				return true;
+
+			multiplier = multiplier * 1664525u + 1013904223u;
+		}
+
+		free(dispatch->table);
+		dispatch->table = NULL;
+	}
+
+	return false;
+}
+
+static void dispatch_build(struct service_provider *sp, uint32_t generation)
+{
+	struct service_dispatch *dispatch = &sp->dispatch;
+	struct service_provider *p = NULL;
+	size_t num_handlers = 0;
+	uint32_t lo = UINT32_MAX;
+	uint32_t hi = 0;
+
+	dispatch->generation = generation;
+
+	for (p = sp; p; p = successor_provider(p->successor)) {
+		num_handlers += p->num_handlers;
+
+		if (p->num_handlers) {
+			if (p->opcode_range_lo < lo) lo = p->opcode_range_lo;
+			if (p->opcode_range_hi > hi) hi = p->opcode_range_hi;
+		}
+
+		if (p->successor && !successor_provider(p->successor))
+			dispatch->tail = p->successor;
+	}
+
+	if (!num_handlers)
+		return;
+
+	if ((uint64_t)hi - lo + 1 <= (uint64_t)num_handlers * SERVICE_DISPATCH_DENSE_RATIO) {
+		dispatch->size = hi - lo + 1;
+		dispatch->base = lo;
+		dispatch->multiplier = 0;
+		dispatch->table = calloc(dispatch->size, sizeof(dispatch->table[0]));
+
+		if (dispatch->table && dispatch_fill(sp, dispatch))
+			return;
+
+		free(dispatch->table);
+		dispatch->table = NULL;
+	} else if (dispatch_build_hashed(sp, dispatch, num_handlers)) {
+		return;
+	}
+
+	/* Fall back to walking the chain */
+	dispatch->size = 0;
+	dispatch->multiplier = 0;
+}
+
+static void dispatch_reset(struct service_provider *sp)
+{
+	free(sp->dispatch.table);
+	memset(&sp->dispatch, 0, sizeof(sp->dispatch));
+}
+
+static size_t batch_align(size_t offset)
+{
+	return (offset + TS_RPC_BATCH_ALIGNMENT - 1) & ~((size_t)TS_RPC_BATCH_ALIGNMENT - 1);
+}
+
+/* Checks that all entries of the batch request lie within the request */
+static rpc_status_t validate_batch(const uint8_t *batch, size_t batch_len, uint32_t *count)
+{
+	struct ts_rpc_batch_hdr hdr;
+	size_t offset = sizeof(hdr);
+
+	if (batch_len < sizeof(hdr))
+		return RPC_ERROR_INVALID_REQUEST_BODY;
+
+	memcpy(&hdr, batch, sizeof(hdr));
+
+	for (uint32_t i = 0; i < hdr.count; i++) {
+		struct ts_rpc_batch_req_entry entry;
+
+		offset = batch_align(offset);
+		if (offset > batch_len || batch_len - offset < sizeof(entry))
+			return RPC_ERROR_INVALID_REQUEST_BODY;
+
+		memcpy(&entry, &batch[offset], sizeof(entry));
+		offset += sizeof(entry);
+
+		if (entry.param_len > batch_len - offset)
+			return RPC_ERROR_INVALID_REQUEST_BODY;
+
+		offset += entry.param_len;
+	}
+
+	*count = hdr.count;
+
+	return RPC_SUCCESS;
+}
+
+/*
+ * Dispatches the sub-requests of a batch through the same handler lookup and chain of
+ * responsibility as individual calls.  The request is copied first, the responses are
+ * written to the same shared buffer and the copy can't be changed by the caller while the
+ * batch is processed.
+ */
+static rpc_status_t receive_batch(void *context, struct rpc_request *req)
+{
+	struct ts_rpc_batch_hdr resp_hdr = { 0 };
+	size_t batch_len = req->request.data_length;
+	size_t req_offset = sizeof(struct ts_rpc_batch_hdr);
+	size_t resp_offset = sizeof(resp_hdr);
+	uint8_t *batch = NULL;
+	uint32_t count = 0;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+
+	if (req->response.size < sizeof(resp_hdr))
+		return RPC_ERROR_INVALID_RESPONSE_BODY;
+
+	batch = malloc(batch_len ? batch_len : 1);
+	if (!batch)
+		return RPC_ERROR_RESOURCE_FAILURE;
+
+	memcpy(batch, req->request.data, batch_len);
+
+	rpc_status = validate_batch(batch, batch_len, &count);
+	if (rpc_status != RPC_SUCCESS) {
+		free(batch);
+		return rpc_status;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		struct ts_rpc_batch_req_entry req_entry;
+		struct ts_rpc_batch_resp_entry resp_entry = { 0 };
+		struct rpc_request sub_req = *req;
+
+		req_offset = batch_align(req_offset);
+		memcpy(&req_entry, &batch[req_offset], sizeof(req_entry));
+		req_offset += sizeof(req_entry);
+
+		/* Stop once the response of the next sub-request wouldn't even fit its entry */
+		resp_offset = batch_align(resp_offset);
+		if (resp_offset > req->response.size ||
+		    req->response.size - resp_offset < sizeof(resp_entry))
+			break;
+
+		sub_req.opcode = req_entry.opcode;
+		sub_req.service_status = 0;
+		sub_req.request.data = &batch[req_offset];
+		sub_req.request.data_length = req_entry.param_len;
+		sub_req.request.size = req_entry.param_len;
+		sub_req.response.data = &req->response.data[resp_offset + sizeof(resp_entry)];
+		sub_req.response.data_length = 0;
+		sub_req.response.size = req->response.size - resp_offset - sizeof(resp_entry);
+
+		if (sub_req.opcode == TS_RPC_OPCODE_BATCH)
+			resp_entry.rpc_status = RPC_ERROR_INVALID_VALUE;
+		else
+			resp_entry.rpc_status = receive(context, &sub_req);
+
+		if (resp_entry.rpc_status == RPC_SUCCESS &&
+		    sub_req.response.data_length > sub_req.response.size)
+			resp_entry.rpc_status = RPC_ERROR_INVALID_RESPONSE_BODY;
+
+		if (resp_entry.rpc_status == RPC_SUCCESS) {
+			resp_entry.param_len = (uint32_t)sub_req.response.data_length;
+			resp_entry.service_status = sub_req.service_status;
+		}
+
+		memcpy(&req->response.data[resp_offset], &resp_entry, sizeof(resp_entry));
+		resp_offset += sizeof(resp_entry) + resp_entry.param_len;
+		req_offset += req_entry.param_len;
+		resp_hdr.count++;
+	}
+
+	free(batch);
+
+	memcpy(req->response.data, &resp_hdr, sizeof(resp_hdr));
+	req->response.data_length = resp_offset;
+	req->service_status = 0;
+
+	return RPC_SUCCESS;
+}
+
 static rpc_status_t receive(void *context, struct rpc_request *req)
 {
 	struct rpc_service_interface *rpc_iface = (struct rpc_service_interface *)context;
@@ -58,6 +367,31 @@ static rpc_status_t receive(void *context, struct rpc_request *req)
 	const struct service_handler *handler = NULL;
 
 	sp = (struct service_provider*)((char*)rpc_iface - offsetof(struct service_provider, iface));
+
+	/* Batches are unpacked by the provider at the head of the chain */
+	if (req->opcode == TS_RPC_OPCODE_BATCH)
+		return receive_batch(context, req);
+
+	uint32_t generation = chain_generation(sp);
+
+	if (sp->dispatch.generation != generation) {
+		dispatch_reset(sp);
+		dispatch_build(sp, generation);
+	}
+
+	if (sp->dispatch.table) {
+		const struct service_dispatch_entry *entry = dispatch_lookup(&sp->dispatch,
+									     req->opcode);
+
+		if (entry)
+			return service_handler_invoke(entry->handler, entry->context, req);
+
+		if (sp->dispatch.tail)
+			return rpc_service_receive(sp->dispatch.tail, req);
+
+		return RPC_ERROR_INVALID_VALUE;
+	}
+
 	handler = find_handler(sp, req->opcode);
 
 	if (handler) {
@@ -76,6 +410,8 @@ void service_provider_init(struct service_provider *sp, void *context,
 			   const struct service_handler *handlers,
 			   size_t num_handlers)
 {
+	memset(&sp->dispatch, 0, sizeof(sp->dispatch));
+
 	sp->iface.receive = receive;
 	sp->iface.context = context;
 	memcpy(&sp->iface.uuid, service_uuid, sizeof(sp->iface.uuid));
@@ -84,13 +420,40 @@ void service_provider_init(struct service_provider *sp, void *context,
 	sp->num_handlers = num_handlers;
 
 	sp->successor = NULL;
+	sp->generation = 1;
 
 	set_opcode_range(sp);
 }
 
-void service_provider_extend(struct service_provider *context,
+void service_provider_deinit(struct service_provider *sp)
+{
+	dispatch_reset(sp);
+}
+
+/* Handlers for reserved opcodes would never be called */
+static bool handles_reserved_opcode(const struct service_provider *sp)
+{
+	return sp->num_handlers && sp->opcode_range_hi >= TS_RPC_OPCODE_RESERVED_BASE;
+}
+
+bool service_provider_extend(struct service_provider *context,
 			     struct service_provider *sub_provider)
 {
+	if (handles_reserved_opcode(sub_provider))
+		return false;
+
 	sub_provider->successor = context->successor;
 	context->successor = &sub_provider->iface;
+
+	/* Tables of all chains that include the context are rebuilt at their next call */
+	chain_changed(context);
+
+	return true;
+}
+
+void service_provider_link_successor(struct service_provider *sp,
+				     struct rpc_service_interface *successor)
+{
+	sp->successor = successor;
+	chain_changed(sp);
 }
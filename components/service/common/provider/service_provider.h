@@ -8,6 +8,7 @@
 #define SERVICE_PROVIDER_H
 
 #include "rpc/common/endpoint/rpc_service_interface.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -36,6 +37,37 @@ static inline uint32_t service_handler_get_opcode(const struct service_handler *
 	return handler->opcode;
 }
 
+/** \brief Dispatch table entry
+ *
+ * A handler of the chain of service providers together with the context of the
+ * provider that it belongs to.
+ */
+struct service_dispatch_entry {
+	const struct service_handler *handler;
+	void *context;
+};
+
+/** \brief Dispatch table
+ *
+ * The handlers of a chain of service providers flattened into a single table
+ * that is indexed by opcode.  Opcodes that span a narrow range index the
+ * table directly, sparse opcodes are mapped by a multiplicative hash that is
+ * chosen to be collision free for the opcodes of the chain.  The table is
+ * built at the first call and rebuilt at the next call after a provider of
+ * the chain was extended or relinked.
+ */
+struct service_dispatch {
+	struct service_dispatch_entry *table;
+	uint32_t size;
+	uint32_t base;
+	uint32_t multiplier;
+	uint32_t shift;
+	/* The first successor that isn't a service_provider, it handles the remaining opcodes */
+	struct rpc_service_interface *tail;
+	/* Sum of the generations of the chain's providers when it was built, 0 if it wasn't */
+	uint32_t generation;
+};
+
 /** \brief Service provider
  *
  * A generalised service provider that acts as an rpc call endpoint.  It receives call
@@ -50,6 +82,9 @@ struct service_provider {
 	uint32_t opcode_range_lo;
 	uint32_t opcode_range_hi;
 	struct rpc_service_interface *successor;
+	/* Number of changes to the successor link, see struct service_dispatch */
+	uint32_t generation;
+	struct service_dispatch dispatch;
 };
 
 static inline struct rpc_service_interface *service_provider_get_rpc_interface(struct service_provider *sp)
@@ -57,18 +92,29 @@ static inline struct rpc_service_interface *service_provider_get_rpc_interface(s
 	return &sp->iface;
 }
 
+/*
+ * Initialize the service provider.  A provider that is initialized again must be
+ * deinitialized first, otherwise its dispatch table leaks.
+ */
 void service_provider_init(struct service_provider *sp, void *context,
 			   const struct rpc_uuid *service_uuid,
 			   const struct service_handler *handlers, size_t num_handlers);
 
+/*
+ * Free the dispatch table built for the chain of the service provider.  Must be
+ * called by the deinit function of every concrete service provider.
+ */
+void service_provider_deinit(struct service_provider *sp);
+
 /*
  * Extend the core set of operations provided by a service provider by
  * adding a sub provider that will add a capability.  This facility
  * allows a deployment to customize the set of operations
  * supported to meet requirements by only extending the core service
- * provider if needed.
+ * provider if needed.  Returns false and leaves the chain unchanged if the
+ * sub provider has handlers for opcodes from TS_RPC_OPCODE_RESERVED_BASE up.
  */
-void service_provider_extend(struct service_provider *context,
+bool service_provider_extend(struct service_provider *context,
 			     struct service_provider *sub_provider);
 
 /*
@@ -76,11 +122,8 @@ void service_provider_extend(struct service_provider *context,
  * to allow call handling to be delegated to different components.  Used to support
  * modular configuration of service capabilities.
  */
-static inline void service_provider_link_successor(struct service_provider *sp,
-						   struct rpc_service_interface *successor)
-{
-	sp->successor = successor;
-}
+void service_provider_link_successor(struct service_provider *sp,
+				     struct rpc_service_interface *successor);
 
 #ifdef __cplusplus
 }
@@ -10,6 +10,8 @@
 #include <protocols/rpc/common/packed-c/status.h>
 #include <rpc/direct/direct_caller.h>
 #include "rpc/common/caller/rpc_caller_session.h"
+#include "rpc/common/caller/rpc_caller_batch.h"
+#include <protocols/rpc/common/packed-c/batch.h>
 #include <CppUTest/TestHarness.h>
 
 
@@ -99,6 +101,8 @@ TEST(ServiceFrameworkTests, serviceWithNoOps)
 	rpc_caller_session_end(handle);
 
 	LONGS_EQUAL(RPC_ERROR_INVALID_VALUE, rpc_status);
+
+	service_provider_deinit(&service_provider);
 }
 
 TEST(ServiceFrameworkTests, serviceWithOps)
@@ -173,6 +177,8 @@ TEST(ServiceFrameworkTests, serviceWithOps)
 	rpc_caller_session_end(handle);
 
 	LONGS_EQUAL(RPC_ERROR_INVALID_VALUE, rpc_status);
+
+	service_provider_deinit(&service_provider);
 }
 
 TEST(ServiceFrameworkTests, serviceProviderChain)
@@ -277,4 +283,347 @@ TEST(ServiceFrameworkTests, serviceProviderChain)
 	rpc_caller_session_end(handle);
 
 	LONGS_EQUAL(RPC_ERROR_INVALID_VALUE, rpc_status);
+
+	service_provider_deinit(&base_provider);
+}
+
+TEST(ServiceFrameworkTests, sharedMemoryPool)
+{
+	struct rpc_uuid service_uuid = { .uuid = {
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } };
+	struct service_handler handlers[1];
+	handlers[0].opcode = SOME_ARBITRARY_OPCODE;
+	handlers[0].invoke = handlerThatSucceeds;
+
+	struct service_provider service_provider;
+	struct rpc_caller_session_pool_stats stats;
+	rpc_status_t rpc_status;
+
+	service_provider_init(&service_provider, &service_provider, &service_uuid, handlers, 1);
+	rpc_status = direct_caller_init(&m_direct_caller,
+					service_provider_get_rpc_interface(&service_provider));
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+
+	/* Without session shared memory every call takes its buffer from the pool */
+	rpc_status = rpc_caller_session_find_and_open(&m_session, &m_direct_caller, &service_uuid,
+						      0);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+
+	rpc_call_handle handle;
+	uint8_t *req_buf;
+	uint8_t *resp_buf;
+	size_t resp_len;
+	service_status_t service_status;
+	const size_t req_lens[] = { 100, 200, RPC_CALLER_SESSION_POOL_MIN_SIZE + 1, 100 };
+
+	for (size_t i = 0; i < sizeof(req_lens) / sizeof(req_lens[0]); i++) {
+		handle = rpc_caller_session_begin(&m_session, &req_buf, req_lens[i], 0);
+		CHECK_TRUE(handle);
+
+		rpc_status = rpc_caller_session_invoke(handle, SOME_ARBITRARY_OPCODE, &resp_buf,
+						       &resp_len, &service_status);
+		LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+		STRCMP_EQUAL("Yay!", std::string((const char*)resp_buf, resp_len).c_str());
+
+		LONGS_EQUAL(RPC_SUCCESS, rpc_caller_session_end(handle));
+	}
+
+	/* The first call of each size class creates a buffer, the others reuse it */
+	LONGS_EQUAL(RPC_SUCCESS, rpc_caller_session_get_pool_stats(&m_session, &stats));
+	UNSIGNED_LONGS_EQUAL(2, stats.hits);
+	UNSIGNED_LONGS_EQUAL(2, stats.misses);
+	UNSIGNED_LONGS_EQUAL(0, stats.evictions);
+	UNSIGNED_LONGS_EQUAL(3 * RPC_CALLER_SESSION_POOL_MIN_SIZE, stats.held_bytes);
+	UNSIGNED_LONGS_EQUAL(3 * RPC_CALLER_SESSION_POOL_MIN_SIZE, stats.high_water_mark);
+
+	/* Calls larger than the largest class bypass the pool */
+	handle = rpc_caller_session_begin(&m_session, &req_buf,
+					  RPC_CALLER_SESSION_POOL_MIN_SIZE <<
+						  RPC_CALLER_SESSION_POOL_CLASSES, 0);
+	CHECK_TRUE(handle);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_caller_session_end(handle));
+
+	LONGS_EQUAL(RPC_SUCCESS, rpc_caller_session_get_pool_stats(&m_session, &stats));
+	UNSIGNED_LONGS_EQUAL(3, stats.misses);
+	UNSIGNED_LONGS_EQUAL(3 * RPC_CALLER_SESSION_POOL_MIN_SIZE, stats.held_bytes);
+
+	service_provider_deinit(&service_provider);
+}
+
+TEST(ServiceFrameworkTests, batchedCalls)
+{
+	struct rpc_uuid service_uuid = { .uuid = {
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } };
+	rpc_status_t rpc_status;
+
+	/* Construct a base provider and a sub provider to check that batches use the chain */
+	struct service_handler base_handlers[2];
+	base_handlers[0].opcode = SOME_ARBITRARY_OPCODE;
+	base_handlers[0].invoke = handlerThatSucceeds;
+	base_handlers[1].opcode = ANOTHER_ARBITRARY_OPCODE;
+	base_handlers[1].invoke = handlerThatFails;
+
+	struct service_provider base_provider;
+	service_provider_init(&base_provider, &base_provider, &service_uuid, base_handlers, 2);
+
+	struct service_handler sub_handlers[1];
+	sub_handlers[0].opcode = 200;
+	sub_handlers[0].invoke = handlerThatSucceeds;
+
+	struct service_provider sub_provider;
+	service_provider_init(&sub_provider, &sub_provider, &service_uuid, sub_handlers, 1);
+	CHECK_TRUE(service_provider_extend(&base_provider, &sub_provider));
+
+	/* A provider can't take over the batch opcode */
+	struct service_handler reserved_handlers[1];
+	reserved_handlers[0].opcode = TS_RPC_OPCODE_BATCH;
+	reserved_handlers[0].invoke = handlerThatSucceeds;
+
+	struct service_provider reserved_provider;
+	service_provider_init(&reserved_provider, &reserved_provider, &service_uuid,
+			      reserved_handlers, 1);
+	CHECK_FALSE(service_provider_extend(&base_provider, &reserved_provider));
+
+	rpc_status = direct_caller_init(&m_direct_caller,
+					service_provider_get_rpc_interface(&base_provider));
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+
+	rpc_status = rpc_caller_session_find_and_open(&m_session, &m_direct_caller, &service_uuid,
+						      4096);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+
+	struct rpc_caller_batch batch;
+	const uint32_t opcodes[] = {
+		SOME_ARBITRARY_OPCODE, 200, ANOTHER_ARBITRARY_OPCODE, YET_ANOTHER_ARBITRARY_OPCODE
+	};
+
+	rpc_status = rpc_caller_batch_begin(&batch, &m_session, 4096);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+
+	for (size_t i = 0; i < sizeof(opcodes) / sizeof(opcodes[0]); i++) {
+		uint8_t *req_buf = rpc_caller_batch_add(&batch, opcodes[i], 10);
+		CHECK_TRUE(req_buf);
+		memset(req_buf, 0, 10);
+	}
+
+	/* Batches can't be nested */
+	POINTERS_EQUAL(NULL, rpc_caller_batch_add(&batch, TS_RPC_OPCODE_BATCH, 0));
+
+	rpc_status = rpc_caller_batch_invoke(&batch);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+
+	rpc_status_t call_status;
+	service_status_t service_status;
+	uint8_t *resp_buf;
+	size_t resp_len;
+
+	/* Handled by the base provider */
+	rpc_status = rpc_caller_batch_next_response(&batch, &call_status, &service_status,
+						    &resp_buf, &resp_len);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+	LONGS_EQUAL(RPC_SUCCESS, call_status);
+	LONGS_EQUAL(SERVICE_SPECIFIC_SUCCESS_CODE, service_status);
+	STRCMP_EQUAL("Yay!", std::string((const char*)resp_buf, resp_len).c_str());
+
+	/* Handled by the sub provider */
+	rpc_status = rpc_caller_batch_next_response(&batch, &call_status, &service_status,
+						    &resp_buf, &resp_len);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+	LONGS_EQUAL(RPC_SUCCESS, call_status);
+	LONGS_EQUAL(SERVICE_SPECIFIC_SUCCESS_CODE, service_status);
+	STRCMP_EQUAL("Yay!", std::string((const char*)resp_buf, resp_len).c_str());
+
+	/* A failing request doesn't affect the others */
+	rpc_status = rpc_caller_batch_next_response(&batch, &call_status, &service_status,
+						    &resp_buf, &resp_len);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+	LONGS_EQUAL(RPC_SUCCESS, call_status);
+	LONGS_EQUAL(SERVICE_SPECIFIC_ERROR_CODE, service_status);
+	STRCMP_EQUAL("Ehh!", std::string((const char*)resp_buf, resp_len).c_str());
+
+	/* Unsupported opcode */
+	rpc_status = rpc_caller_batch_next_response(&batch, &call_status, &service_status,
+						    &resp_buf, &resp_len);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+	LONGS_EQUAL(RPC_ERROR_INVALID_VALUE, call_status);
+
+	rpc_status = rpc_caller_batch_next_response(&batch, &call_status, &service_status,
+						    &resp_buf, &resp_len);
+	LONGS_EQUAL(RPC_ERROR_NOT_FOUND, rpc_status);
+
+	LONGS_EQUAL(RPC_SUCCESS, rpc_caller_batch_end(&batch));
+
+	service_provider_deinit(&base_provider);
+}
+
+TEST(ServiceFrameworkTests, flattenedDispatch)
+{
+	struct rpc_uuid service_uuid = { .uuid = {
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } };
+	rpc_status_t rpc_status;
+
+	/* Dense opcodes, the sub provider's duplicate of opcode 2 is shadowed by the base */
+	struct service_handler base_handlers[2];
+	base_handlers[0].opcode = 1;
+	base_handlers[0].invoke = handlerThatSucceeds;
+	base_handlers[1].opcode = 2;
+	base_handlers[1].invoke = handlerThatSucceeds;
+
+	struct service_provider base_provider;
+	service_provider_init(&base_provider, &base_provider, &service_uuid, base_handlers, 2);
+
+	struct service_handler sub0_handlers[2];
+	sub0_handlers[0].opcode = 2;
+	sub0_handlers[0].invoke = handlerThatFails;
+	sub0_handlers[1].opcode = 3;
+	sub0_handlers[1].invoke = handlerThatFails;
+
+	struct service_provider sub0_provider;
+	service_provider_init(&sub0_provider, &sub0_provider, &service_uuid, sub0_handlers, 2);
+	service_provider_extend(&base_provider, &sub0_provider);
+
+	rpc_status = direct_caller_init(&m_direct_caller,
+					service_provider_get_rpc_interface(&base_provider));
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+
+	rpc_status = rpc_caller_session_find_and_open(&m_session, &m_direct_caller, &service_uuid,
+						      4096);
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+
+	const struct {
+		uint32_t opcode;
+		rpc_status_t rpc_status;
+		service_status_t service_status;
+	} expected[] = {
+		{ 1, RPC_SUCCESS, SERVICE_SPECIFIC_SUCCESS_CODE },
+		{ 2, RPC_SUCCESS, SERVICE_SPECIFIC_SUCCESS_CODE },
+		{ 3, RPC_SUCCESS, SERVICE_SPECIFIC_ERROR_CODE },
+		{ 4, RPC_ERROR_INVALID_VALUE, 0 },
+		{ 1000, RPC_ERROR_INVALID_VALUE, 0 },
+	};
+
+	for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+		uint8_t *req_buf;
+		uint8_t *resp_buf;
+		size_t resp_len;
+		service_status_t service_status = 0;
+		rpc_call_handle handle = rpc_caller_session_begin(&m_session, &req_buf, 0, 0);
+
+		CHECK_TRUE(handle);
+
+		rpc_status = rpc_caller_session_invoke(handle, expected[i].opcode, &resp_buf,
+						       &resp_len, &service_status);
+
+		rpc_caller_session_end(handle);
+
+		LONGS_EQUAL(expected[i].rpc_status, rpc_status);
+		if (rpc_status == RPC_SUCCESS)
+			LONGS_EQUAL(expected[i].service_status, service_status);
+	}
+
+	/* Extending the chain after calls were made rebuilds the table, now with sparse opcodes */
+	struct service_handler sub1_handlers[1];
+	sub1_handlers[0].opcode = 1000;
+	sub1_handlers[0].invoke = handlerThatSucceeds;
+
+	struct service_provider sub1_provider;
+	service_provider_init(&sub1_provider, &sub1_provider, &service_uuid, sub1_handlers, 1);
+	service_provider_extend(&base_provider, &sub1_provider);
+
+	uint8_t *req_buf;
+	uint8_t *resp_buf;
+	size_t resp_len;
+	service_status_t service_status = 0;
+	rpc_call_handle handle = rpc_caller_session_begin(&m_session, &req_buf, 0, 0);
+
+	CHECK_TRUE(handle);
+
+	rpc_status = rpc_caller_session_invoke(handle, 1000, &resp_buf, &resp_len, &service_status);
+
+	rpc_caller_session_end(handle);
+
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+	LONGS_EQUAL(SERVICE_SPECIFIC_SUCCESS_CODE, service_status);
+
+	/* Extending a provider in the middle of the chain also rebuilds the head's table */
+	struct service_handler sub2_handlers[1];
+	sub2_handlers[0].opcode = 4;
+	sub2_handlers[0].invoke = handlerThatSucceeds;
+
+	struct service_provider sub2_provider;
+	service_provider_init(&sub2_provider, &sub2_provider, &service_uuid, sub2_handlers, 1);
+	service_provider_extend(&sub0_provider, &sub2_provider);
+
+	handle = rpc_caller_session_begin(&m_session, &req_buf, 0, 0);
+
+	CHECK_TRUE(handle);
+
+	rpc_status = rpc_caller_session_invoke(handle, 4, &resp_buf, &resp_len, &service_status);
+
+	rpc_caller_session_end(handle);
+
+	LONGS_EQUAL(RPC_SUCCESS, rpc_status);
+	LONGS_EQUAL(SERVICE_SPECIFIC_SUCCESS_CODE, service_status);
+
+	service_provider_deinit(&base_provider);
+}
+
+TEST(ServiceFrameworkTests, dispatchTablesArePerChain)
+{
+	struct rpc_uuid service_uuid = { .uuid = {
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef } };
+	uint8_t resp_data[16];
+
+	struct service_handler handlers[2];
+	handlers[0].opcode = 1;
+	handlers[0].invoke = handlerThatSucceeds;
+	handlers[1].opcode = 2;
+	handlers[1].invoke = handlerThatSucceeds;
+
+	/* Two independent chains */
+	struct service_provider provider_a;
+	struct service_provider provider_b;
+	struct service_provider sub_provider;
+
+	service_provider_init(&provider_a, &provider_a, &service_uuid, &handlers[0], 1);
+	service_provider_init(&provider_b, &provider_b, &service_uuid, &handlers[0], 1);
+	service_provider_init(&sub_provider, &sub_provider, &service_uuid, &handlers[1], 1);
+
+	struct rpc_request req = { };
+
+	req.opcode = 1;
+	req.response.data = resp_data;
+	req.response.size = sizeof(resp_data);
+
+	LONGS_EQUAL(RPC_SUCCESS,
+		    rpc_service_receive(service_provider_get_rpc_interface(&provider_a), &req));
+	CHECK_TRUE(provider_a.dispatch.table);
+
+	const struct service_dispatch_entry *table = provider_a.dispatch.table;
+	uint32_t generation = provider_a.dispatch.generation;
+
+	/* Extending the other chain leaves the table alone */
+	CHECK_TRUE(service_provider_extend(&provider_b, &sub_provider));
+
+	LONGS_EQUAL(RPC_SUCCESS,
+		    rpc_service_receive(service_provider_get_rpc_interface(&provider_a), &req));
+	POINTERS_EQUAL(table, provider_a.dispatch.table);
+	UNSIGNED_LONGS_EQUAL(generation, provider_a.dispatch.generation);
+
+	req.opcode = 2;
+	LONGS_EQUAL(RPC_ERROR_INVALID_VALUE,
+		    rpc_service_receive(service_provider_get_rpc_interface(&provider_a), &req));
+	LONGS_EQUAL(RPC_SUCCESS,
+		    rpc_service_receive(service_provider_get_rpc_interface(&provider_b), &req));
+
+	service_provider_deinit(&provider_a);
+	service_provider_deinit(&provider_b);
+	service_provider_deinit(&sub_provider);
+
+	POINTERS_EQUAL(NULL, provider_a.dispatch.table);
+	POINTERS_EQUAL(NULL, provider_b.dispatch.table);
 }
@@ -81,7 +81,7 @@ crypto_provider_init(struct crypto_provider *context, unsigned int encoding,
 
 void crypto_provider_deinit(struct crypto_provider *context)
 {
-	(void)context;
+	service_provider_deinit(&context->base_provider);
 }
 
 void crypto_provider_register_serializer(struct crypto_provider *context,
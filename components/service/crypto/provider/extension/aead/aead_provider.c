@@ -52,6 +52,7 @@ void aead_provider_init(struct aead_provider *context)
 void aead_provider_deinit(struct aead_provider *context)
 {
 	crypto_context_pool_deinit(&context->context_pool);
+	service_provider_deinit(&context->base_provider);
 }
 
 void aead_provider_register_serializer(struct aead_provider *context,
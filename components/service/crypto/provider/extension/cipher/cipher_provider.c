@@ -46,6 +46,7 @@ void cipher_provider_init(struct cipher_provider *context)
 void cipher_provider_deinit(struct cipher_provider *context)
 {
 	crypto_context_pool_deinit(&context->context_pool);
+	service_provider_deinit(&context->base_provider);
 }
 
 void cipher_provider_register_serializer(struct cipher_provider *context,
@@ -44,6 +44,7 @@ void hash_provider_init(struct hash_provider *context)
 void hash_provider_deinit(struct hash_provider *context)
 {
 	crypto_context_pool_deinit(&context->context_pool);
+	service_provider_deinit(&context->base_provider);
 }
 
 void hash_provider_register_serializer(struct hash_provider *context,
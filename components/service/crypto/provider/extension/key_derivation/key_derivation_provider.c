@@ -54,6 +54,7 @@ void key_derivation_provider_init(struct key_derivation_provider *context)
 void key_derivation_provider_deinit(struct key_derivation_provider *context)
 {
 	crypto_context_pool_deinit(&context->context_pool);
+	service_provider_deinit(&context->base_provider);
 }
 
 void key_derivation_provider_register_serializer(struct key_derivation_provider *context,
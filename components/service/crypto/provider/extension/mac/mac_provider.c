@@ -44,6 +44,7 @@ void mac_provider_init(struct mac_provider *context)
 void mac_provider_deinit(struct mac_provider *context)
 {
 	crypto_context_pool_deinit(&context->context_pool);
+	service_provider_deinit(&context->base_provider);
 }
 
 void mac_provider_register_serializer(struct mac_provider *context,
@@ -66,7 +66,7 @@ struct rpc_service_interface *fwu_provider_init(struct fwu_provider *context,
 
 void fwu_provider_deinit(struct fwu_provider *context)
 {
-	(void)context;
+	service_provider_deinit(&context->base_provider);
 }
 
 static uint16_t generate_function_presence(const struct update_agent *agent,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2022, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2020-2025, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -12,10 +12,20 @@
 struct linux_ts_service_context
 {
     struct service_context service_context;
-    struct rpc_caller_interface caller;
     struct rpc_uuid service_uuid;
 };
 
+/*
+ * A TS RPC caller holds a single TEE session, so every session gets its own
+ * caller. This allows independent sessions to the same service to be used
+ * concurrently from different threads.
+ */
+struct linux_ts_service_session
+{
+    struct rpc_caller_session session;
+    struct rpc_caller_interface caller;
+};
+
 /* Concrete service_context methods */
 static struct rpc_caller_session *linux_ts_service_context_open(void *context);
 static void linux_ts_service_context_close(void *context, struct rpc_caller_session *session);
@@ -26,7 +36,6 @@ struct linux_ts_service_context *linux_ts_service_context_create(const struct rp
 
 {
 	struct linux_ts_service_context *new_context = NULL;
-	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
 
 	if (!service_uuid)
 		return NULL;
@@ -36,12 +45,6 @@ struct linux_ts_service_context *linux_ts_service_context_create(const struct rp
 	if (!new_context)
 		return NULL;
 
-	rpc_status = ts_rpc_caller_linux_init(&new_context->caller);
-	if (rpc_status != RPC_SUCCESS) {
-		free(new_context);
-		return NULL;
-	}
-
 	memcpy(&new_context->service_uuid, service_uuid, sizeof(new_context->service_uuid));
 
 	new_context->service_context.context = new_context;
@@ -55,44 +58,51 @@ struct linux_ts_service_context *linux_ts_service_context_create(const struct rp
 static struct rpc_caller_session *linux_ts_service_context_open(void *context)
 {
 	struct linux_ts_service_context *this_context = (struct linux_ts_service_context *)context;
-	struct rpc_caller_session *session = NULL;
+	struct linux_ts_service_session *session = NULL;
 	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
 
 	if (!context)
 		return NULL;
 
-	session = (struct rpc_caller_session *)calloc(1, sizeof(struct rpc_caller_session));
+	session = (struct linux_ts_service_session *)calloc(1, sizeof(struct linux_ts_service_session));
 	if (!session)
 		return NULL;
 
-	rpc_status = rpc_caller_session_find_and_open(session, &this_context->caller,
+	rpc_status = ts_rpc_caller_linux_init(&session->caller);
+	if (rpc_status != RPC_SUCCESS) {
+		free(session);
+		return NULL;
+	}
+
+	rpc_status = rpc_caller_session_find_and_open(&session->session, &session->caller,
 						      &this_context->service_uuid, 8192);
 	if (rpc_status != RPC_SUCCESS) {
+		ts_rpc_caller_linux_deinit(&session->caller);
 		free(session);
 		return NULL;
 	}
 
-	return session;
+	return &session->session;
 }
 
 static void linux_ts_service_context_close(void *context, struct rpc_caller_session *session)
 {
+	struct linux_ts_service_session *this_session = (struct linux_ts_service_session *)session;
+
 	(void)context;
 
 	if (!session)
 		return;
 
-	rpc_caller_session_close(session);
-	free(session);
+	rpc_caller_session_close(&this_session->session);
+	ts_rpc_caller_linux_deinit(&this_session->caller);
+	free(this_session);
 }
 
 static void linux_ts_service_context_relinquish(void *context)
 {
-	struct linux_ts_service_context *this_context = (struct linux_ts_service_context *)context;
-
 	if (!context)
 		return;
 
-	ts_rpc_caller_linux_deinit(&this_context->caller);
 	free(context);
 }
\ No newline at end of file
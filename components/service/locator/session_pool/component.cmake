@@ -0,0 +1,23 @@
+#-------------------------------------------------------------------------------
+# Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+#-------------------------------------------------------------------------------
+if (NOT DEFINED TGT)
+	message(FATAL_ERROR "mandatory parameter TGT is not defined.")
+endif()
+
+target_sources(${TGT} PRIVATE
+	"${CMAKE_CURRENT_LIST_DIR}/service_session_pool.c"
+	)
+
+set_property(TARGET ${TGT} APPEND PROPERTY PUBLIC_HEADER
+	"${CMAKE_CURRENT_LIST_DIR}/service_session_pool.h"
+	)
+
+target_include_directories(${TGT} PUBLIC
+	"$<BUILD_INTERFACE:${CMAKE_CURRENT_LIST_DIR}>"
+	"$<INSTALL_INTERFACE:${TS_ENV}/include>"
+	)
+
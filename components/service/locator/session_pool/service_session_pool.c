@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "service_session_pool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+struct service_session_pool_entry {
+	struct rpc_caller_session *session;
+	bool is_acquired;
+};
+
+struct service_session_pool {
+	struct service_context *service_context;
+	pthread_mutex_t mutex;
+	/* Signalled for acquirers when a session is released */
+	pthread_cond_t available;
+	/* Signalled for destroy when the last acquired session is released */
+	pthread_cond_t all_released;
+	unsigned int num_sessions;
+	struct service_session_pool_entry *entries;
+
+	/*
+	 * Indices of the free entries. Used as a stack so that the most
+	 * recently released session, whose shared memory is most likely to
+	 * be cached, is handed out first.
+	 */
+	unsigned int *free_list;
+	unsigned int num_free;
+};
+
+static void close_sessions(struct service_session_pool *pool, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		service_context_close(pool->service_context, pool->entries[i].session);
+}
+
+static void free_pool(struct service_session_pool *pool)
+{
+	free(pool->free_list);
+	free(pool->entries);
+	free(pool);
+}
+
+struct service_session_pool *service_session_pool_create(struct service_context *service_context,
+							 unsigned int num_sessions)
+{
+	struct service_session_pool *pool = NULL;
+	unsigned int i = 0;
+
+	if (!service_context || !num_sessions)
+		return NULL;
+
+	pool = (struct service_session_pool *)calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	pool->service_context = service_context;
+	pool->num_sessions = num_sessions;
+	pool->entries = (struct service_session_pool_entry *)calloc(num_sessions,
+								    sizeof(*pool->entries));
+	pool->free_list = (unsigned int *)calloc(num_sessions, sizeof(*pool->free_list));
+	if (!pool->entries || !pool->free_list) {
+		free_pool(pool);
+		return NULL;
+	}
+
+	for (i = 0; i < num_sessions; i++) {
+		pool->entries[i].session = service_context_open(service_context);
+		if (!pool->entries[i].session)
+			break;
+
+		/* Reversed so that the first session is on top of the stack */
+		pool->free_list[num_sessions - 1 - i] = i;
+	}
+
+	if (i < num_sessions) {
+		close_sessions(pool, i);
+		free_pool(pool);
+		return NULL;
+	}
+
+	pool->num_free = num_sessions;
+
+	if (pthread_mutex_init(&pool->mutex, NULL)) {
+		close_sessions(pool, num_sessions);
+		free_pool(pool);
+		return NULL;
+	}
+
+	if (pthread_cond_init(&pool->available, NULL)) {
+		pthread_mutex_destroy(&pool->mutex);
+		close_sessions(pool, num_sessions);
+		free_pool(pool);
+		return NULL;
+	}
+
+	if (pthread_cond_init(&pool->all_released, NULL)) {
+		pthread_cond_destroy(&pool->available);
+		pthread_mutex_destroy(&pool->mutex);
+		close_sessions(pool, num_sessions);
+		free_pool(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+void service_session_pool_destroy(struct service_session_pool *pool)
+{
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while (pool->num_free < pool->num_sessions)
+		pthread_cond_wait(&pool->all_released, &pool->mutex);
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	close_sessions(pool, pool->num_sessions);
+
+	pthread_cond_destroy(&pool->all_released);
+	pthread_cond_destroy(&pool->available);
+	pthread_mutex_destroy(&pool->mutex);
+	free_pool(pool);
+}
+
+/* Must be called with the mutex held and a free entry available */
+static struct rpc_caller_session *take_session(struct service_session_pool *pool)
+{
+	struct service_session_pool_entry *entry = NULL;
+
+	assert(pool->num_free > 0);
+
+	entry = &pool->entries[pool->free_list[--pool->num_free]];
+	entry->is_acquired = true;
+
+	return entry->session;
+}
+
+struct rpc_caller_session *service_session_pool_acquire(struct service_session_pool *pool)
+{
+	struct rpc_caller_session *session = NULL;
+
+	if (!pool)
+		return NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	while (!pool->num_free)
+		pthread_cond_wait(&pool->available, &pool->mutex);
+
+	session = take_session(pool);
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return session;
+}
+
+struct rpc_caller_session *service_session_pool_try_acquire(struct service_session_pool *pool)
+{
+	struct rpc_caller_session *session = NULL;
+
+	if (!pool)
+		return NULL;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	if (pool->num_free)
+		session = take_session(pool);
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return session;
+}
+
+void service_session_pool_release(struct service_session_pool *pool,
+				  struct rpc_caller_session *session)
+{
+	unsigned int i = 0;
+
+	if (!pool || !session)
+		return;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	for (i = 0; i < pool->num_sessions; i++)
+		if (pool->entries[i].session == session)
+			break;
+
+	/* Sessions of other pools and double releases are ignored */
+	assert(i < pool->num_sessions && pool->entries[i].is_acquired);
+
+	if (i < pool->num_sessions && pool->entries[i].is_acquired) {
+		assert(!session->is_call_transaction_in_progress);
+
+		pool->entries[i].is_acquired = false;
+		pool->free_list[pool->num_free++] = i;
+
+		/*
+		 * Destroy waits on its own condition, so the wakeup of an
+		 * acquirer can't be consumed by a waiting destroy.
+		 */
+		pthread_cond_signal(&pool->available);
+
+		if (pool->num_free == pool->num_sessions)
+			pthread_cond_signal(&pool->all_released);
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+unsigned int service_session_pool_size(const struct service_session_pool *pool)
+{
+	return pool ? pool->num_sessions : 0;
+}
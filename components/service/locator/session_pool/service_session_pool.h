@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef SERVICE_SESSION_POOL_H
+#define SERVICE_SESSION_POOL_H
+
+#include "service_locator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A service_session_pool hands out RPC sessions of a service_context to the
+ * threads of a multi-threaded client.  An rpc_caller_session allows only one
+ * call transaction at a time, so threads that share a session have to
+ * serialize their calls.  The pool opens a fixed number of independent
+ * sessions up front, each with its own session to the service and its own
+ * shared memory, and lends them out one thread at a time.  A session is
+ * only used by the thread that acquired it until it is released, the pool
+ * functions themselves may be called from any thread.
+ */
+struct service_session_pool;
+
+/*
+ * Creates a pool of num_sessions sessions opened with service_context_open.
+ * The service_context must outlive the pool.  Returns NULL if any of the
+ * sessions can't be opened.
+ */
+SERVICE_LOCATOR_EXPORTED struct service_session_pool *service_session_pool_create(
+	struct service_context *service_context, unsigned int num_sessions);
+
+/*
+ * Closes the sessions of the pool and frees it.  Waits for sessions that are
+ * still acquired to be released.
+ */
+SERVICE_LOCATOR_EXPORTED void service_session_pool_destroy(struct service_session_pool *pool);
+
+/*
+ * Acquires a session for exclusive use by the calling thread.  Blocks until a
+ * session is available.
+ */
+SERVICE_LOCATOR_EXPORTED struct rpc_caller_session *service_session_pool_acquire(
+	struct service_session_pool *pool);
+
+/*
+ * Acquires a session without blocking.  Returns NULL if all sessions are in
+ * use.
+ */
+SERVICE_LOCATOR_EXPORTED struct rpc_caller_session *service_session_pool_try_acquire(
+	struct service_session_pool *pool);
+
+/*
+ * Returns an acquired session to the pool.  Any call transaction on the
+ * session must have ended.
+ */
+SERVICE_LOCATOR_EXPORTED void service_session_pool_release(struct service_session_pool *pool,
+							   struct rpc_caller_session *session);
+
+/*
+ * Returns the number of sessions of the pool.
+ */
+SERVICE_LOCATOR_EXPORTED unsigned int service_session_pool_size(
+	const struct service_session_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SERVICE_SESSION_POOL_H */
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "lua_service_context.h"
+#include <service/lua/provider/serializer/packed-c/packedc_lua_serializer.h>
+#include <service/lua/bindings/bench/lua_bench_binding.h>
+
+lua_service_context::lua_service_context(const char *sn) :
+    standalone_service_context(sn),
+    m_lua_provider()
+{
+    /* Bindings outlive re-initialization of the provider, so register them once */
+    lua_provider_register_binding(&m_lua_provider, "bench", lua_bench_binding_open, NULL);
+}
+
+lua_service_context::~lua_service_context()
+{
+
+}
+
+void lua_service_context::do_init()
+{
+    struct rpc_service_interface *lua_ep = lua_provider_init(&m_lua_provider);
+
+    /* Without an RPC interface sessions to the service fail to open */
+    if (lua_ep)
+        lua_provider_register_serializer(&m_lua_provider, packedc_lua_serializer_instance());
+
+    standalone_service_context::set_rpc_interface(lua_ep);
+}
+
+void lua_service_context::do_deinit()
+{
+    lua_provider_deinit(&m_lua_provider);
+}
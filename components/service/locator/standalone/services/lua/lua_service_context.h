@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef STANDALONE_LUA_SERVICE_CONTEXT_H
+#define STANDALONE_LUA_SERVICE_CONTEXT_H
+
+#include <service/locator/standalone/standalone_service_context.h>
+#include <service/lua/provider/lua_provider.h>
+
+/*
+ * Runs the Lua service in-process. Each session gets a direct caller with an
+ * ID of its own, so the provider accounts every session as a separate caller
+ * and at most LUA_MAX_CALLERS sessions can own environments at the same time.
+ */
+class lua_service_context : public standalone_service_context
+{
+public:
+    lua_service_context(const char *sn);
+    virtual ~lua_service_context();
+
+private:
+
+    void do_init();
+    void do_deinit();
+
+    struct lua_provider m_lua_provider;
+};
+
+#endif /* STANDALONE_LUA_SERVICE_CONTEXT_H */
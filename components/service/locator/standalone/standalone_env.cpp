@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2022, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2020-2025, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -14,6 +14,7 @@
 #include <service/locator/standalone/services/fwu/fwu_service_context.h>
 #include <service/locator/standalone/services/smm-variable/smm_variable_service_context.h>
 #include <service/locator/standalone/services/rpmb/rpmb_service_context.h>
+#include <service/locator/standalone/services/lua/lua_service_context.h>
 #include "standalone_location_strategy.h"
 #include "standalone_service_registry.h"
 
@@ -50,5 +51,8 @@ void service_locator_envinit(void)
 	static rpmb_service_context rpmb_context("sn:trustedfirmware.org:rpmb:0");
 	standalone_service_registry::instance()->regsiter_service_instance(&rpmb_context);
 
+	static lua_service_context lua_context("sn:trustedfirmware.org:lua:0");
+	standalone_service_registry::instance()->regsiter_service_instance(&lua_context);
+
 	service_locator_register_strategy(standalone_location_strategy());
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2020-2025, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -18,7 +18,9 @@ standalone_service_context::standalone_service_context(const char *sn) :
 	m_ref_count(0),
 	m_rpc_buffer_size_override(0),
 	m_service_context(),
-	m_rpc_interface(NULL)
+	m_rpc_interface(NULL),
+	m_serialized_interface(),
+	m_call_mutex()
 {
 	m_service_context.context = this;
 	m_service_context.open = standalone_service_context_open;
@@ -33,7 +35,9 @@ standalone_service_context::standalone_service_context(
 	m_ref_count(0),
 	m_rpc_buffer_size_override(rpc_buffer_size_override),
 	m_service_context(),
-	m_rpc_interface(NULL)
+	m_rpc_interface(NULL),
+	m_serialized_interface(),
+	m_call_mutex()
 {
 	m_service_context.context = this;
 	m_service_context.open = standalone_service_context_open;
@@ -68,6 +72,10 @@ struct rpc_caller_session *standalone_service_context::open()
 	struct rpc_caller_interface *caller = NULL;
 	struct rpc_caller_session *session = NULL;
 
+	/* The service failed to initialize */
+	if (!m_rpc_interface)
+		return NULL;
+
 	caller = (struct rpc_caller_interface *)calloc(1, sizeof(struct rpc_caller_interface));
 	if (!caller)
 		return NULL;
@@ -78,14 +86,14 @@ struct rpc_caller_session *standalone_service_context::open()
 		return NULL;
 	}
 
-	status = direct_caller_init(caller, m_rpc_interface);
+	status = direct_caller_init(caller, &m_serialized_interface);
 	if (status != RPC_SUCCESS) {
 		free(caller);
 		free(session);
 		return NULL;
 	}
 
-	status = rpc_caller_session_open(session, caller, &m_rpc_interface->uuid, 0, 0x8000);
+	status = rpc_caller_session_open(session, caller, &m_serialized_interface.uuid, 0, 0x8000);
 	if (status != RPC_SUCCESS) {
 		direct_caller_deinit(caller);
 		free(caller);
@@ -117,6 +125,23 @@ struct service_context *standalone_service_context::get_service_context()
 void standalone_service_context::set_rpc_interface(rpc_service_interface *iface)
 {
 	m_rpc_interface = iface;
+
+	if (!iface)
+		return;
+
+	m_serialized_interface.context = this;
+	m_serialized_interface.uuid = iface->uuid;
+	m_serialized_interface.receive = serialized_receive;
+}
+
+rpc_status_t standalone_service_context::serialized_receive(void *context,
+							    struct rpc_request *request)
+{
+	standalone_service_context *this_context =
+		reinterpret_cast<standalone_service_context*>(context);
+	std::lock_guard<std::mutex> lock(this_context->m_call_mutex);
+
+	return rpc_service_receive(this_context->m_rpc_interface, request);
 }
 
 static struct rpc_caller_session *standalone_service_context_open(void *context)
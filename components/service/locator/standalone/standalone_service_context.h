@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2021, Arm Limited and Contributors. All rights reserved.
+ * Copyright (c) 2020-2025, Arm Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -12,6 +12,7 @@
 #include "rpc/common/caller/rpc_caller_session.h"
 #include "rpc/common/endpoint/rpc_service_interface.h"
 #include "rpc/direct/direct_caller.h"
+#include <mutex>
 #include <string>
 
 class standalone_service_context
@@ -37,11 +38,20 @@ protected:
     virtual void do_deinit() {}
 
 private:
+    static rpc_status_t serialized_receive(void *context, struct rpc_request *request);
+
     std::string m_sn;
     int m_ref_count;
     size_t m_rpc_buffer_size_override;
     struct service_context m_service_context;
     struct rpc_service_interface *m_rpc_interface;
+
+    /*
+     * Sessions call the in-process service through this interface. It holds
+     * the mutex for each call as service providers aren't thread safe.
+     */
+    struct rpc_service_interface m_serialized_interface;
+    std::mutex m_call_mutex;
 };
 
 #endif /* STANDALONE_SERVICE_CONTEXT_H */
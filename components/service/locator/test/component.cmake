@@ -1,5 +1,5 @@
 #-------------------------------------------------------------------------------
-# Copyright (c) 2020, Arm Limited and Contributors. All rights reserved.
+# Copyright (c) 2020-2025, Arm Limited and Contributors. All rights reserved.
 #
 # SPDX-License-Identifier: BSD-3-Clause
 #
@@ -11,4 +11,5 @@ endif()
 target_sources(${TGT} PRIVATE
 	"${CMAKE_CURRENT_LIST_DIR}/sn_tests.cpp"
 	"${CMAKE_CURRENT_LIST_DIR}/service_locator_tests.cpp"
+	"${CMAKE_CURRENT_LIST_DIR}/service_session_pool_tests.cpp"
 	)
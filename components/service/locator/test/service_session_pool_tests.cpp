@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <CppUTest/TestHarness.h>
+#include <atomic>
+#include <service_session_pool.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+struct mock_service {
+	unsigned int num_open;
+	unsigned int max_open;
+};
+
+static rpc_caller_session *mock_open(void *context)
+{
+	struct mock_service *service = (struct mock_service *)context;
+
+	if (service->num_open >= service->max_open)
+		return NULL;
+
+	service->num_open++;
+
+	return (struct rpc_caller_session *)calloc(1, sizeof(struct rpc_caller_session));
+}
+
+static void mock_close(void *context, struct rpc_caller_session *session)
+{
+	struct mock_service *service = (struct mock_service *)context;
+
+	service->num_open--;
+	free(session);
+}
+
+TEST_GROUP(ServiceSessionPoolTests)
+{
+	void setup()
+	{
+		service = { 0, 16 };
+		service_context = { };
+		service_context.context = &service;
+		service_context.open = mock_open;
+		service_context.close = mock_close;
+	}
+
+	struct mock_service service;
+	struct service_context service_context;
+};
+
+TEST(ServiceSessionPoolTests, openFailure)
+{
+	service.max_open = 3;
+
+	POINTERS_EQUAL(NULL, service_session_pool_create(&service_context, 4));
+	UNSIGNED_LONGS_EQUAL(0, service.num_open);
+
+	POINTERS_EQUAL(NULL, service_session_pool_create(&service_context, 0));
+}
+
+TEST(ServiceSessionPoolTests, acquireAndRelease)
+{
+	struct service_session_pool *pool = service_session_pool_create(&service_context, 2);
+	struct rpc_caller_session *first = NULL;
+	struct rpc_caller_session *second = NULL;
+
+	CHECK_TRUE(pool);
+	UNSIGNED_LONGS_EQUAL(2, service.num_open);
+	UNSIGNED_LONGS_EQUAL(2, service_session_pool_size(pool));
+
+	first = service_session_pool_acquire(pool);
+	second = service_session_pool_try_acquire(pool);
+	CHECK_TRUE(first);
+	CHECK_TRUE(second);
+	CHECK_TRUE(first != second);
+
+	/* All sessions are in use */
+	POINTERS_EQUAL(NULL, service_session_pool_try_acquire(pool));
+
+	/* The most recently released session is handed out first */
+	service_session_pool_release(pool, first);
+	POINTERS_EQUAL(first, service_session_pool_try_acquire(pool));
+
+	service_session_pool_release(pool, first);
+	service_session_pool_release(pool, second);
+
+	service_session_pool_destroy(pool);
+	UNSIGNED_LONGS_EQUAL(0, service.num_open);
+}
+
+TEST(ServiceSessionPoolTests, concurrentUse)
+{
+	const unsigned int num_sessions = 4;
+	const unsigned int num_threads = 8;
+	const unsigned int iterations = 1000;
+	struct service_session_pool *pool = service_session_pool_create(&service_context,
+									num_sessions);
+	std::atomic<unsigned int> in_use(0);
+	std::atomic<bool> shared(false);
+	std::atomic<bool> overcommitted(false);
+	std::vector<std::thread> threads;
+
+	CHECK_TRUE(pool);
+
+	/* More threads than sessions, so threads have to wait for each other */
+	for (unsigned int t = 0; t < num_threads; t++)
+		threads.emplace_back([&]() {
+			for (unsigned int i = 0; i < iterations; i++) {
+				struct rpc_caller_session *session =
+					service_session_pool_acquire(pool);
+
+				if (++in_use > num_sessions)
+					overcommitted = true;
+
+				/* A session is never handed to two threads at once */
+				if (session->is_call_transaction_in_progress)
+					shared = true;
+
+				session->is_call_transaction_in_progress = true;
+				std::this_thread::yield();
+				session->is_call_transaction_in_progress = false;
+
+				--in_use;
+				service_session_pool_release(pool, session);
+			}
+		});
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	CHECK_FALSE(shared);
+	CHECK_FALSE(overcommitted);
+
+	service_session_pool_destroy(pool);
+	UNSIGNED_LONGS_EQUAL(0, service.num_open);
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <lauxlib.h>
+#include "service/lua/provider/lua_metrics.h"
+#include "lua_bench_binding.h"
+
+#define DEFAULT_ITERATIONS	(1000)
+
+/*
+ * Histogram of samples in ticks. Values below 2 * SUB_BUCKET_COUNT get their own bucket,
+ * larger ones are split into SUB_BUCKET_COUNT buckets per power of two. Samples above
+ * 2^MAX_VALUE_BITS ticks are clamped.
+ */
+#define SUB_BUCKET_BITS		(5)
+#define SUB_BUCKET_COUNT	(1u << SUB_BUCKET_BITS)
+#define MAX_VALUE_BITS		(40)
+#define BUCKET_COUNT		(2 * SUB_BUCKET_COUNT + \
+				 (MAX_VALUE_BITS - SUB_BUCKET_BITS - 1) * SUB_BUCKET_COUNT)
+
+struct histogram {
+	uint32_t counts[BUCKET_COUNT];
+};
+
+static double ticks_to_ns(double ticks)
+{
+	return ticks * 1e9 / (double)lua_metrics_tick_frequency();
+}
+
+static unsigned int msb_index(uint64_t value)
+{
+	return 63u - (unsigned int)__builtin_clzll(value);
+}
+
+static unsigned int bucket_index(uint64_t ticks)
+{
+	if (ticks < 2 * SUB_BUCKET_COUNT)
+		return (unsigned int)ticks;
+
+	if (ticks >> MAX_VALUE_BITS)
+		ticks = (UINT64_C(1) << MAX_VALUE_BITS) - 1;
+
+	unsigned int shift = msb_index(ticks) - SUB_BUCKET_BITS;
+	unsigned int sub_bucket = (unsigned int)(ticks >> shift) - SUB_BUCKET_COUNT;
+
+	return 2 * SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_COUNT + sub_bucket;
+}
+
+/* The value in the middle of a bucket */
+static double bucket_value(unsigned int index)
+{
+	if (index < 2 * SUB_BUCKET_COUNT)
+		return (double)index;
+
+	unsigned int shift = (index - 2 * SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT + 1;
+	unsigned int sub_bucket = (index - 2 * SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+	uint64_t lower = (uint64_t)(SUB_BUCKET_COUNT + sub_bucket) << shift;
+
+	return (double)lower + (double)(UINT64_C(1) << shift) / 2.0;
+}
+
+/* The value below which the given fraction of samples lies */
+static double percentile(const struct histogram *histogram, uint64_t count, double fraction)
+{
+	uint64_t rank = (uint64_t)(fraction * (double)count + 0.999999);
+	uint64_t seen = 0;
+
+	if (rank == 0)
+		rank = 1;
+
+	for (unsigned int i = 0; i < BUCKET_COUNT; i++) {
+		seen += histogram->counts[i];
+		if (seen >= rank)
+			return bucket_value(i);
+	}
+
+	return 0.0;
+}
+
+/* The smallest difference between two back to back counter reads */
+static uint64_t timer_overhead(void)
+{
+	uint64_t overhead = UINT64_MAX;
+
+	for (int i = 0; i < 16; i++) {
+		uint64_t start = lua_metrics_ticks();
+		uint64_t delta = lua_metrics_ticks() - start;
+
+		if (delta < overhead)
+			overhead = delta;
+	}
+
+	return overhead;
+}
+
+static void set_field(lua_State *L, const char *name, double value)
+{
+	lua_pushnumber(L, value);
+	lua_setfield(L, -2, name);
+}
+
+static int ticks(lua_State *L)
+{
+	lua_pushinteger(L, (lua_Integer)lua_metrics_ticks());
+
+	return 1;
+}
+
+static int frequency(lua_State *L)
+{
+	lua_pushinteger(L, (lua_Integer)lua_metrics_tick_frequency());
+
+	return 1;
+}
+
+static int now(lua_State *L)
+{
+	uint64_t t = lua_metrics_ticks();
+	uint64_t f = lua_metrics_tick_frequency();
+
+	/* Split the conversion so it doesn't overflow */
+	lua_pushinteger(L, (lua_Integer)((t / f) * 1000000000u + ((t % f) * 1000000000u) / f));
+
+	return 1;
+}
+
+/* State of a run, kept in a userdata so that the loop can continue after fn yields */
+struct bench_run {
+	struct histogram histogram;
+	lua_Integer iterations;
+	lua_Integer done;
+	/* calls that were suspended by the instruction budget, they have no sample */
+	lua_Integer suspended;
+	uint64_t start;
+	uint64_t min;
+	uint64_t max;
+	double sum;
+};
+
+static void add_sample(struct bench_run *state, uint64_t sample)
+{
+	if (sample < state->min)
+		state->min = sample;
+	if (sample > state->max)
+		state->max = sample;
+	state->sum += (double)sample;
+
+	state->histogram.counts[bucket_index(sample)]++;
+}
+
+static int run_continue(lua_State *L, int status, lua_KContext ctx);
+
+/*
+ * Call fn until all iterations are done, then return the statistics. fn is called with
+ * lua_callk, so the instruction budget can suspend the script while fn runs and the loop
+ * continues in run_continue when the script is resumed.
+ */
+static int run_loop(lua_State *L, struct bench_run *state)
+{
+	while (state->done < state->iterations) {
+		lua_pushvalue(L, 1);
+
+		state->start = lua_metrics_ticks();
+		lua_callk(L, 0, 0, 0, run_continue);
+		add_sample(state, lua_metrics_ticks() - state->start);
+		state->done++;
+	}
+
+	lua_Integer samples = state->done - state->suspended;
+
+	lua_createtable(L, 0, 8);
+	lua_pushinteger(L, state->iterations);
+	lua_setfield(L, -2, "iterations");
+	lua_pushinteger(L, state->suspended);
+	lua_setfield(L, -2, "suspended");
+
+	if (samples > 0) {
+		set_field(L, "min", ticks_to_ns((double)state->min));
+		set_field(L, "max", ticks_to_ns((double)state->max));
+		set_field(L, "mean", ticks_to_ns(state->sum / (double)samples));
+		set_field(L, "median", ticks_to_ns(percentile(&state->histogram,
+							      (uint64_t)samples, 0.5)));
+		set_field(L, "p99", ticks_to_ns(percentile(&state->histogram,
+							   (uint64_t)samples, 0.99)));
+	}
+
+	set_field(L, "overhead", ticks_to_ns((double)timer_overhead()));
+
+	return 1;
+}
+
+/* Continue the loop after the script was suspended in fn */
+static int run_continue(lua_State *L, int status, lua_KContext ctx)
+{
+	struct bench_run *state = (struct bench_run *)lua_touserdata(L, 3);
+
+	(void)status;
+	(void)ctx;
+
+	/* The call took as long as the script was suspended, that's no sample */
+	state->suspended++;
+	state->done++;
+
+	return run_loop(L, state);
+}
+
+static int run(lua_State *L)
+{
+	luaL_checktype(L, 1, LUA_TFUNCTION);
+
+	lua_Integer iterations = luaL_optinteger(L, 2, DEFAULT_ITERATIONS);
+
+	luaL_argcheck(L, iterations > 0, 2, "must be positive");
+
+	/* Held by the Lua GC so it's released if fn raises an error, at index 3 */
+	lua_settop(L, 2);
+	struct bench_run *state =
+		(struct bench_run *)lua_newuserdatauv(L, sizeof(struct bench_run), 0);
+	memset(state, 0, sizeof(*state));
+	state->iterations = iterations;
+	state->min = UINT64_MAX;
+
+	return run_loop(L, state);
+}
+
+int lua_bench_binding_open(lua_State *L)
+{
+	static const luaL_Reg functions[] = {
+		{ "ticks", ticks },
+		{ "frequency", frequency },
+		{ "now", now },
+		{ "run", run },
+		{ NULL, NULL }
+	};
+
+	luaL_newlib(L, functions);
+
+	return 1;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_BENCH_BINDING_H
+#define LUA_BENCH_BINDING_H
+
+#include <lua.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Open the bench binding
+ *
+ * lua_CFunction to be registered with lua_provider_register_binding. The
+ * binding context is unused. Time is read from the architectural counter on
+ * aarch64 and from the monotonic clock elsewhere. The module provides:
+ *
+ *   ticks()                      -> raw counter value
+ *   frequency()                  -> counter ticks per second
+ *   now()                        -> monotonic time in nanoseconds
+ *   run(fn [, iterations])       -> statistics table
+ *
+ * run calls fn the given number of times, 1000 by default, and returns the
+ * fields iterations, min, max, mean, median, p99 and overhead in
+ * nanoseconds. overhead is the cost of a back-to-back counter read, which
+ * is included in every sample. min, max and mean are exact; median and p99
+ * come from a log-linear histogram with about 1.6% relative error so that
+ * memory use doesn't depend on the number of iterations. fn is subject to
+ * the instruction budget of the script. A call of fn during which the script
+ * was suspended is counted in the field suspended and gives no sample; the
+ * statistics are missing if every call was suspended.
+ */
+int lua_bench_binding_open(lua_State *L);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_BENCH_BINDING_H */
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <lauxlib.h>
+#include "common/uuid/uuid.h"
+#include "service/block_storage/block_store/block_store.h"
+#include "lua_block_store_binding.h"
+
+/* The Lua SP is the only client of the block store */
+#define LUA_BLOCK_STORE_CLIENT_ID	(0)
+
+static struct block_store *get_block_store(lua_State *L)
+{
+	return (struct block_store *)lua_touserdata(L, lua_upvalueindex(1));
+}
+
+static int push_error(lua_State *L, psa_status_t status)
+{
+	lua_pushnil(L);
+	lua_pushinteger(L, status);
+
+	return 2;
+}
+
+static void check_guid(lua_State *L, int arg, struct uuid_octets *guid)
+{
+	const char *canonical_form = luaL_checkstring(L, arg);
+
+	luaL_argcheck(L, uuid_parse_to_guid_octets(canonical_form, guid->octets,
+						  sizeof(guid->octets)),
+		      arg, "invalid GUID");
+}
+
+static lua_Integer check_unsigned(lua_State *L, int arg)
+{
+	lua_Integer value = luaL_checkinteger(L, arg);
+
+	luaL_argcheck(L, value >= 0, arg, "must not be negative");
+
+	return value;
+}
+
+static int partition_info(lua_State *L)
+{
+	struct storage_partition_info info = { 0 };
+	struct uuid_octets guid;
+
+	check_guid(L, 1, &guid);
+
+	psa_status_t status = block_store_get_partition_info(get_block_store(L), &guid, &info);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushinteger(L, (lua_Integer)info.num_blocks);
+	lua_pushinteger(L, (lua_Integer)info.block_size);
+
+	return 2;
+}
+
+static int open_partition(lua_State *L)
+{
+	storage_partition_handle_t handle = 0;
+	struct uuid_octets guid;
+
+	check_guid(L, 1, &guid);
+
+	psa_status_t status = block_store_open(get_block_store(L), LUA_BLOCK_STORE_CLIENT_ID,
+					       &guid, &handle);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushinteger(L, handle);
+
+	return 1;
+}
+
+static int close_partition(lua_State *L)
+{
+	storage_partition_handle_t handle = (storage_partition_handle_t)check_unsigned(L, 1);
+
+	psa_status_t status = block_store_close(get_block_store(L), LUA_BLOCK_STORE_CLIENT_ID,
+						handle);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushboolean(L, 1);
+
+	return 1;
+}
+
+static int read_block(lua_State *L)
+{
+	storage_partition_handle_t handle = (storage_partition_handle_t)check_unsigned(L, 1);
+	uint64_t lba = (uint64_t)check_unsigned(L, 2);
+	size_t offset = (size_t)check_unsigned(L, 3);
+	size_t len = (size_t)check_unsigned(L, 4);
+	size_t data_len = 0;
+	luaL_Buffer data;
+
+	/* Read straight into the string buffer */
+	uint8_t *buffer = (uint8_t *)luaL_buffinitsize(L, &data, len);
+
+	psa_status_t status = block_store_read(get_block_store(L), LUA_BLOCK_STORE_CLIENT_ID,
+					       handle, lba, offset, len, buffer, &data_len);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	luaL_pushresultsize(&data, data_len);
+
+	return 1;
+}
+
+static int write_block(lua_State *L)
+{
+	storage_partition_handle_t handle = (storage_partition_handle_t)check_unsigned(L, 1);
+	uint64_t lba = (uint64_t)check_unsigned(L, 2);
+	size_t offset = (size_t)check_unsigned(L, 3);
+	size_t data_len = 0;
+	const char *data = luaL_checklstring(L, 4, &data_len);
+	size_t num_written = 0;
+
+	psa_status_t status = block_store_write(get_block_store(L), LUA_BLOCK_STORE_CLIENT_ID,
+						handle, lba, offset, (const uint8_t *)data,
+						data_len, &num_written);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushinteger(L, (lua_Integer)num_written);
+
+	return 1;
+}
+
+static int erase_blocks(lua_State *L)
+{
+	storage_partition_handle_t handle = (storage_partition_handle_t)check_unsigned(L, 1);
+	uint64_t begin_lba = (uint64_t)check_unsigned(L, 2);
+	size_t num_blocks = (size_t)check_unsigned(L, 3);
+
+	psa_status_t status = block_store_erase(get_block_store(L), LUA_BLOCK_STORE_CLIENT_ID,
+						handle, begin_lba, num_blocks);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushboolean(L, 1);
+
+	return 1;
+}
+
+int lua_block_store_binding_open(lua_State *L)
+{
+	static const luaL_Reg functions[] = {
+		{ "partition_info", partition_info },
+		{ "open", open_partition },
+		{ "close", close_partition },
+		{ "read", read_block },
+		{ "write", write_block },
+		{ "erase", erase_blocks },
+		{ NULL, NULL }
+	};
+
+	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+
+	/* Every function gets the block_store as its upvalue */
+	luaL_newlibtable(L, functions);
+	lua_pushvalue(L, 1);
+	luaL_setfuncs(L, functions, 1);
+
+	return 1;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_BLOCK_STORE_BINDING_H
+#define LUA_BLOCK_STORE_BINDING_H
+
+#include <lua.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Open the block_store binding
+ *
+ * lua_CFunction to be registered with lua_provider_register_binding. The
+ * binding context must point to a struct block_store. The module provides:
+ *
+ *   partition_info(guid)                 -> num_blocks, block_size
+ *   open(guid)                           -> handle
+ *   close(handle)                        -> true
+ *   read(handle, lba, offset, len)       -> data
+ *   write(handle, lba, offset, data)     -> num_written
+ *   erase(handle, begin_lba, num_blocks) -> true
+ *
+ * Partition GUIDs are given in canonical form. On failure functions return
+ * nil and the PSA status code.
+ */
+int lua_block_store_binding_open(lua_State *L);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_BLOCK_STORE_BINDING_H */
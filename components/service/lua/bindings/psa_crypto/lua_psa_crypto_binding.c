@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <lauxlib.h>
+#include "psa/crypto.h"
+#include "lua_psa_crypto_binding.h"
+
+static int push_error(lua_State *L, psa_status_t status)
+{
+	lua_pushnil(L);
+	lua_pushinteger(L, status);
+
+	return 2;
+}
+
+static uint32_t check_uint32(lua_State *L, int arg)
+{
+	lua_Integer value = luaL_checkinteger(L, arg);
+
+	luaL_argcheck(L, value >= 0 && value <= UINT32_MAX, arg, "out of range");
+
+	return (uint32_t)value;
+}
+
+static int hash_compute(lua_State *L)
+{
+	psa_algorithm_t alg = check_uint32(L, 1);
+	size_t input_len = 0;
+	const char *input = luaL_checklstring(L, 2, &input_len);
+	uint8_t hash[PSA_HASH_MAX_SIZE];
+	size_t hash_len = 0;
+
+	psa_status_t status = psa_hash_compute(alg, (const uint8_t *)input, input_len, hash,
+					       sizeof(hash), &hash_len);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushlstring(L, (const char *)hash, hash_len);
+
+	return 1;
+}
+
+static int hash_compare(lua_State *L)
+{
+	psa_algorithm_t alg = check_uint32(L, 1);
+	size_t input_len = 0;
+	const char *input = luaL_checklstring(L, 2, &input_len);
+	size_t hash_len = 0;
+	const char *hash = luaL_checklstring(L, 3, &hash_len);
+
+	psa_status_t status = psa_hash_compare(alg, (const uint8_t *)input, input_len,
+					       (const uint8_t *)hash, hash_len);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushboolean(L, 1);
+
+	return 1;
+}
+
+static int generate_random(lua_State *L)
+{
+	lua_Integer len = luaL_checkinteger(L, 1);
+	luaL_Buffer data;
+
+	luaL_argcheck(L, len >= 0, 1, "must not be negative");
+
+	uint8_t *buffer = (uint8_t *)luaL_buffinitsize(L, &data, (size_t)len);
+
+	psa_status_t status = psa_generate_random(buffer, (size_t)len);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	luaL_pushresultsize(&data, (size_t)len);
+
+	return 1;
+}
+
+static int import_key(lua_State *L)
+{
+	psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
+	psa_key_id_t key_id = PSA_KEY_ID_NULL;
+	size_t data_len = 0;
+
+	psa_set_key_type(&attributes, (psa_key_type_t)check_uint32(L, 1));
+	psa_set_key_usage_flags(&attributes, check_uint32(L, 2));
+	psa_set_key_algorithm(&attributes, check_uint32(L, 3));
+
+	const char *data = luaL_checklstring(L, 4, &data_len);
+
+	psa_status_t status = psa_import_key(&attributes, (const uint8_t *)data, data_len,
+					     &key_id);
+	psa_reset_key_attributes(&attributes);
+
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushinteger(L, key_id);
+
+	return 1;
+}
+
+static int generate_key(lua_State *L)
+{
+	psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
+	psa_key_id_t key_id = PSA_KEY_ID_NULL;
+
+	psa_set_key_type(&attributes, (psa_key_type_t)check_uint32(L, 1));
+	psa_set_key_bits(&attributes, check_uint32(L, 2));
+	psa_set_key_usage_flags(&attributes, check_uint32(L, 3));
+	psa_set_key_algorithm(&attributes, check_uint32(L, 4));
+
+	psa_status_t status = psa_generate_key(&attributes, &key_id);
+	psa_reset_key_attributes(&attributes);
+
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushinteger(L, key_id);
+
+	return 1;
+}
+
+static int destroy_key(lua_State *L)
+{
+	psa_status_t status = psa_destroy_key(check_uint32(L, 1));
+
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushboolean(L, 1);
+
+	return 1;
+}
+
+static int mac_compute(lua_State *L)
+{
+	psa_key_id_t key_id = check_uint32(L, 1);
+	psa_algorithm_t alg = check_uint32(L, 2);
+	size_t input_len = 0;
+	const char *input = luaL_checklstring(L, 3, &input_len);
+	uint8_t mac[PSA_MAC_MAX_SIZE];
+	size_t mac_len = 0;
+
+	psa_status_t status = psa_mac_compute(key_id, alg, (const uint8_t *)input, input_len,
+					      mac, sizeof(mac), &mac_len);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushlstring(L, (const char *)mac, mac_len);
+
+	return 1;
+}
+
+static int sign_hash(lua_State *L)
+{
+	psa_key_id_t key_id = check_uint32(L, 1);
+	psa_algorithm_t alg = check_uint32(L, 2);
+	size_t hash_len = 0;
+	const char *hash = luaL_checklstring(L, 3, &hash_len);
+	size_t signature_len = 0;
+	luaL_Buffer signature;
+
+	/* The largest signature size may be too big for the stack */
+	uint8_t *buffer = (uint8_t *)luaL_buffinitsize(L, &signature, PSA_SIGNATURE_MAX_SIZE);
+
+	psa_status_t status = psa_sign_hash(key_id, alg, (const uint8_t *)hash, hash_len,
+					    buffer, PSA_SIGNATURE_MAX_SIZE, &signature_len);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	luaL_pushresultsize(&signature, signature_len);
+
+	return 1;
+}
+
+static int verify_hash(lua_State *L)
+{
+	psa_key_id_t key_id = check_uint32(L, 1);
+	psa_algorithm_t alg = check_uint32(L, 2);
+	size_t hash_len = 0;
+	const char *hash = luaL_checklstring(L, 3, &hash_len);
+	size_t signature_len = 0;
+	const char *signature = luaL_checklstring(L, 4, &signature_len);
+
+	psa_status_t status = psa_verify_hash(key_id, alg, (const uint8_t *)hash, hash_len,
+					      (const uint8_t *)signature, signature_len);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushboolean(L, 1);
+
+	return 1;
+}
+
+int lua_psa_crypto_binding_open(lua_State *L)
+{
+	static const luaL_Reg functions[] = {
+		{ "hash_compute", hash_compute },
+		{ "hash_compare", hash_compare },
+		{ "generate_random", generate_random },
+		{ "import_key", import_key },
+		{ "generate_key", generate_key },
+		{ "destroy_key", destroy_key },
+		{ "mac_compute", mac_compute },
+		{ "sign_hash", sign_hash },
+		{ "verify_hash", verify_hash },
+		{ NULL, NULL }
+	};
+
+	static const struct {
+		const char *name;
+		uint32_t value;
+	} constants[] = {
+		{ "ALG_SHA_256", PSA_ALG_SHA_256 },
+		{ "ALG_SHA_384", PSA_ALG_SHA_384 },
+		{ "ALG_SHA_512", PSA_ALG_SHA_512 },
+		{ "ALG_HMAC_SHA_256", PSA_ALG_HMAC(PSA_ALG_SHA_256) },
+		{ "ALG_ECDSA_SHA_256", PSA_ALG_ECDSA(PSA_ALG_SHA_256) },
+		{ "KEY_TYPE_HMAC", PSA_KEY_TYPE_HMAC },
+		{ "KEY_TYPE_AES", PSA_KEY_TYPE_AES },
+		{ "KEY_TYPE_ECC_KEY_PAIR_SECP_R1",
+		  PSA_KEY_TYPE_ECC_KEY_PAIR(PSA_ECC_FAMILY_SECP_R1) },
+		{ "KEY_USAGE_EXPORT", PSA_KEY_USAGE_EXPORT },
+		{ "KEY_USAGE_ENCRYPT", PSA_KEY_USAGE_ENCRYPT },
+		{ "KEY_USAGE_DECRYPT", PSA_KEY_USAGE_DECRYPT },
+		{ "KEY_USAGE_SIGN_HASH", PSA_KEY_USAGE_SIGN_HASH },
+		{ "KEY_USAGE_VERIFY_HASH", PSA_KEY_USAGE_VERIFY_HASH },
+		{ "KEY_USAGE_SIGN_MESSAGE", PSA_KEY_USAGE_SIGN_MESSAGE },
+		{ "KEY_USAGE_VERIFY_MESSAGE", PSA_KEY_USAGE_VERIFY_MESSAGE },
+	};
+
+	luaL_newlibtable(L, functions);
+	luaL_setfuncs(L, functions, 0);
+
+	for (size_t i = 0; i < sizeof(constants) / sizeof(constants[0]); i++) {
+		lua_pushinteger(L, constants[i].value);
+		lua_setfield(L, -2, constants[i].name);
+	}
+
+	return 1;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_PSA_CRYPTO_BINDING_H
+#define LUA_PSA_CRYPTO_BINDING_H
+
+#include <lua.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Open the PSA crypto binding
+ *
+ * lua_CFunction to be registered with lua_provider_register_binding. The
+ * binding calls the PSA crypto API directly, so the deployment must have
+ * initialized the PSA crypto client. The binding context is unused. The
+ * module provides:
+ *
+ *   hash_compute(alg, input)               -> hash
+ *   hash_compare(alg, input, hash)         -> true
+ *   generate_random(len)                   -> data
+ *   import_key(type, usage, alg, data)     -> key_id
+ *   generate_key(type, bits, usage, alg)   -> key_id
+ *   destroy_key(key_id)                    -> true
+ *   mac_compute(key_id, alg, input)        -> mac
+ *   sign_hash(key_id, alg, hash)           -> signature
+ *   verify_hash(key_id, alg, hash, sig)    -> true
+ *
+ * and constants for common algorithms, key types and usage flags, e.g.
+ * ALG_SHA_256 or KEY_USAGE_SIGN_HASH. On failure functions return nil and
+ * the PSA status code.
+ */
+int lua_psa_crypto_binding_open(lua_State *L);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_PSA_CRYPTO_BINDING_H */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <lauxlib.h>
+#include "service/secure_storage/backend/storage_backend.h"
+#include "lua_secure_storage_binding.h"
+
+/* The Lua SP is the only client of the storage backend */
+#define LUA_STORAGE_CLIENT_ID	(0)
+
+static struct storage_backend *get_backend(lua_State *L)
+{
+	return (struct storage_backend *)lua_touserdata(L, lua_upvalueindex(1));
+}
+
+static int push_error(lua_State *L, psa_status_t status)
+{
+	lua_pushnil(L);
+	lua_pushinteger(L, status);
+
+	return 2;
+}
+
+static int push_result(lua_State *L, psa_status_t status)
+{
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushboolean(L, 1);
+
+	return 1;
+}
+
+static uint64_t check_uid(lua_State *L, int arg)
+{
+	/* Any 64-bit pattern is a valid uid */
+	return (uint64_t)luaL_checkinteger(L, arg);
+}
+
+static size_t opt_size(lua_State *L, int arg, size_t def)
+{
+	lua_Integer value = luaL_optinteger(L, arg, (lua_Integer)def);
+
+	luaL_argcheck(L, value >= 0, arg, "must not be negative");
+
+	return (size_t)value;
+}
+
+static int set(lua_State *L)
+{
+	struct storage_backend *backend = get_backend(L);
+	uint64_t uid = check_uid(L, 1);
+	size_t data_len = 0;
+	const char *data = luaL_checklstring(L, 2, &data_len);
+	uint32_t flags = (uint32_t)luaL_optinteger(L, 3, PSA_STORAGE_FLAG_NONE);
+
+	return push_result(L, backend->interface->set(backend->context, LUA_STORAGE_CLIENT_ID,
+						      uid, data_len, data, flags));
+}
+
+static int set_extended(lua_State *L)
+{
+	struct storage_backend *backend = get_backend(L);
+	uint64_t uid = check_uid(L, 1);
+	size_t offset = opt_size(L, 2, 0);
+	size_t data_len = 0;
+	const char *data = luaL_checklstring(L, 3, &data_len);
+
+	return push_result(L, backend->interface->set_extended(backend->context,
+							       LUA_STORAGE_CLIENT_ID, uid,
+							       offset, data_len, data));
+}
+
+static int create(lua_State *L)
+{
+	struct storage_backend *backend = get_backend(L);
+	uint64_t uid = check_uid(L, 1);
+	size_t capacity = opt_size(L, 2, 0);
+	uint32_t flags = (uint32_t)luaL_optinteger(L, 3, PSA_STORAGE_FLAG_NONE);
+
+	return push_result(L, backend->interface->create(backend->context, LUA_STORAGE_CLIENT_ID,
+							 uid, capacity, flags));
+}
+
+static int get(lua_State *L)
+{
+	struct storage_backend *backend = get_backend(L);
+	uint64_t uid = check_uid(L, 1);
+	size_t offset = opt_size(L, 2, 0);
+	size_t len = 0;
+	size_t data_len = 0;
+	luaL_Buffer data;
+
+	if (lua_isnoneornil(L, 3)) {
+		struct psa_storage_info_t info = { 0 };
+		psa_status_t status = backend->interface->get_info(backend->context,
+								   LUA_STORAGE_CLIENT_ID, uid,
+								   &info);
+		if (status != PSA_SUCCESS)
+			return push_error(L, status);
+
+		len = (info.size > offset) ? info.size - offset : 0;
+	} else {
+		len = opt_size(L, 3, 0);
+	}
+
+	/* Read straight into the string buffer */
+	void *buffer = luaL_buffinitsize(L, &data, len);
+
+	psa_status_t status = backend->interface->get(backend->context, LUA_STORAGE_CLIENT_ID, uid,
+						      offset, len, buffer, &data_len);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	luaL_pushresultsize(&data, data_len);
+
+	return 1;
+}
+
+static int get_info(lua_State *L)
+{
+	struct storage_backend *backend = get_backend(L);
+	struct psa_storage_info_t info = { 0 };
+
+	psa_status_t status = backend->interface->get_info(backend->context, LUA_STORAGE_CLIENT_ID,
+							   check_uid(L, 1), &info);
+	if (status != PSA_SUCCESS)
+		return push_error(L, status);
+
+	lua_pushinteger(L, info.size);
+	lua_pushinteger(L, info.capacity);
+	lua_pushinteger(L, info.flags);
+
+	return 3;
+}
+
+static int remove_object(lua_State *L)
+{
+	struct storage_backend *backend = get_backend(L);
+
+	return push_result(L, backend->interface->remove(backend->context, LUA_STORAGE_CLIENT_ID,
+							 check_uid(L, 1)));
+}
+
+int lua_secure_storage_binding_open(lua_State *L)
+{
+	static const luaL_Reg functions[] = {
+		{ "set", set },
+		{ "set_extended", set_extended },
+		{ "create", create },
+		{ "get", get },
+		{ "get_info", get_info },
+		{ "remove", remove_object },
+		{ NULL, NULL }
+	};
+
+	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+
+	/* Every function gets the storage_backend as its upvalue */
+	luaL_newlibtable(L, functions);
+	lua_pushvalue(L, 1);
+	luaL_setfuncs(L, functions, 1);
+
+	return 1;
+}
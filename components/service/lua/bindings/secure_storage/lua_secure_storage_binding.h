@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_SECURE_STORAGE_BINDING_H
+#define LUA_SECURE_STORAGE_BINDING_H
+
+#include <lua.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Open the secure storage binding
+ *
+ * lua_CFunction to be registered with lua_provider_register_binding. The
+ * binding context must point to a struct storage_backend. The module
+ * provides:
+ *
+ *   set(uid, data [, flags])              -> true
+ *   set_extended(uid, offset, data)       -> true
+ *   create(uid, capacity [, flags])       -> true
+ *   get(uid [, offset [, len]])           -> data
+ *   get_info(uid)                         -> size, capacity, flags
+ *   remove(uid)                           -> true
+ *
+ * get returns the object from offset to its end if len is omitted. On
+ * failure functions return nil and the PSA status code.
+ */
+int lua_secure_storage_binding_open(lua_State *L);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_SECURE_STORAGE_BINDING_H */
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <lua.h>
+#include <lauxlib.h>
+
+#include "lua_compiler.h"
+
+struct bytecode_writer {
+	uint8_t *buf;
+	size_t len;
+	size_t size;
+	bool failed;
+};
+
+static int write_bytecode(lua_State *L, const void *p, size_t sz, void *ud)
+{
+	struct bytecode_writer *writer = (struct bytecode_writer *)ud;
+
+	(void)L;
+
+	if (writer->len + sz > writer->size) {
+		size_t new_size = writer->size ? writer->size : 1024;
+		uint8_t *tmp = NULL;
+
+		while (new_size < writer->len + sz)
+			new_size *= 2;
+
+		tmp = (uint8_t *)realloc(writer->buf, new_size);
+		if (!tmp) {
+			writer->failed = true;
+			return 1;
+		}
+
+		writer->buf = tmp;
+		writer->size = new_size;
+	}
+
+	memcpy(&writer->buf[writer->len], p, sz);
+	writer->len += sz;
+
+	return 0;
+}
+
+lua_status_t lua_compile_script(const char *script, size_t script_len, bool strip,
+				uint8_t **bytecode, size_t *bytecode_len,
+				size_t error_msg_buf_size, char *error_msg_buf)
+{
+	struct bytecode_writer writer = { 0 };
+	lua_status_t lua_status = LUA_SUCCESS;
+	lua_State *L = NULL;
+
+	*bytecode = NULL;
+	*bytecode_len = 0;
+
+	if (error_msg_buf && error_msg_buf_size)
+		error_msg_buf[0] = '\0';
+
+	L = luaL_newstate();
+	if (!L)
+		return LUA_ERROR_OUT_OF_MEMORY;
+
+	if (luaL_loadbufferx(L, script, script_len, "=script", "t") != LUA_OK) {
+		const char *msg = lua_tostring(L, -1);
+
+		if (msg && error_msg_buf && error_msg_buf_size) {
+			strncpy(error_msg_buf, msg, error_msg_buf_size - 1);
+			error_msg_buf[error_msg_buf_size - 1] = '\0';
+		}
+
+		lua_close(L);
+
+		return LUA_ERROR_PARSER_ERROR;
+	}
+
+	if (lua_dump(L, write_bytecode, &writer, strip) != 0 || writer.failed) {
+		free(writer.buf);
+		lua_status = LUA_ERROR_OUT_OF_MEMORY;
+	} else {
+		*bytecode = writer.buf;
+		*bytecode_len = writer.len;
+	}
+
+	lua_close(L);
+
+	return lua_status;
+}
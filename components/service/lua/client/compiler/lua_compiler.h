@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_COMPILER_H
+#define LUA_COMPILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "protocols/service/lua/status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Compile a Lua script to bytecode
+ *
+ * Host side helper that compiles a script with the Lua library linked into the
+ * client. The resulting bytecode can be uploaded with env_append_bytecode, so the
+ * Lua SP doesn't have to parse the script. The client's Lua version and number
+ * formats must match the SP's.
+ *
+ * \param[in]  script          Script source
+ * \param[in]  script_len      Length of the script source
+ * \param[in]  strip           Strip debug information from the bytecode
+ * \param[out] bytecode        Compiled bytecode, must be released with free()
+ * \param[out] bytecode_len    Length of the bytecode
+ * \param[in]  error_msg_buf_size  Size of input buffer for storing error message
+ * \param[out] error_msg_buf   Buffer for the parser's error message, may be NULL
+ *
+ * \return LUA_SUCCESS on success, LUA_ERROR_PARSER_ERROR if the script doesn't
+ *         compile or LUA_ERROR_OUT_OF_MEMORY
+ */
+lua_status_t lua_compile_script(const char *script, size_t script_len, bool strip,
+				uint8_t **bytecode, size_t *bytecode_len,
+				size_t error_msg_buf_size, char *error_msg_buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LUA_COMPILER_H */
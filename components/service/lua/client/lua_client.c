@@ -66,6 +66,60 @@ lua_status_t env_create(void *context, int32_t *env_index)
 	return lua_status;
 }
 
+/*
+ * Create an environment that inherits the globals of a template environment.
+ */
+lua_status_t env_clone(void *context, int32_t template_index, int32_t *env_index)
+{
+	struct lua_client *this_context = (struct lua_client *)context;
+	lua_status_t lua_status = LUA_ERROR_GENERIC_ERROR;
+	struct ts_lua_env_clone_in req_msg = {0};
+	size_t req_len = sizeof(req_msg);
+	uint8_t *req_buf = NULL;
+
+	*env_index = -1;
+	req_msg.template_index = template_index;
+
+	rpc_call_handle call_handle =
+		rpc_caller_session_begin(this_context->client.session, &req_buf, req_len,
+					sizeof(struct ts_lua_env_create_out));
+
+	if (call_handle) {
+		uint8_t *resp_buf = NULL;
+		size_t resp_len = 0;
+		service_status_t service_status = 0;
+
+		memcpy(req_buf, &req_msg, req_len);
+
+		this_context->client.rpc_status = rpc_caller_session_invoke(
+			call_handle, TS_LUA_OPCODE_ENV_CLONE, &resp_buf, &resp_len,
+			&service_status);
+
+		if (this_context->client.rpc_status == RPC_SUCCESS) {
+			lua_status = service_status;
+
+			if (lua_status == LUA_SUCCESS) {
+				if (resp_len == sizeof(struct ts_lua_env_create_out)) {
+					struct ts_lua_env_create_out resp_msg;
+
+					memcpy(&resp_msg, resp_buf, sizeof(resp_msg));
+
+					*env_index = resp_msg.env_index;
+				} else {
+					/* Failed to decode response message */
+					lua_status = LUA_ERROR_GENERIC_ERROR;
+				}
+			}
+		}
+
+		rpc_caller_session_end(call_handle);
+	} else {
+		this_context->client.rpc_status = RPC_ERROR_INTERNAL;
+	}
+
+	return lua_status;
+}
+
 /*
  * Append script bytes to the specified environment's script buffer.
  * This will be passed to Lua for parsing and interpretation by calling env_execute.
@@ -113,30 +167,285 @@ lua_status_t env_append(void *context,
 	return lua_status;
 }
 
+/*
+ * Append precompiled bytecode (lua_dump output) to the specified environment's script buffer.
+ * The environment's script buffer must be empty or hold bytecode from earlier calls.
+ */
+lua_status_t env_append_bytecode(void *context,
+	int32_t env_index,
+	const uint8_t *bytecode,
+	size_t bytecode_len)
+{
+	struct lua_client *this_context = (struct lua_client *)context;
+	lua_status_t lua_status = LUA_ERROR_GENERIC_ERROR;
+	struct ts_lua_env_append_bytecode_in req_msg = {0};
+	size_t req_len = sizeof(req_msg) + bytecode_len;
+	uint8_t *req_buf = NULL;
+
+	req_msg.env_index = env_index;
+
+	rpc_call_handle call_handle =
+		rpc_caller_session_begin(this_context->client.session, &req_buf, req_len, 0);
+
+	if (call_handle) {
+		uint8_t *resp_buf = NULL;
+		size_t resp_len = 0;
+		service_status_t service_status = 0;
+
+		/* Copy fixed size message */
+		memcpy(req_buf, &req_msg, sizeof(req_msg));
+
+		/* Copy variable length bytecode */
+		memcpy(&req_buf[sizeof(req_msg)], bytecode, bytecode_len);
+
+		this_context->client.rpc_status = rpc_caller_session_invoke(
+			call_handle, TS_LUA_OPCODE_ENV_APPEND_BYTECODE,
+			&resp_buf, &resp_len, &service_status);
+
+		if (this_context->client.rpc_status == RPC_SUCCESS) {
+			lua_status = service_status;
+		}
+
+		rpc_caller_session_end(call_handle);
+	} else {
+		this_context->client.rpc_status = RPC_ERROR_INTERNAL;
+	}
+
+	return lua_status;
+}
+
 /*
  * Call Lua's parser & interpreter on the environment's script buffer.
  * The return value of the parser or interpreter (if parser succeeds) will be in service_status.
- * In case of error the error message will be returned in error_msg_buf.
+ * In case of error the error message will be returned in payload_buf, on success the
+ * CBOR encoded results of the script, see lua_results_init.
+ * LUA_IN_PROGRESS is returned if the script was suspended, see env_resume.
+ * The input is passed to the script in the request, see buffer.request().
  */
 lua_status_t env_execute(void *context,
 	int32_t env_index,
-	size_t error_msg_buf_size,
-	uint8_t *error_msg_buf,
-	size_t *error_msg_len)
+	const uint8_t *input,
+	size_t input_len,
+	size_t payload_buf_size,
+	uint8_t *payload_buf,
+	size_t *payload_len)
 {
 	struct lua_client *this_context = (struct lua_client *)context;
 	lua_status_t lua_status = LUA_ERROR_GENERIC_ERROR;
 	struct ts_lua_env_execute_in req_msg = {0};
+	size_t req_len = sizeof(req_msg) + input_len;
+	uint8_t *req_buf = NULL;
+
+	*payload_len = 0;
+
+	req_msg.env_index = env_index;
+
+	rpc_call_handle call_handle =
+		rpc_caller_session_begin(this_context->client.session, &req_buf, req_len,
+					payload_buf_size);
+
+	if (call_handle) {
+		uint8_t *resp_buf = NULL;
+		size_t resp_len = 0;
+		service_status_t service_status = 0;
+
+		/* Copy fixed size message */
+		memcpy(req_buf, &req_msg, sizeof(req_msg));
+
+		/* Copy variable length input */
+		if (input_len)
+			memcpy(&req_buf[sizeof(req_msg)], input, input_len);
+
+		this_context->client.rpc_status = rpc_caller_session_invoke(
+			call_handle, TS_LUA_OPCODE_ENV_EXECUTE, &resp_buf, &resp_len,
+			&service_status);
+
+		if (this_context->client.rpc_status == RPC_SUCCESS) {
+			lua_status = service_status;
+
+			/* Error message from Lua on failure, encoded results on success */
+			if (lua_status != LUA_IN_PROGRESS) {
+
+				if (resp_len <= payload_buf_size) {
+
+					memcpy(payload_buf, resp_buf, resp_len);
+					*payload_len = resp_len;
+				} else {
+
+					lua_status = LUA_ERROR_BUFFER_TOO_SMALL;
+				}
+			}
+		}
+
+		rpc_caller_session_end(call_handle);
+	} else {
+
+		this_context->client.rpc_status = RPC_ERROR_INTERNAL;
+	}
+
+	return lua_status;
+}
+
+/*
+ * Continue the script suspended in the specified environment for another slice.
+ * Returns LUA_IN_PROGRESS while the script is still suspended, otherwise the outcome
+ * as for env_execute.
+ */
+lua_status_t env_resume(void *context,
+	int32_t env_index,
+	const uint8_t *input,
+	size_t input_len,
+	size_t payload_buf_size,
+	uint8_t *payload_buf,
+	size_t *payload_len)
+{
+	struct lua_client *this_context = (struct lua_client *)context;
+	lua_status_t lua_status = LUA_ERROR_GENERIC_ERROR;
+	struct ts_lua_env_resume_in req_msg = {0};
+	size_t req_len = sizeof(req_msg) + input_len;
+	uint8_t *req_buf = NULL;
+
+	*payload_len = 0;
+
+	req_msg.env_index = env_index;
+
+	rpc_call_handle call_handle =
+		rpc_caller_session_begin(this_context->client.session, &req_buf, req_len,
+					payload_buf_size);
+
+	if (call_handle) {
+		uint8_t *resp_buf = NULL;
+		size_t resp_len = 0;
+		service_status_t service_status = 0;
+
+		/* Copy fixed size message */
+		memcpy(req_buf, &req_msg, sizeof(req_msg));
+
+		/* Copy variable length input */
+		if (input_len)
+			memcpy(&req_buf[sizeof(req_msg)], input, input_len);
+
+		this_context->client.rpc_status = rpc_caller_session_invoke(
+			call_handle, TS_LUA_OPCODE_ENV_RESUME, &resp_buf, &resp_len,
+			&service_status);
+
+		if (this_context->client.rpc_status == RPC_SUCCESS) {
+			lua_status = service_status;
+
+			/* Error message from Lua on failure, encoded results on success */
+			if (lua_status != LUA_IN_PROGRESS) {
+
+				if (resp_len <= payload_buf_size) {
+
+					memcpy(payload_buf, resp_buf, resp_len);
+					*payload_len = resp_len;
+				} else {
+
+					lua_status = LUA_ERROR_BUFFER_TOO_SMALL;
+				}
+			}
+		}
+
+		rpc_caller_session_end(call_handle);
+	} else {
+
+		this_context->client.rpc_status = RPC_ERROR_INTERNAL;
+	}
+
+	return lua_status;
+}
+
+/*
+ * Execute a script in a temporary environment with a single call.
+ * The whole script is carried in the request, so it must fit in the session's buffer.
+ * Status and payload are returned as for env_execute.
+ */
+lua_status_t env_run(void *context,
+	const uint8_t *script,
+	size_t script_len,
+	uint32_t flags,
+	size_t payload_buf_size,
+	uint8_t *payload_buf,
+	size_t *payload_len)
+{
+	struct lua_client *this_context = (struct lua_client *)context;
+	lua_status_t lua_status = LUA_ERROR_GENERIC_ERROR;
+	struct ts_lua_env_run_in req_msg = {0};
+	size_t req_len = sizeof(req_msg) + script_len;
+	uint8_t *req_buf = NULL;
+
+	*payload_len = 0;
+
+	req_msg.flags = flags;
+
+	rpc_call_handle call_handle =
+		rpc_caller_session_begin(this_context->client.session, &req_buf, req_len,
+					payload_buf_size);
+
+	if (call_handle) {
+		uint8_t *resp_buf = NULL;
+		size_t resp_len = 0;
+		service_status_t service_status = 0;
+
+		/* Copy fixed size message */
+		memcpy(req_buf, &req_msg, sizeof(req_msg));
+
+		/* Copy variable length script */
+		memcpy(&req_buf[sizeof(req_msg)], script, script_len);
+
+		this_context->client.rpc_status = rpc_caller_session_invoke(
+			call_handle, TS_LUA_OPCODE_ENV_RUN, &resp_buf, &resp_len,
+			&service_status);
+
+		if (this_context->client.rpc_status == RPC_SUCCESS) {
+			lua_status = service_status;
+
+			/* Error message from Lua on failure, encoded results on success */
+			if (resp_len <= payload_buf_size) {
+
+				memcpy(payload_buf, resp_buf, resp_len);
+				*payload_len = resp_len;
+			} else {
+
+				lua_status = LUA_ERROR_BUFFER_TOO_SMALL;
+			}
+		}
+
+		rpc_caller_session_end(call_handle);
+	} else {
+
+		this_context->client.rpc_status = RPC_ERROR_INTERNAL;
+	}
+
+	return lua_status;
+}
+
+/*
+ * Read and consume the output printed by scripts of the specified environment.
+ */
+lua_status_t env_read_output(void *context,
+	int32_t env_index,
+	size_t output_buf_size,
+	uint8_t *output_buf,
+	size_t *output_len,
+	size_t *remaining_len,
+	size_t *lost_len)
+{
+	struct lua_client *this_context = (struct lua_client *)context;
+	lua_status_t lua_status = LUA_ERROR_GENERIC_ERROR;
+	struct ts_lua_env_read_output_in req_msg = {0};
 	size_t req_len = sizeof(req_msg);
 	uint8_t *req_buf = NULL;
 
-	*error_msg_len = 0;
+	*output_len = 0;
+	*remaining_len = 0;
+	*lost_len = 0;
 
 	req_msg.env_index = env_index;
 
 	rpc_call_handle call_handle =
 		rpc_caller_session_begin(this_context->client.session, &req_buf, req_len,
-					error_msg_buf_size);
+					sizeof(struct ts_lua_env_read_output_out) + output_buf_size);
 
 	if (call_handle) {
 		uint8_t *resp_buf = NULL;
@@ -146,29 +455,163 @@ lua_status_t env_execute(void *context,
 		memcpy(req_buf, &req_msg, req_len);
 
 		this_context->client.rpc_status = rpc_caller_session_invoke(
-			call_handle, TS_LUA_OPCODE_ENV_EXECUTE, &resp_buf, &resp_len,
+			call_handle, TS_LUA_OPCODE_ENV_READ_OUTPUT, &resp_buf, &resp_len,
 			&service_status);
 
 		if (this_context->client.rpc_status == RPC_SUCCESS) {
 			lua_status = service_status;
 
-			/* In failure error message from Lua is returned in response buffer */
-			if (lua_status != LUA_SUCCESS) {
+			if (lua_status == LUA_SUCCESS) {
+				struct ts_lua_env_read_output_out resp_msg;
+				size_t fixed_len = sizeof(resp_msg);
 
-				if (resp_len <= error_msg_buf_size) {
+				if (resp_len >= fixed_len && resp_len - fixed_len <= output_buf_size) {
+					memcpy(&resp_msg, resp_buf, fixed_len);
+					memcpy(output_buf, &resp_buf[fixed_len], resp_len - fixed_len);
 
-					memcpy(error_msg_buf, resp_buf, resp_len);
-					*error_msg_len = resp_len;
+					*output_len = resp_len - fixed_len;
+					*remaining_len = resp_msg.remaining_len;
+					*lost_len = resp_msg.lost_len;
 				} else {
+					/* Failed to decode response message */
+					lua_status = LUA_ERROR_GENERIC_ERROR;
+				}
+			}
+		}
+
+		rpc_caller_session_end(call_handle);
+	} else {
+		this_context->client.rpc_status = RPC_ERROR_INTERNAL;
+	}
+
+	return lua_status;
+}
 
-					lua_status = PSA_ERROR_BUFFER_TOO_SMALL;
+/*
+ * Fetch the profile sampled since the previous call and set the sampling interval.
+ */
+lua_status_t env_profile_result(void *context,
+	int32_t env_index,
+	uint32_t sample_interval,
+	size_t profile_buf_size,
+	uint8_t *profile_buf,
+	size_t *profile_len)
+{
+	struct lua_client *this_context = (struct lua_client *)context;
+	lua_status_t lua_status = LUA_ERROR_GENERIC_ERROR;
+	struct ts_lua_env_profile_result_in req_msg = {0};
+	size_t req_len = sizeof(req_msg);
+	uint8_t *req_buf = NULL;
+
+	*profile_len = 0;
+
+	req_msg.env_index = env_index;
+	req_msg.sample_interval = sample_interval;
+
+	rpc_call_handle call_handle =
+		rpc_caller_session_begin(this_context->client.session, &req_buf, req_len,
+					profile_buf_size);
+
+	if (call_handle) {
+		uint8_t *resp_buf = NULL;
+		size_t resp_len = 0;
+		service_status_t service_status = 0;
+
+		memcpy(req_buf, &req_msg, req_len);
+
+		this_context->client.rpc_status = rpc_caller_session_invoke(
+			call_handle, TS_LUA_OPCODE_ENV_PROFILE_RESULT, &resp_buf, &resp_len,
+			&service_status);
+
+		if (this_context->client.rpc_status == RPC_SUCCESS) {
+			lua_status = service_status;
+
+			if (lua_status == LUA_SUCCESS) {
+				if (resp_len <= profile_buf_size) {
+					memcpy(profile_buf, resp_buf, resp_len);
+					*profile_len = resp_len;
+				} else {
+					lua_status = LUA_ERROR_BUFFER_TOO_SMALL;
 				}
 			}
 		}
 
 		rpc_caller_session_end(call_handle);
 	} else {
+		this_context->client.rpc_status = RPC_ERROR_INTERNAL;
+	}
+
+	return lua_status;
+}
 
+/* Convert ticks of a counter running at frequency ticks per second to nanoseconds */
+static uint64_t ticks_to_ns(uint64_t ticks, uint64_t frequency)
+{
+	if (!frequency)
+		return 0;
+
+	return (ticks / frequency) * 1000000000u +
+	       ((ticks % frequency) * 1000000000u) / frequency;
+}
+
+/*
+ * Fetch the execution metrics of the specified environment.
+ */
+lua_status_t env_stats(void *context, int32_t env_index, struct lua_env_stats *stats)
+{
+	struct lua_client *this_context = (struct lua_client *)context;
+	lua_status_t lua_status = LUA_ERROR_GENERIC_ERROR;
+	struct ts_lua_env_stats_in req_msg = {0};
+	size_t req_len = sizeof(req_msg);
+	uint8_t *req_buf = NULL;
+
+	memset(stats, 0, sizeof(*stats));
+
+	req_msg.env_index = env_index;
+
+	rpc_call_handle call_handle =
+		rpc_caller_session_begin(this_context->client.session, &req_buf, req_len,
+					sizeof(struct ts_lua_env_stats_out));
+
+	if (call_handle) {
+		uint8_t *resp_buf = NULL;
+		size_t resp_len = 0;
+		service_status_t service_status = 0;
+
+		memcpy(req_buf, &req_msg, req_len);
+
+		this_context->client.rpc_status = rpc_caller_session_invoke(
+			call_handle, TS_LUA_OPCODE_ENV_STATS, &resp_buf, &resp_len,
+			&service_status);
+
+		if (this_context->client.rpc_status == RPC_SUCCESS) {
+			lua_status = service_status;
+
+			if (lua_status == LUA_SUCCESS) {
+				if (resp_len == sizeof(struct ts_lua_env_stats_out)) {
+					struct ts_lua_env_stats_out resp_msg;
+
+					memcpy(&resp_msg, resp_buf, sizeof(resp_msg));
+
+					stats->parse_ns = ticks_to_ns(resp_msg.parse_ticks,
+								      resp_msg.tick_frequency);
+					stats->exec_ns = ticks_to_ns(resp_msg.exec_ticks,
+								     resp_msg.tick_frequency);
+					stats->instructions = resp_msg.instructions;
+					stats->bytes_allocated = resp_msg.bytes_allocated;
+					stats->peak_memory = resp_msg.peak_memory;
+					stats->gc_cycles = resp_msg.gc_cycles;
+					stats->execute_count = resp_msg.execute_count;
+					stats->slice_count = resp_msg.slice_count;
+				} else {
+					/* Failed to decode response message */
+					lua_status = LUA_ERROR_GENERIC_ERROR;
+				}
+			}
+		}
+
+		rpc_caller_session_end(call_handle);
+	} else {
 		this_context->client.rpc_status = RPC_ERROR_INTERNAL;
 	}
 
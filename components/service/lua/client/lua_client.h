@@ -23,6 +23,30 @@ struct lua_client {
 	struct service_client client;
 };
 
+/**
+ * \brief Execution metrics of a Lua environment
+ *
+ * Accumulated over all the scripts the environment ran, see env_stats.
+ */
+struct lua_env_stats {
+	/* time spent compiling scripts, excluding scripts served from the cache */
+	uint64_t parse_ns;
+	/* time spent running scripts */
+	uint64_t exec_ns;
+	/* VM instructions, counted in steps of the provider's hook period */
+	uint64_t instructions;
+	/* bytes allocated while compiling and running scripts */
+	uint64_t bytes_allocated;
+	/* peak memory use of the environment's Lua state */
+	uint64_t peak_memory;
+	/* garbage collection cycles completed while the scripts ran */
+	uint64_t gc_cycles;
+	/* scripts started by env_execute */
+	uint32_t execute_count;
+	/* slices the scripts ran in, one per env_execute and env_resume call */
+	uint32_t slice_count;
+};
+
 /**
  * @brief Initialize a lua_client
  *
@@ -50,7 +74,8 @@ void lua_client_deinit(struct lua_client *lua_client);
  * \brief Create a new Lua environment
  *
  * Create a new Lua environment for script isolation.
- * On success env_index is an index identifying the new environment.
+ * On success env_index is a handle identifying the new environment. The handle
+ * of a deleted environment is rejected even if its slot has been reused.
  * On failure env_index will be -1.
  *
  * \param[in]  context     Pointer to lua_client
@@ -60,6 +85,24 @@ void lua_client_deinit(struct lua_client *lua_client);
  */
 psa_status_t env_create(void *context, int32_t *env_index);
 
+/**
+ * \brief Create a Lua environment from a template
+ *
+ * Create a new Lua environment that inherits the globals of the template
+ * environment, e.g. helpers defined by a prelude that was executed in it. This
+ * is much cheaper than running the prelude again. Tables of the template are
+ * copied into the new environment when it first uses them, so changes to
+ * them stay in the new environment. The template is frozen by its first
+ * clone and can't be appended to or executed afterwards.
+ *
+ * \param[in]  context         Pointer to lua_client
+ * \param[in]  template_index  Index of the template environment
+ * \param[out] env_index       Index of created environment
+ *
+ * \return corresponding PSA-API status codes
+ */
+psa_status_t env_clone(void *context, int32_t template_index, int32_t *env_index);
+
 /**
  * \brief Append script to an environment's script buffer
  *
@@ -76,25 +119,169 @@ psa_status_t env_create(void *context, int32_t *env_index);
 psa_status_t env_append(void *context, int32_t env_index,
                         const uint8_t *script_bytes, size_t script_len);
 
+/**
+ * \brief Append precompiled bytecode to an environment's script buffer
+ *
+ * Append bytecode produced by lua_dump (see lua_compile_script) to the specified
+ * environment's script buffer. The first chunk must contain the complete bytecode
+ * header. Source and bytecode can't be mixed in the same script buffer. Providers
+ * built without LUA_BYTECODE_ENABLED reject all bytecode with
+ * LUA_ERROR_INVALID_BYTECODE.
+ *
+ * \param[in]  context       Pointer to lua_client
+ * \param[in]  env_index     Index of target environment
+ * \param[in]  bytecode      Bytecode to be appended
+ * \param[in]  bytecode_len  Length of bytecode array
+ *
+ * \return corresponding PSA-API status codes
+ */
+psa_status_t env_append_bytecode(void *context, int32_t env_index,
+                                 const uint8_t *bytecode, size_t bytecode_len);
+
 /**
  * \brief Parse and interpret the environment's script buffer
  *
  * Call Lua's parser & interpreter on the environment's script buffer.
  * The return value of the parser or interpreter (if parser succeeds) will be in service_status.
- * In case of error the error message will be returned in the payload.
+ * In case of error the error message will be returned in the payload. When the
+ * script finishes, the payload holds the values it returned as a CBOR array, which
+ * can be decoded with lua_results_init. It is empty if no values were returned.
+ * If the provider has an instruction budget, long scripts are suspended after it,
+ * in which case LUA_IN_PROGRESS is returned and the script is continued with
+ * env_resume.
+ * The script reads the input from the request's shared memory through
+ * buffer.request(), but only until it is suspended. The input must fit in the
+ * RPC session's buffer.
+ * LUA_ERROR_BUFFER_TOO_SMALL is returned if the script finished but its results
+ * don't fit in payload_buf. The script did run and its side effects persist in
+ * the environment, only the results are lost.
  *
- * \param[in]  context             Pointer to lua_client
- * \param[in]  env_index           Index of environment to execute
- * \param[in]  error_msg_buf_size  Size of input buffer for storing error message
- * \param[out] error_msg_buf       Buffer for error message
- * \param[out] error_msg_len       Length of the error message
+ * \param[in]  context           Pointer to lua_client
+ * \param[in]  env_index         Index of environment to execute
+ * \param[in]  input             Input for the script, may be NULL
+ * \param[in]  input_len         Length of input
+ * \param[in]  payload_buf_size  Size of input buffer for storing the payload
+ * \param[out] payload_buf       Buffer for error message or results
+ * \param[out] payload_len       Length of the payload
  *
  * \return corresponding PSA-API status codes
  */
 psa_status_t env_execute(void *context, int32_t env_index,
-                         size_t error_msg_buf_size,
-                         uint8_t *error_msg_buf,
-                         size_t *error_msg_len);
+                         const uint8_t *input, size_t input_len,
+                         size_t payload_buf_size,
+                         uint8_t *payload_buf,
+                         size_t *payload_len);
+
+/**
+ * \brief Resume a suspended script
+ *
+ * Continue the script suspended in the specified environment for another slice.
+ * The input is visible to the script for this slice, as for env_execute.
+ * LUA_ERROR_BUFFER_TOO_SMALL is returned if the script finished but its results
+ * don't fit in payload_buf.
+ *
+ * \param[in]  context           Pointer to lua_client
+ * \param[in]  env_index         Index of environment to resume
+ * \param[in]  input             Input for the script, may be NULL
+ * \param[in]  input_len         Length of input
+ * \param[in]  payload_buf_size  Size of input buffer for storing the payload
+ * \param[out] payload_buf       Buffer for error message or results
+ * \param[out] payload_len       Length of the payload
+ *
+ * \return LUA_IN_PROGRESS while the script is suspended, otherwise as for env_execute
+ */
+psa_status_t env_resume(void *context, int32_t env_index,
+                        const uint8_t *input, size_t input_len,
+                        size_t payload_buf_size,
+                        uint8_t *payload_buf,
+                        size_t *payload_len);
+
+/**
+ * \brief Execute a script in a single call
+ *
+ * Execute a script in a temporary environment that is deleted afterwards. This saves
+ * the env_create, env_append and env_delete round trips for short scripts. The whole
+ * script must fit in the RPC session's buffer. The script can't be resumed, it fails
+ * with LUA_ERROR_BUDGET_EXCEEDED if it doesn't finish within the provider's budget.
+ *
+ * \param[in]  context           Pointer to lua_client
+ * \param[in]  script            Script source or bytecode
+ * \param[in]  script_len        Length of script
+ * \param[in]  flags             TS_LUA_ENV_RUN_FLAG_* flags
+ * \param[in]  payload_buf_size  Size of input buffer for storing the payload
+ * \param[out] payload_buf       Buffer for error message or results, as for env_execute
+ * \param[out] payload_len       Length of the payload
+ *
+ * \return corresponding PSA-API status codes
+ */
+psa_status_t env_run(void *context, const uint8_t *script, size_t script_len,
+                     uint32_t flags, size_t payload_buf_size,
+                     uint8_t *payload_buf, size_t *payload_len);
+
+/**
+ * \brief Read the output printed by scripts
+ *
+ * Read and consume the output printed by scripts of the specified environment.
+ * Output that doesn't fit into output_buf is kept for the next call.
+ *
+ * \param[in]  context          Pointer to lua_client
+ * \param[in]  env_index        Index of environment
+ * \param[in]  output_buf_size  Size of output_buf
+ * \param[out] output_buf       Buffer for the output
+ * \param[out] output_len       Length of the output returned
+ * \param[out] remaining_len    Length of the output left to read
+ * \param[out] lost_len         Length of output lost because the buffer was full
+ *
+ * \return corresponding PSA-API status codes
+ */
+psa_status_t env_read_output(void *context, int32_t env_index,
+                             size_t output_buf_size, uint8_t *output_buf,
+                             size_t *output_len, size_t *remaining_len,
+                             size_t *lost_len);
+
+/**
+ * \brief Fetch the profile of an environment's scripts
+ *
+ * Return the profile sampled since the previous call and set the sampling
+ * interval for the following slices of the environment's scripts. A non-zero
+ * sample_interval enables profiling with a sample of the call stack every
+ * sample_interval VM instructions, zero disables it. Call it once before
+ * env_execute to enable profiling and again afterwards to get the profile.
+ * The profile holds a table of frames and the sample counts of stacks of
+ * frames, see lua_profiler.h for the format. It is encoded like the results of
+ * a script, so it can be decoded with lua_results_init, and is easily folded
+ * into the input of flame graph tools.
+ * profile_len is zero if profiling wasn't enabled.
+ *
+ * \param[in]  context           Pointer to lua_client
+ * \param[in]  env_index         Index of environment
+ * \param[in]  sample_interval   VM instructions between samples, 0 to disable
+ * \param[in]  profile_buf_size  Size of profile_buf
+ * \param[out] profile_buf       Buffer for the CBOR encoded profile
+ * \param[out] profile_len       Length of the profile
+ *
+ * \return corresponding PSA-API status codes
+ */
+psa_status_t env_profile_result(void *context, int32_t env_index,
+                                uint32_t sample_interval,
+                                size_t profile_buf_size, uint8_t *profile_buf,
+                                size_t *profile_len);
+
+/**
+ * \brief Fetch the execution metrics of an environment
+ *
+ * Return the time spent compiling and running the environment's scripts, the
+ * VM instructions they executed, their memory use and the garbage collection
+ * cycles they caused. Times are converted to nanoseconds from the counter
+ * the provider measures them with.
+ *
+ * \param[in]  context     Pointer to lua_client
+ * \param[in]  env_index   Index of environment
+ * \param[out] stats       Metrics of the environment
+ *
+ * \return corresponding PSA-API status codes
+ */
+psa_status_t env_stats(void *context, int32_t env_index, struct lua_env_stats *stats);
 
 /**
  * \brief Delete the specified Lua environment
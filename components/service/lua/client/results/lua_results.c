@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "lua_results.h"
+
+lua_status_t lua_results_init(struct lua_results *results, const uint8_t *payload,
+			      size_t payload_len, size_t *count)
+{
+	UsefulBufC encoded = { .ptr = payload, .len = payload_len };
+	QCBORItem item;
+
+	*count = 0;
+
+	results->is_empty = (payload_len == 0);
+	results->error = QCBOR_SUCCESS;
+
+	/* No payload when the script didn't return anything */
+	if (results->is_empty)
+		return LUA_SUCCESS;
+
+	QCBORDecode_Init(&results->decoder, encoded, QCBOR_DECODE_MODE_NORMAL);
+
+	results->error = QCBORDecode_GetNext(&results->decoder, &item);
+	if (results->error != QCBOR_SUCCESS || item.uDataType != QCBOR_TYPE_ARRAY)
+		return LUA_ERROR_GENERIC_ERROR;
+
+	*count = item.val.uCount;
+
+	return LUA_SUCCESS;
+}
+
+static bool decode_key(const QCBORItem *item, struct lua_result *result)
+{
+	switch (item->uLabelType) {
+	case QCBOR_TYPE_NONE:
+		result->key_type = LUA_RESULT_NIL;
+		return true;
+
+	case QCBOR_TYPE_INT64:
+		result->key_type = LUA_RESULT_INTEGER;
+		result->key.integer = item->label.int64;
+		return true;
+
+	case QCBOR_TYPE_TEXT_STRING:
+	case QCBOR_TYPE_BYTE_STRING:
+		result->key_type = LUA_RESULT_STRING;
+		result->key.string.data = (const uint8_t *)item->label.string.ptr;
+		result->key.string.len = item->label.string.len;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static bool decode_value(const QCBORItem *item, struct lua_result *result)
+{
+	switch (item->uDataType) {
+	case QCBOR_TYPE_NULL:
+		result->type = LUA_RESULT_NIL;
+		return true;
+
+	case QCBOR_TYPE_TRUE:
+	case QCBOR_TYPE_FALSE:
+		result->type = LUA_RESULT_BOOLEAN;
+		result->value.boolean = (item->uDataType == QCBOR_TYPE_TRUE);
+		return true;
+
+	case QCBOR_TYPE_INT64:
+		result->type = LUA_RESULT_INTEGER;
+		result->value.integer = item->val.int64;
+		return true;
+
+	/* Floats that fit are sent in a shorter format */
+	case QCBOR_TYPE_FLOAT:
+		result->type = LUA_RESULT_NUMBER;
+		result->value.number = item->val.fnum;
+		return true;
+
+	case QCBOR_TYPE_DOUBLE:
+		result->type = LUA_RESULT_NUMBER;
+		result->value.number = item->val.dfnum;
+		return true;
+
+	case QCBOR_TYPE_TEXT_STRING:
+	case QCBOR_TYPE_BYTE_STRING:
+		result->type = LUA_RESULT_STRING;
+		result->value.string.data = (const uint8_t *)item->val.string.ptr;
+		result->value.string.len = item->val.string.len;
+		return true;
+
+	case QCBOR_TYPE_ARRAY:
+		result->type = LUA_RESULT_ARRAY;
+		result->value.count = item->val.uCount;
+		return true;
+
+	case QCBOR_TYPE_MAP:
+		result->type = LUA_RESULT_MAP;
+		result->value.count = item->val.uCount;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool lua_results_next(struct lua_results *results, struct lua_result *result)
+{
+	QCBORItem item;
+
+	if (results->is_empty || results->error != QCBOR_SUCCESS)
+		return false;
+
+	results->error = QCBORDecode_GetNext(&results->decoder, &item);
+	if (results->error != QCBOR_SUCCESS)
+		return false;
+
+	/* Level 0 is the array holding the results */
+	if (item.uNestingLevel == 0 || !decode_key(&item, result) ||
+	    !decode_value(&item, result)) {
+		results->error = QCBOR_ERR_UNSUPPORTED;
+
+		return false;
+	}
+
+	result->depth = item.uNestingLevel - 1u;
+
+	return true;
+}
+
+lua_status_t lua_results_finish(struct lua_results *results)
+{
+	if (results->is_empty)
+		return LUA_SUCCESS;
+
+	/* Running out of items is the normal end */
+	if (results->error != QCBOR_SUCCESS && results->error != QCBOR_ERR_NO_MORE_ITEMS)
+		return LUA_ERROR_GENERIC_ERROR;
+
+	if (QCBORDecode_Finish(&results->decoder) != QCBOR_SUCCESS)
+		return LUA_ERROR_GENERIC_ERROR;
+
+	return LUA_SUCCESS;
+}
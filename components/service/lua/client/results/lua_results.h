@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_RESULTS_H
+#define LUA_RESULTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <qcbor/qcbor_decode.h>
+#include "protocols/service/lua/status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum lua_result_type {
+	LUA_RESULT_NIL,
+	LUA_RESULT_BOOLEAN,
+	LUA_RESULT_INTEGER,
+	LUA_RESULT_NUMBER,
+	LUA_RESULT_STRING,
+	LUA_RESULT_ARRAY,
+	LUA_RESULT_MAP
+};
+
+/**
+ * \brief A value returned by a script
+ *
+ * Tables are flattened: an array or map result is followed by its count
+ * entries, each of them one level deeper. Strings point into the payload.
+ */
+struct lua_result {
+	enum lua_result_type type;
+	/* 0 for the values returned by the script, +1 for each enclosing table */
+	unsigned int depth;
+
+	union {
+		bool boolean;
+		int64_t integer;
+		double number;
+		struct {
+			const uint8_t *data;
+			size_t len;
+		} string;
+		/* Number of entries of an array or map */
+		size_t count;
+	} value;
+
+	/* The key of map entries is LUA_RESULT_INTEGER or LUA_RESULT_STRING, otherwise NIL */
+	enum lua_result_type key_type;
+
+	union {
+		int64_t integer;
+		struct {
+			const uint8_t *data;
+			size_t len;
+		} string;
+	} key;
+};
+
+/**
+ * \brief Decoder for the results of env_execute, env_resume and env_run
+ */
+struct lua_results {
+	QCBORDecodeContext decoder;
+	bool is_empty;
+	QCBORError error;
+};
+
+/**
+ * \brief Start decoding the results of a finished script
+ *
+ * \param[out] results      Decoder to initialize
+ * \param[in]  payload      Payload returned with LUA_SUCCESS
+ * \param[in]  payload_len  Length of the payload, may be 0
+ * \param[out] count        Number of values the script returned
+ *
+ * \return LUA_SUCCESS or LUA_ERROR_GENERIC_ERROR if the payload isn't a CBOR array
+ */
+lua_status_t lua_results_init(struct lua_results *results, const uint8_t *payload,
+			      size_t payload_len, size_t *count);
+
+/**
+ * \brief Get the next value
+ *
+ * Values are returned depth first, see struct lua_result.
+ *
+ * \param[in]  results  Decoder
+ * \param[out] result   The value
+ *
+ * \return false if there are no more values or the payload is malformed
+ */
+bool lua_results_next(struct lua_results *results, struct lua_result *result);
+
+/**
+ * \brief Finish decoding
+ *
+ * \param[in]  results  Decoder
+ *
+ * \return LUA_SUCCESS if all values were decoded without error, otherwise
+ *         LUA_ERROR_GENERIC_ERROR
+ */
+lua_status_t lua_results_finish(struct lua_results *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LUA_RESULTS_H */
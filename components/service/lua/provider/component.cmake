@@ -10,6 +10,15 @@ endif()
 
 target_sources(${TGT} PRIVATE
 	"${CMAKE_CURRENT_LIST_DIR}/lua_provider.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_buffer.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_cbor.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_chunk_cache.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_env_heap.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_metrics.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_modules.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_output.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_profiler.c"
+	"${CMAKE_CURRENT_LIST_DIR}/lua_script.c"
 	)
 
 
@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+#include <lauxlib.h>
+#include "lua_buffer.h"
+
+struct buffer {
+	uint8_t *data;
+	size_t len;
+	bool read_only;
+	/* Set for views of window data, which are only valid for one generation */
+	const struct lua_buffer_window *window;
+	uint32_t generation;
+};
+
+void lua_buffer_window_open(struct lua_buffer_window *window, const uint8_t *data, size_t len)
+{
+	window->data = data;
+	window->len = len;
+	window->generation++;
+}
+
+void lua_buffer_window_close(struct lua_buffer_window *window)
+{
+	window->data = NULL;
+	window->len = 0;
+	window->generation++;
+}
+
+static bool is_valid(const struct buffer *b)
+{
+	return b->window == NULL || b->window->generation == b->generation;
+}
+
+static struct buffer *check_buffer(lua_State *L, int idx)
+{
+	struct buffer *b = (struct buffer *)luaL_checkudata(L, idx, LUA_BUFFER_METATABLE);
+
+	if (!is_valid(b))
+		luaL_error(L, "buffer refers to the data of a finished request");
+
+	return b;
+}
+
+static struct buffer *check_writable(lua_State *L, int idx)
+{
+	struct buffer *b = check_buffer(L, idx);
+
+	if (b->read_only)
+		luaL_error(L, "buffer is read-only");
+
+	return b;
+}
+
+/* Bytes of a buffer or a string argument */
+static const uint8_t *check_bytes(lua_State *L, int idx, size_t *len)
+{
+	if (lua_type(L, idx) == LUA_TSTRING)
+		return (const uint8_t *)lua_tolstring(L, idx, len);
+
+	struct buffer *b = check_buffer(L, idx);
+
+	*len = b->len;
+
+	return b->data;
+}
+
+/* Position of a width bytes wide field as a 0-based offset, negative positions count from the end */
+static size_t check_pos(lua_State *L, size_t len, int arg, size_t width)
+{
+	lua_Integer pos = luaL_checkinteger(L, arg);
+
+	if (pos < 0)
+		pos += (lua_Integer)len + 1;
+
+	luaL_argcheck(L, pos >= 1 && width <= len && (lua_Unsigned)pos <= len - width + 1, arg,
+		      "out of bounds");
+
+	return (size_t)pos - 1;
+}
+
+/* Range i..j as for string.sub, as a 0-based start and a length */
+static size_t check_range(lua_State *L, size_t len, int i_arg, int j_arg, size_t *start)
+{
+	lua_Integer i = luaL_optinteger(L, i_arg, 1);
+	lua_Integer j = luaL_optinteger(L, j_arg, -1);
+
+	if (i < 0)
+		i += (lua_Integer)len + 1;
+	if (j < 0)
+		j += (lua_Integer)len + 1;
+
+	/* An empty range may start right after the end */
+	luaL_argcheck(L, i >= 1 && (lua_Unsigned)i <= len + 1, i_arg, "out of bounds");
+	luaL_argcheck(L, j >= i - 1 && (lua_Unsigned)j <= len, j_arg, "out of bounds");
+
+	*start = (size_t)i - 1;
+
+	return (size_t)(j - i + 1);
+}
+
+static struct buffer *new_buffer(lua_State *L, size_t len)
+{
+	luaL_argcheck(L, len <= (size_t)LUA_MAXINTEGER - sizeof(struct buffer), 1, "too large");
+
+	/* The data follows the header in the same allocation */
+	struct buffer *b = (struct buffer *)lua_newuserdatauv(L, sizeof(struct buffer) + len, 0);
+
+	b->data = (uint8_t *)(b + 1);
+	b->len = len;
+	b->read_only = false;
+	b->window = NULL;
+	b->generation = 0;
+
+	luaL_setmetatable(L, LUA_BUFFER_METATABLE);
+
+	return b;
+}
+
+static int buffer_new(lua_State *L)
+{
+	lua_Integer len = luaL_checkinteger(L, 1);
+	lua_Integer byte = luaL_optinteger(L, 2, 0);
+
+	luaL_argcheck(L, len >= 0, 1, "must not be negative");
+	luaL_argcheck(L, byte >= 0 && byte <= UINT8_MAX, 2, "not a byte");
+
+	struct buffer *b = new_buffer(L, (size_t)len);
+
+	memset(b->data, (int)byte, b->len);
+
+	return 1;
+}
+
+static int buffer_from(lua_State *L)
+{
+	size_t len = 0;
+	const char *s = luaL_checklstring(L, 1, &len);
+	struct buffer *b = new_buffer(L, len);
+
+	memcpy(b->data, s, len);
+
+	return 1;
+}
+
+static int buffer_request(lua_State *L)
+{
+	const struct lua_buffer_window *window =
+		(const struct lua_buffer_window *)lua_touserdata(L, lua_upvalueindex(1));
+	struct buffer *b = (struct buffer *)lua_newuserdatauv(L, sizeof(struct buffer), 0);
+
+	b->data = (uint8_t *)window->data;
+	b->len = window->len;
+	b->read_only = true;
+	b->window = window;
+	b->generation = window->generation;
+
+	luaL_setmetatable(L, LUA_BUFFER_METATABLE);
+
+	return 1;
+}
+
+static lua_Unsigned get_word(const uint8_t *data, size_t width, bool big_endian)
+{
+	lua_Unsigned value = 0;
+
+	for (size_t i = 0; i < width; i++)
+		value |= (lua_Unsigned)data[big_endian ? width - 1 - i : i] << (8 * i);
+
+	return value;
+}
+
+static void set_word(uint8_t *data, size_t width, bool big_endian, lua_Unsigned value)
+{
+	for (size_t i = 0; i < width; i++)
+		data[big_endian ? width - 1 - i : i] = (uint8_t)(value >> (8 * i));
+}
+
+static int get(lua_State *L, size_t width)
+{
+	struct buffer *b = check_buffer(L, 1);
+	size_t pos = check_pos(L, b->len, 2, width);
+
+	lua_pushinteger(L, (lua_Integer)get_word(&b->data[pos], width, lua_toboolean(L, 3)));
+
+	return 1;
+}
+
+static int set(lua_State *L, size_t width)
+{
+	struct buffer *b = check_writable(L, 1);
+	size_t pos = check_pos(L, b->len, 2, width);
+	lua_Integer value = luaL_checkinteger(L, 3);
+
+	/* 64-bit values may be negative, narrower ones must fit unsigned */
+	luaL_argcheck(L, width == sizeof(lua_Integer) ||
+		      (value >= 0 && (lua_Unsigned)value >> (8 * width) == 0), 3, "out of range");
+
+	set_word(&b->data[pos], width, lua_toboolean(L, 4), (lua_Unsigned)value);
+
+	return 0;
+}
+
+static int get16(lua_State *L) { return get(L, 2); }
+static int get32(lua_State *L) { return get(L, 4); }
+static int get64(lua_State *L) { return get(L, 8); }
+static int set16(lua_State *L) { return set(L, 2); }
+static int set32(lua_State *L) { return set(L, 4); }
+static int set64(lua_State *L) { return set(L, 8); }
+
+static int sub(lua_State *L)
+{
+	struct buffer *parent = check_buffer(L, 1);
+	size_t start = 0;
+	size_t len = check_range(L, parent->len, 2, 3, &start);
+
+	/* The view keeps the buffer it points into alive through its user value */
+	struct buffer *view = (struct buffer *)lua_newuserdatauv(L, sizeof(struct buffer), 1);
+
+	*view = *parent;
+	view->data = parent->data + start;
+	view->len = len;
+
+	luaL_setmetatable(L, LUA_BUFFER_METATABLE);
+	lua_pushvalue(L, 1);
+	lua_setiuservalue(L, -2, 1);
+
+	return 1;
+}
+
+static int fill(lua_State *L)
+{
+	struct buffer *b = check_writable(L, 1);
+	lua_Integer byte = luaL_checkinteger(L, 2);
+	size_t start = 0;
+	size_t len = check_range(L, b->len, 3, 4, &start);
+
+	luaL_argcheck(L, byte >= 0 && byte <= UINT8_MAX, 2, "not a byte");
+
+	if (len > 0)
+		memset(&b->data[start], (int)byte, len);
+
+	return 0;
+}
+
+static int copy(lua_State *L)
+{
+	struct buffer *b = check_writable(L, 1);
+	size_t src_len = 0;
+	const uint8_t *src = check_bytes(L, 3, &src_len);
+	size_t src_start = 0;
+	size_t len = check_range(L, src_len, 4, 5, &src_start);
+	if (len == 0)
+		return 0;
+
+	size_t pos = check_pos(L, b->len, 2, len);
+
+	/* Source and destination may be views of the same memory */
+	memmove(&b->data[pos], &src[src_start], len);
+
+	return 0;
+}
+
+static int compare(lua_State *L)
+{
+	struct buffer *b = check_buffer(L, 1);
+	size_t other_len = 0;
+	const uint8_t *other = check_bytes(L, 2, &other_len);
+	size_t len = (b->len < other_len) ? b->len : other_len;
+	int result = (len > 0) ? memcmp(b->data, other, len) : 0;
+
+	if (result == 0)
+		result = (b->len > other_len) - (b->len < other_len);
+
+	lua_pushinteger(L, (result > 0) - (result < 0));
+
+	return 1;
+}
+
+static int to_string(lua_State *L)
+{
+	struct buffer *b = check_buffer(L, 1);
+	size_t start = 0;
+	size_t len = check_range(L, b->len, 2, 3, &start);
+
+	lua_pushlstring(L, (const char *)&b->data[start], len);
+
+	return 1;
+}
+
+static int meta_index(lua_State *L)
+{
+	if (lua_type(L, 2) == LUA_TNUMBER) {
+		struct buffer *b = check_buffer(L, 1);
+
+		lua_pushinteger(L, b->data[check_pos(L, b->len, 2, 1)]);
+
+		return 1;
+	}
+
+	/* Anything else is looked up in the method table */
+	lua_pushvalue(L, 2);
+	lua_rawget(L, lua_upvalueindex(1));
+
+	return 1;
+}
+
+static int meta_newindex(lua_State *L)
+{
+	struct buffer *b = check_writable(L, 1);
+	size_t pos = check_pos(L, b->len, 2, 1);
+	lua_Integer byte = luaL_checkinteger(L, 3);
+
+	luaL_argcheck(L, byte >= 0 && byte <= UINT8_MAX, 3, "not a byte");
+
+	b->data[pos] = (uint8_t)byte;
+
+	return 0;
+}
+
+static int meta_len(lua_State *L)
+{
+	lua_pushinteger(L, (lua_Integer)check_buffer(L, 1)->len);
+
+	return 1;
+}
+
+static int meta_eq(lua_State *L)
+{
+	/* Also called if only one of the operands is a buffer */
+	if (!luaL_testudata(L, 1, LUA_BUFFER_METATABLE) ||
+	    !luaL_testudata(L, 2, LUA_BUFFER_METATABLE)) {
+		lua_pushboolean(L, 0);
+
+		return 1;
+	}
+
+	struct buffer *a = check_buffer(L, 1);
+	struct buffer *b = check_buffer(L, 2);
+
+	lua_pushboolean(L, a->len == b->len && (a->len == 0 || !memcmp(a->data, b->data, a->len)));
+
+	return 1;
+}
+
+static int meta_tostring(lua_State *L)
+{
+	struct buffer *b = (struct buffer *)luaL_checkudata(L, 1, LUA_BUFFER_METATABLE);
+
+	lua_pushfstring(L, "buffer: %p (%I bytes%s)", (void *)b, (lua_Integer)b->len,
+			is_valid(b) ? "" : ", invalid");
+
+	return 1;
+}
+
+int lua_buffer_open(lua_State *L)
+{
+	static const luaL_Reg functions[] = {
+		{ "new", buffer_new },
+		{ "from", buffer_from },
+		{ "request", buffer_request },
+		{ NULL, NULL }
+	};
+
+	static const luaL_Reg methods[] = {
+		{ "get16", get16 },
+		{ "get32", get32 },
+		{ "get64", get64 },
+		{ "set16", set16 },
+		{ "set32", set32 },
+		{ "set64", set64 },
+		{ "sub", sub },
+		{ "fill", fill },
+		{ "copy", copy },
+		{ "compare", compare },
+		{ "string", to_string },
+		{ NULL, NULL }
+	};
+
+	static const luaL_Reg metamethods[] = {
+		{ "__newindex", meta_newindex },
+		{ "__len", meta_len },
+		{ "__eq", meta_eq },
+		{ "__tostring", meta_tostring },
+		{ NULL, NULL }
+	};
+
+	luaL_checktype(L, 1, LUA_TLIGHTUSERDATA);
+
+	if (luaL_newmetatable(L, LUA_BUFFER_METATABLE)) {
+		luaL_setfuncs(L, metamethods, 0);
+
+		/* __index serves bytes for integer keys and methods for names */
+		luaL_newlib(L, methods);
+		lua_pushcclosure(L, meta_index, 1);
+		lua_setfield(L, -2, "__index");
+	}
+	lua_pop(L, 1);
+
+	/* request() gets the window as its upvalue */
+	luaL_newlibtable(L, functions);
+	lua_pushvalue(L, 1);
+	luaL_setfuncs(L, functions, 1);
+
+	return 1;
+}
+
+bool lua_buffer_get(lua_State *L, int idx, const uint8_t **data, size_t *len)
+{
+	const struct buffer *b = (const struct buffer *)luaL_testudata(L, idx, LUA_BUFFER_METATABLE);
+
+	if (b == NULL || !is_valid(b))
+		return false;
+
+	*data = b->data;
+	*len = b->len;
+
+	return true;
+}
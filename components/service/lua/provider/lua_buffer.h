@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_BUFFER_H
+#define LUA_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <lua.h>
+
+/**
+ * The buffer module gives scripts bounds checked access to binary data
+ * without copying it into Lua strings:
+ *
+ *   buffer.new(size [, byte])   -> scratch buffer allocated from the Lua heap
+ *   buffer.from(string)         -> scratch buffer holding a copy of string
+ *   buffer.request()            -> read-only view of the current request's data
+ *
+ * Buffers are indexed from 1 like strings, b[i] reads and writes a byte and
+ * #b is the length. Methods:
+ *
+ *   b:get16(i [, big_endian]), b:get32(...), b:get64(...)
+ *   b:set16(i, value [, big_endian]), b:set32(...), b:set64(...)
+ *   b:sub(i [, j])              -> view of bytes i..j sharing b's memory
+ *   b:fill(byte [, i [, j]])
+ *   b:copy(pos, src [, i [, j]]) copies bytes i..j of a buffer or string to pos
+ *   b:compare(other)            -> -1, 0 or 1 comparing with a buffer or string
+ *   b:string([i [, j]])         -> copy of bytes i..j as a string
+ *
+ * Negative positions count from the end as for string.sub, ranges outside of
+ * the buffer raise an error. The request view points into the RPC shared
+ * memory and is only valid while that request is processed. A script that
+ * keeps the data across suspension must copy it to a scratch buffer. Views of
+ * it are read-only and the client can still modify the memory.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LUA_BUFFER_METATABLE	"ts_buffer"
+
+/*
+ * Memory that scripts can access for a limited time. The generation changes
+ * whenever the window is opened or closed, which invalidates earlier views.
+ */
+struct lua_buffer_window {
+	const uint8_t *data;
+	size_t len;
+	uint32_t generation;
+};
+
+/*
+ * Make data visible through buffer.request() until the window is closed.
+ */
+void lua_buffer_window_open(struct lua_buffer_window *window, const uint8_t *data, size_t len);
+
+/*
+ * Hide the window's data and invalidate all views of it.
+ */
+void lua_buffer_window_close(struct lua_buffer_window *window);
+
+/*
+ * lua_CFunction that creates the buffer module. The only argument is a light
+ * userdata pointing to the struct lua_buffer_window that backs
+ * buffer.request(), it must outlive the Lua state. Returns the module table.
+ */
+int lua_buffer_open(lua_State *L);
+
+/*
+ * Get the contents of the buffer at idx. Returns false if the value isn't a
+ * buffer or it is a view of a closed window.
+ */
+bool lua_buffer_get(lua_State *L, int idx, const uint8_t **data, size_t *len);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_BUFFER_H */
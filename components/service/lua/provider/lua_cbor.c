@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdbool.h>
+#include <qcbor/qcbor_encode.h>
+#include "lua_buffer.h"
+#include "lua_cbor.h"
+
+/* The array of results takes the first nesting level */
+#define LUA_CBOR_MAX_TABLE_DEPTH	(QCBOR_MAX_ARRAY_NESTING - 1)
+
+struct lua_cbor_encoder {
+	lua_State *L;
+	QCBOREncodeContext cbor;
+	const char *error_msg;
+	/* tables being encoded, from the outermost one down to the current one */
+	const void *path[LUA_CBOR_MAX_TABLE_DEPTH];
+};
+
+static bool encode_value(struct lua_cbor_encoder *encoder, int idx, int depth);
+static bool add_value(struct lua_cbor_encoder *encoder, int idx, int depth);
+
+/* Structural check only, enough to tell text from binary data */
+static bool is_utf8(const uint8_t *s, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len) {
+		size_t extra = 0;
+
+		if (s[i] < 0x80)
+			extra = 0;
+		else if (s[i] >= 0xc2 && s[i] <= 0xdf)
+			extra = 1;
+		else if (s[i] >= 0xe0 && s[i] <= 0xef)
+			extra = 2;
+		else if (s[i] >= 0xf0 && s[i] <= 0xf4)
+			extra = 3;
+		else
+			return false;
+
+		if (extra >= len - i)
+			return false;
+
+		for (size_t j = 1; j <= extra; j++) {
+			if ((s[i + j] & 0xc0) != 0x80)
+				return false;
+		}
+
+		i += extra + 1;
+	}
+
+	return true;
+}
+
+static void encode_string(struct lua_cbor_encoder *encoder, int idx)
+{
+	UsefulBufC string = { 0 };
+
+	string.ptr = lua_tolstring(encoder->L, idx, &string.len);
+
+	if (is_utf8(string.ptr, string.len))
+		QCBOREncode_AddText(&encoder->cbor, string);
+	else
+		QCBOREncode_AddBytes(&encoder->cbor, string);
+}
+
+/* Map keys other than integers and strings are left out */
+static bool is_valid_key(lua_State *L, int idx)
+{
+	return lua_type(L, idx) == LUA_TSTRING || lua_isinteger(L, idx);
+}
+
+static void encode_key(struct lua_cbor_encoder *encoder, int idx)
+{
+	if (lua_type(encoder->L, idx) == LUA_TSTRING)
+		encode_string(encoder, idx);
+	else
+		QCBOREncode_AddInt64(&encoder->cbor, lua_tointeger(encoder->L, idx));
+}
+
+/* Tables whose keys are exactly 1..n are sequences */
+static bool is_sequence(lua_State *L, int idx)
+{
+	lua_Unsigned len = lua_rawlen(L, idx);
+	lua_Unsigned count = 0;
+
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		lua_pop(L, 1);
+
+		if (!lua_isinteger(L, -1) || lua_tointeger(L, -1) < 1 ||
+		    (lua_Unsigned)lua_tointeger(L, -1) > len) {
+			lua_pop(L, 1);
+
+			return false;
+		}
+
+		count++;
+	}
+
+	return count == len;
+}
+
+static bool is_on_path(const struct lua_cbor_encoder *encoder, const void *table, int depth)
+{
+	for (int i = 0; i < depth; i++) {
+		if (encoder->path[i] == table)
+			return true;
+	}
+
+	return false;
+}
+
+static bool encode_table(struct lua_cbor_encoder *encoder, int idx, int depth)
+{
+	lua_State *L = encoder->L;
+	const void *table = lua_topointer(L, idx);
+
+	/* Tables that contain themselves and tables nested too deep are cut off */
+	if (depth >= LUA_CBOR_MAX_TABLE_DEPTH || is_on_path(encoder, table, depth)) {
+		QCBOREncode_AddNULL(&encoder->cbor);
+
+		return true;
+	}
+
+	encoder->path[depth] = table;
+
+	/* Room for the key, the value and a copy while inspecting it */
+	if (!lua_checkstack(L, 3)) {
+		encoder->error_msg = "out of stack space";
+
+		return false;
+	}
+
+	if (is_sequence(L, idx)) {
+		lua_Unsigned len = lua_rawlen(L, idx);
+
+		QCBOREncode_OpenArray(&encoder->cbor);
+
+		for (lua_Unsigned i = 1; i <= len; i++) {
+			lua_rawgeti(L, idx, (lua_Integer)i);
+			if (!encode_value(encoder, lua_gettop(L), depth + 1))
+				return false;
+			lua_pop(L, 1);
+		}
+
+		QCBOREncode_CloseArray(&encoder->cbor);
+
+		return true;
+	}
+
+	QCBOREncode_OpenMap(&encoder->cbor);
+
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		if (is_valid_key(L, -2)) {
+			encode_key(encoder, -2);
+			if (!encode_value(encoder, lua_gettop(L), depth + 1))
+				return false;
+		}
+		lua_pop(L, 1);
+	}
+
+	QCBOREncode_CloseMap(&encoder->cbor);
+
+	return true;
+}
+
+/*
+ * Returns false if the traversal has to stop. Once the encoder fails, e.g. because the
+ * buffer is full, the rest of the values is not visited. Every value takes at least one
+ * byte, so the work is bounded by the buffer size even if tables are shared.
+ */
+static bool encode_value(struct lua_cbor_encoder *encoder, int idx, int depth)
+{
+	if (!add_value(encoder, idx, depth))
+		return false;
+
+	return QCBOREncode_GetErrorState(&encoder->cbor) == QCBOR_SUCCESS;
+}
+
+static bool add_value(struct lua_cbor_encoder *encoder, int idx, int depth)
+{
+	lua_State *L = encoder->L;
+
+	switch (lua_type(L, idx)) {
+	case LUA_TNIL:
+		QCBOREncode_AddNULL(&encoder->cbor);
+		return true;
+
+	case LUA_TBOOLEAN:
+		QCBOREncode_AddBool(&encoder->cbor, lua_toboolean(L, idx));
+		return true;
+
+	case LUA_TNUMBER:
+		if (lua_isinteger(L, idx))
+			QCBOREncode_AddInt64(&encoder->cbor, lua_tointeger(L, idx));
+		else
+			QCBOREncode_AddDouble(&encoder->cbor, lua_tonumber(L, idx));
+		return true;
+
+	case LUA_TSTRING:
+		encode_string(encoder, idx);
+		return true;
+
+	case LUA_TTABLE:
+		return encode_table(encoder, idx, depth);
+
+	case LUA_TUSERDATA: {
+		const uint8_t *data = NULL;
+		size_t len = 0;
+
+		if (!lua_buffer_get(L, idx, &data, &len))
+			break;
+
+		/* Buffers are binary data */
+		QCBOREncode_AddBytes(&encoder->cbor, (UsefulBufC){ .ptr = data, .len = len });
+		return true;
+	}
+
+	default:
+		break;
+	}
+
+	/* Functions, threads and other userdata have no CBOR counterpart */
+	QCBOREncode_AddNULL(&encoder->cbor);
+
+	return true;
+}
+
+lua_status_t lua_cbor_encode(lua_State *L, int first, int count, uint8_t *buf, size_t buf_size,
+			     size_t *encoded_len, const char **error_msg)
+{
+	struct lua_cbor_encoder encoder = { .L = L, .error_msg = NULL };
+	UsefulBuf storage = { .ptr = buf, .len = buf_size };
+	UsefulBufC encoded = { 0 };
+	int top = lua_gettop(L);
+	bool success = true;
+
+	*encoded_len = 0;
+	*error_msg = NULL;
+
+	first = lua_absindex(L, first);
+
+	QCBOREncode_Init(&encoder.cbor, storage);
+	QCBOREncode_OpenArray(&encoder.cbor);
+
+	for (int i = 0; success && i < count; i++)
+		success = encode_value(&encoder, first + i, 0);
+
+	/* Drop whatever an aborted table traversal left behind */
+	lua_settop(L, top);
+
+	/* Otherwise the traversal stopped at an encoder error, which Finish reports */
+	if (!success && encoder.error_msg) {
+		*error_msg = encoder.error_msg;
+
+		return LUA_ERROR_UNSUPPORTED_RESULT;
+	}
+
+	QCBOREncode_CloseArray(&encoder.cbor);
+
+	switch (QCBOREncode_Finish(&encoder.cbor, &encoded)) {
+	case QCBOR_SUCCESS:
+		*encoded_len = encoded.len;
+		return LUA_SUCCESS;
+
+	case QCBOR_ERR_BUFFER_TOO_SMALL:
+		*error_msg = "results don't fit in the response";
+		return LUA_ERROR_BUFFER_TOO_SMALL;
+
+	default:
+		/* Such as too many values in a table */
+		*error_msg = "results can't be encoded as CBOR";
+		return LUA_ERROR_UNSUPPORTED_RESULT;
+	}
+}
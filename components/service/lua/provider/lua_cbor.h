@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_CBOR_H
+#define LUA_CBOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lua.h>
+#include "protocols/service/lua/status.h"
+
+/**
+ * Encodes the values returned by a script as a CBOR array, so that results
+ * reach the client as one compact payload. nil, booleans, integers, floats
+ * and strings map to their CBOR counterparts. Strings are encoded as text if
+ * they are valid UTF-8 and as byte strings otherwise, buffers always as byte
+ * strings. A table whose keys are exactly 1..n is encoded as an array, any
+ * other table as a map. Map entries whose key is not an integer or a string
+ * are left out. Values without a CBOR counterpart, such as functions, are
+ * encoded as null, and so are tables nested deeper than QCBOR allows and
+ * tables that contain themselves. Tables referenced more than once without
+ * forming a cycle are encoded each time. Encoding stops at the first encoder
+ * error, so the work is bounded by the size of the buffer.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Encode count values of L's stack starting at index first into buf. On
+ * success the length of the encoding is returned through encoded_len. Returns
+ * LUA_ERROR_BUFFER_TOO_SMALL if the encoding doesn't fit into buf and
+ * LUA_ERROR_UNSUPPORTED_RESULT if the values exceed other limits of the
+ * encoder, such as the number of entries of a table, error_msg then tells
+ * why. The stack of L is left unchanged.
+ */
+lua_status_t lua_cbor_encode(lua_State *L, int first, int count, uint8_t *buf, size_t buf_size,
+			     size_t *encoded_len, const char **error_msg);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_CBOR_H */
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <lauxlib.h>
+#include "lua_chunk_cache.h"
+
+static void unlink_active(struct lua_chunk_cache *cache, struct lua_chunk_cache_entry *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		cache->active_head = entry->next;
+
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		cache->active_tail = entry->prev;
+}
+
+static void link_active_head(struct lua_chunk_cache *cache, struct lua_chunk_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = cache->active_head;
+
+	if (cache->active_head)
+		cache->active_head->prev = entry;
+	else
+		cache->active_tail = entry;
+
+	cache->active_head = entry;
+}
+
+static void evict(struct lua_chunk_cache *cache, struct lua_chunk_cache_entry *entry)
+{
+	unlink_active(cache, entry);
+
+	luaL_unref(cache->lua_state, LUA_REGISTRYINDEX, entry->lua_func_ref);
+	entry->lua_func_ref = LUA_REFNIL;
+
+	cache->bytes_used -= entry->script.len;
+	lua_script_clear(&entry->script);
+
+	entry->next = cache->free;
+	entry->prev = NULL;
+	cache->free = entry;
+}
+
+void lua_chunk_cache_init(struct lua_chunk_cache *cache, lua_State *lua_state,
+	size_t byte_budget)
+{
+	cache->lua_state = lua_state;
+	cache->free = NULL;
+	cache->active_head = NULL;
+	cache->active_tail = NULL;
+	cache->byte_budget = byte_budget;
+	cache->bytes_used = 0;
+	cache->stats.hits = 0;
+	cache->stats.misses = 0;
+	cache->stats.evictions = 0;
+
+	for (size_t i = 0; i < LUA_CHUNK_CACHE_SIZE; i++) {
+		struct lua_chunk_cache_entry *entry = &cache->entries[i];
+
+		lua_script_init(&entry->script);
+		entry->lua_func_ref = LUA_REFNIL;
+		entry->prev = NULL;
+		entry->next = cache->free;
+		cache->free = entry;
+	}
+}
+
+void lua_chunk_cache_deinit(struct lua_chunk_cache *cache)
+{
+	while (cache->active_head)
+		evict(cache, cache->active_head);
+}
+
+bool lua_chunk_cache_lookup(struct lua_chunk_cache *cache, const struct lua_script *script)
+{
+	uint64_t digest = 0;
+
+	if (!cache->byte_budget || script->len > cache->byte_budget)
+		return false;
+
+	digest = lua_script_digest(script);
+
+	for (struct lua_chunk_cache_entry *entry = cache->active_head; entry; entry = entry->next) {
+		if (entry->digest == digest && lua_script_equal(&entry->script, script)) {
+			/* Move to the most recently used position */
+			unlink_active(cache, entry);
+			link_active_head(cache, entry);
+
+			lua_rawgeti(cache->lua_state, LUA_REGISTRYINDEX, entry->lua_func_ref);
+			cache->stats.hits++;
+
+			return true;
+		}
+	}
+
+	cache->stats.misses++;
+
+	return false;
+}
+
+bool lua_chunk_cache_insert(struct lua_chunk_cache *cache, struct lua_script *script)
+{
+	struct lua_chunk_cache_entry *entry = NULL;
+
+	if (!cache->byte_budget || script->len > cache->byte_budget)
+		return false;
+
+	/* Recycle least recently used entries until the new chunk fits */
+	while (cache->active_tail &&
+	       (!cache->free || cache->bytes_used + script->len > cache->byte_budget)) {
+		evict(cache, cache->active_tail);
+		cache->stats.evictions++;
+	}
+
+	entry = cache->free;
+	cache->free = entry->next;
+
+	/* Anchor a reference of the function in the registry */
+	lua_pushvalue(cache->lua_state, -1);
+	entry->lua_func_ref = luaL_ref(cache->lua_state, LUA_REGISTRYINDEX);
+
+	entry->digest = lua_script_digest(script);
+	cache->bytes_used += script->len;
+	lua_script_move(&entry->script, script);
+
+	link_active_head(cache, entry);
+
+	return true;
+}
+
+void lua_chunk_cache_get_stats(const struct lua_chunk_cache *cache,
+	struct lua_chunk_cache_stats *stats)
+{
+	*stats = cache->stats;
+}
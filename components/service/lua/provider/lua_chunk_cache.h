@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_CHUNK_CACHE_H
+#define LUA_CHUNK_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <lua.h>
+#include "lua_script.h"
+
+/**
+ * Clients commonly execute the same script many times, for example a test
+ * harness that is pushed into a fresh environment for every test case.  The
+ * chunk cache maps the digest of a script to the function that Lua compiled
+ * from it, so executing an identical script skips the parser.  Compiled
+ * functions are anchored in the Lua registry.  The cache takes over the
+ * script's chunks to confirm a digest match.  When the total size of cached
+ * scripts would exceed the byte budget, least recently used entries are
+ * evicted.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The default number of cache entries.  This may be overridden to meet the
+ * needs of a particular deployment.
+ */
+#ifndef LUA_CHUNK_CACHE_SIZE
+#define LUA_CHUNK_CACHE_SIZE		(16)
+#endif
+
+/**
+ * The default byte budget for cached scripts.  It is sized to hold a test
+ * harness of about 40 KB alongside a few smaller scripts.  A budget of zero
+ * disables the cache.
+ */
+#ifndef LUA_CHUNK_CACHE_BYTE_BUDGET
+#define LUA_CHUNK_CACHE_BYTE_BUDGET	(64 * 1024)
+#endif
+
+/**
+ * Counters of cache lookups and evictions since the cache was initialized
+ */
+struct lua_chunk_cache_stats {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+};
+
+/**
+ * A cached chunk
+ */
+struct lua_chunk_cache_entry {
+	uint64_t digest;
+	struct lua_script script;
+	int lua_func_ref;
+	struct lua_chunk_cache_entry *next;
+	struct lua_chunk_cache_entry *prev;
+};
+
+/**
+ * The chunk cache structure.  Active entries are held in most recently used
+ * order.
+ */
+struct lua_chunk_cache {
+	lua_State *lua_state;
+	struct lua_chunk_cache_entry entries[LUA_CHUNK_CACHE_SIZE];
+	struct lua_chunk_cache_entry *free;
+	struct lua_chunk_cache_entry *active_head;
+	struct lua_chunk_cache_entry *active_tail;
+	size_t byte_budget;
+	size_t bytes_used;
+	struct lua_chunk_cache_stats stats;
+};
+
+/*
+ * Initializes a lua_chunk_cache, called once during setup.
+ */
+void lua_chunk_cache_init(struct lua_chunk_cache *cache, lua_State *lua_state,
+	size_t byte_budget);
+
+/*
+ * De-initializes a lua_chunk_cache, releasing all cached chunks.
+ */
+void lua_chunk_cache_deinit(struct lua_chunk_cache *cache);
+
+/*
+ * Look up a script.  On a hit the compiled function is pushed onto the Lua
+ * stack and true is returned.  On a miss the stack is left unchanged.
+ */
+bool lua_chunk_cache_lookup(struct lua_chunk_cache *cache, const struct lua_script *script);
+
+/*
+ * Add the function on top of the Lua stack, compiled from script, to the
+ * cache.  The function is left on the stack.  On success the script's chunks
+ * are moved to the cache, leaving script empty.  If the script does not fit
+ * into the byte budget false is returned and script is left unchanged.
+ */
+bool lua_chunk_cache_insert(struct lua_chunk_cache *cache, struct lua_script *script);
+
+/*
+ * Get the lookup and eviction counters of the cache.
+ */
+void lua_chunk_cache_get_stats(const struct lua_chunk_cache *cache,
+	struct lua_chunk_cache_stats *stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_CHUNK_CACHE_H */
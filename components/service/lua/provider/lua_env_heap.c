@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lua_env_heap.h"
+
+struct lua_env_heap_block {
+	/* block size including the header */
+	size_t size;
+	size_t reserved;
+	/* link to the next free block, only valid while the block is free */
+	struct lua_env_heap_block *next;
+};
+
+#define BLOCK_HEADER_SIZE	(offsetof(struct lua_env_heap_block, next))
+#define MIN_BLOCK_SIZE		(2 * LUA_ENV_HEAP_GRANULE)
+
+static size_t round_up(size_t value, size_t granule)
+{
+	return (value + granule - 1) & ~(granule - 1);
+}
+
+static size_t block_size_for(size_t payload_size)
+{
+	if (payload_size > SIZE_MAX - BLOCK_HEADER_SIZE - LUA_ENV_HEAP_GRANULE)
+		return 0;
+
+	size_t size = round_up(payload_size + BLOCK_HEADER_SIZE, LUA_ENV_HEAP_GRANULE);
+
+	return (size < MIN_BLOCK_SIZE) ? MIN_BLOCK_SIZE : size;
+}
+
+static struct lua_env_heap_block *block_from_payload(void *ptr)
+{
+	return (struct lua_env_heap_block *)((uint8_t *)ptr - BLOCK_HEADER_SIZE);
+}
+
+static void *payload_from_block(struct lua_env_heap_block *block)
+{
+	return (uint8_t *)block + BLOCK_HEADER_SIZE;
+}
+
+static bool is_adjacent(struct lua_env_heap_block *lower, struct lua_env_heap_block *upper)
+{
+	return (uint8_t *)lower + lower->size == (uint8_t *)upper;
+}
+
+/* Insert a block into the address ordered free list, merging it with free neighbours */
+static void insert_free(struct lua_env_heap *heap, struct lua_env_heap_block *block)
+{
+	struct lua_env_heap_block *prev = NULL;
+	struct lua_env_heap_block *next = heap->free_list;
+
+	while (next && next < block) {
+		prev = next;
+		next = next->next;
+	}
+
+	block->next = next;
+
+	if (next && is_adjacent(block, next)) {
+		block->size += next->size;
+		block->next = next->next;
+	}
+
+	if (prev) {
+		prev->next = block;
+
+		if (is_adjacent(prev, block)) {
+			prev->size += block->size;
+			prev->next = block->next;
+		}
+	} else {
+		heap->free_list = block;
+	}
+}
+
+/* First-fit allocation from the free list, splitting off the unused tail */
+static struct lua_env_heap_block *take_free(struct lua_env_heap *heap, size_t size)
+{
+	struct lua_env_heap_block **link = &heap->free_list;
+
+	while (*link) {
+		struct lua_env_heap_block *block = *link;
+
+		if (block->size >= size) {
+			if (block->size - size >= MIN_BLOCK_SIZE) {
+				struct lua_env_heap_block *tail =
+					(struct lua_env_heap_block *)((uint8_t *)block + size);
+
+				tail->size = block->size - size;
+				tail->next = block->next;
+				block->size = size;
+				*link = tail;
+			} else {
+				*link = block->next;
+			}
+
+			return block;
+		}
+
+		link = &block->next;
+	}
+
+	return NULL;
+}
+
+/* Return all cached small blocks to the free list so they can be coalesced */
+static bool flush_small(struct lua_env_heap *heap)
+{
+	bool flushed = false;
+
+	for (size_t i = 0; i < sizeof(heap->small_free) / sizeof(heap->small_free[0]); i++) {
+		while (heap->small_free[i]) {
+			struct lua_env_heap_block *block = heap->small_free[i];
+
+			heap->small_free[i] = block->next;
+			insert_free(heap, block);
+			flushed = true;
+		}
+	}
+
+	return flushed;
+}
+
+static void *heap_malloc(struct lua_env_heap *heap, size_t payload_size)
+{
+	struct lua_env_heap_block *block = NULL;
+	size_t size = block_size_for(payload_size);
+
+	if (!size || heap->used > heap->limit || size > heap->limit - heap->used)
+		return NULL;
+
+	if (size <= LUA_ENV_HEAP_SMALL_LIMIT && heap->small_free[size / LUA_ENV_HEAP_GRANULE]) {
+		block = heap->small_free[size / LUA_ENV_HEAP_GRANULE];
+		heap->small_free[size / LUA_ENV_HEAP_GRANULE] = block->next;
+	} else {
+		block = take_free(heap, size);
+
+		if (!block && flush_small(heap))
+			block = take_free(heap, size);
+
+		if (!block)
+			return NULL;
+	}
+
+	heap->used += block->size;
+	heap->allocated += block->size;
+	if (heap->used > heap->peak)
+		heap->peak = heap->used;
+
+	return payload_from_block(block);
+}
+
+static void heap_free(struct lua_env_heap *heap, void *ptr)
+{
+	struct lua_env_heap_block *block = block_from_payload(ptr);
+
+	heap->used -= block->size;
+
+	if (block->size <= LUA_ENV_HEAP_SMALL_LIMIT) {
+		block->next = heap->small_free[block->size / LUA_ENV_HEAP_GRANULE];
+		heap->small_free[block->size / LUA_ENV_HEAP_GRANULE] = block;
+	} else {
+		insert_free(heap, block);
+	}
+}
+
+struct lua_env_heap *lua_env_heap_create(size_t size)
+{
+	struct lua_env_heap *heap = NULL;
+	uint8_t *arena = NULL;
+	uint8_t *arena_end = NULL;
+
+	heap = (struct lua_env_heap *)malloc(size);
+	if (!heap)
+		return NULL;
+
+	memset(heap, 0, sizeof(*heap));
+
+	/* The arena follows the heap structure */
+	arena = (uint8_t *)round_up((uintptr_t)(heap + 1), LUA_ENV_HEAP_GRANULE);
+	arena_end = (uint8_t *)(((uintptr_t)heap + size) & ~(uintptr_t)(LUA_ENV_HEAP_GRANULE - 1));
+
+	if (arena_end <= arena || (size_t)(arena_end - arena) < MIN_BLOCK_SIZE) {
+		free(heap);
+		return NULL;
+	}
+
+	heap->arena = arena;
+	heap->arena_size = arena_end - arena;
+	heap->limit = heap->arena_size;
+
+	heap->free_list = (struct lua_env_heap_block *)arena;
+	heap->free_list->size = heap->arena_size;
+	heap->free_list->next = NULL;
+
+	return heap;
+}
+
+void lua_env_heap_destroy(struct lua_env_heap *heap)
+{
+	free(heap);
+}
+
+void *lua_env_heap_alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	struct lua_env_heap *heap = (struct lua_env_heap *)ud;
+	void *new_ptr = NULL;
+
+	if (nsize == 0) {
+		if (ptr)
+			heap_free(heap, ptr);
+
+		return NULL;
+	}
+
+	/* When ptr is NULL osize encodes the object type, not a size */
+	if (!ptr)
+		return heap_malloc(heap, nsize);
+
+	/* Shrinking, or growing within the block's slack, is done in place */
+	if (nsize <= block_from_payload(ptr)->size - BLOCK_HEADER_SIZE)
+		return ptr;
+
+	new_ptr = heap_malloc(heap, nsize);
+	if (!new_ptr)
+		return NULL;
+
+	memcpy(new_ptr, ptr, osize);
+	heap_free(heap, ptr);
+
+	return new_ptr;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_ENV_HEAP_H
+#define LUA_ENV_HEAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A private heap for the Lua state of a single environment.  The heap is a
+ * fixed-size arena taken from the SP heap with one allocation, so a runaway
+ * script can only exhaust its own arena and deleting the environment returns
+ * the whole arena at once.  Small blocks are recycled through per size class
+ * free lists; larger blocks are served first-fit from an address ordered free
+ * list that coalesces neighbours.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Block sizes up to this limit are recycled through size class free lists */
+#define LUA_ENV_HEAP_SMALL_LIMIT	(256)
+#define LUA_ENV_HEAP_GRANULE		(16)
+
+struct lua_env_heap_block;
+
+struct lua_env_heap {
+	uint8_t *arena;
+	size_t arena_size;
+	/* allocation fails if it would take the used byte count above the limit */
+	size_t limit;
+	size_t used;
+	size_t peak;
+	/* bytes of all blocks ever allocated */
+	uint64_t allocated;
+	struct lua_env_heap_block *free_list;
+	struct lua_env_heap_block *small_free[LUA_ENV_HEAP_SMALL_LIMIT / LUA_ENV_HEAP_GRANULE + 1];
+};
+
+/*
+ * Creates a heap with an arena of the given size.  The heap structure itself is
+ * placed at the start of the arena.  Returns NULL if out of memory.
+ */
+struct lua_env_heap *lua_env_heap_create(size_t size);
+
+/*
+ * Destroys a heap, releasing the arena and every block allocated from it.
+ */
+void lua_env_heap_destroy(struct lua_env_heap *heap);
+
+/*
+ * lua_Alloc compatible allocation function, ud must point to a lua_env_heap.
+ * Shrinking a block never fails, as required by Lua.
+ */
+void *lua_env_heap_alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_ENV_HEAP_H */
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#if !defined(__aarch64__)
+/* clock_gettime is POSIX, not C99 */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include <time.h>
+#endif
+
+#include <lauxlib.h>
+#include "lua_metrics.h"
+
+/* Metatable of the object whose finalizer counts garbage collection cycles */
+#define LUA_GC_SENTINEL_META	"ts_gc_sentinel"
+
+/* Registry key of the number of completed garbage collection cycles */
+static const char gc_cycles_key;
+
+uint64_t lua_metrics_ticks(void)
+{
+#if defined(__aarch64__)
+	uint64_t ticks = 0;
+
+	/* Don't let the counter read be speculated ahead of earlier instructions */
+	__asm__ volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks) : : "memory");
+
+	return ticks;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+uint64_t lua_metrics_tick_frequency(void)
+{
+#if defined(__aarch64__)
+	uint64_t frequency = 0;
+
+	__asm__ volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+
+	return frequency;
+#else
+	return 1000000000u;
+#endif
+}
+
+static void *meter_alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	struct lua_alloc_meter *meter = (struct lua_alloc_meter *)ud;
+	/* When ptr is NULL osize encodes the object type, not a size */
+	size_t old_size = ptr ? osize : 0;
+	void *new_ptr = meter->alloc(meter->ud, ptr, osize, nsize);
+
+	if (nsize == 0) {
+		meter->in_use -= old_size;
+
+		return new_ptr;
+	}
+
+	if (new_ptr == NULL)
+		return NULL;
+
+	meter->in_use = meter->in_use - old_size + nsize;
+	if (meter->in_use > meter->peak)
+		meter->peak = meter->in_use;
+
+	if (nsize > old_size)
+		meter->allocated += nsize - old_size;
+
+	return new_ptr;
+}
+
+void lua_alloc_meter_attach(struct lua_alloc_meter *meter, lua_State *L)
+{
+	meter->alloc = lua_getallocf(L, &meter->ud);
+	meter->in_use = (size_t)lua_gc(L, LUA_GCCOUNT) * 1024 + (size_t)lua_gc(L, LUA_GCCOUNTB);
+	meter->peak = meter->in_use;
+	meter->allocated = 0;
+
+	lua_setallocf(L, meter_alloc, meter);
+}
+
+static void new_gc_sentinel(lua_State *L)
+{
+	lua_newtable(L);
+	luaL_setmetatable(L, LUA_GC_SENTINEL_META);
+	lua_pop(L, 1);
+}
+
+/* The sentinel is only reachable until it is created, so it is finalized by every cycle */
+static int gc_sentinel_finalize(lua_State *L)
+{
+	lua_rawgetp(L, LUA_REGISTRYINDEX, &gc_cycles_key);
+	lua_Integer cycles = lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	lua_pushinteger(L, cycles + 1);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &gc_cycles_key);
+
+	new_gc_sentinel(L);
+
+	return 0;
+}
+
+int lua_metrics_open(lua_State *L)
+{
+	lua_pushinteger(L, 0);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &gc_cycles_key);
+
+	/* __gc must be set before the metatable is assigned for the sentinel to be finalized */
+	if (luaL_newmetatable(L, LUA_GC_SENTINEL_META)) {
+		lua_pushcfunction(L, gc_sentinel_finalize);
+		lua_setfield(L, -2, "__gc");
+	}
+	lua_pop(L, 1);
+
+	new_gc_sentinel(L);
+
+	return 0;
+}
+
+uint64_t lua_metrics_gc_cycles(lua_State *L)
+{
+	lua_rawgetp(L, LUA_REGISTRYINDEX, &gc_cycles_key);
+	uint64_t cycles = (uint64_t)lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	return cycles;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_METRICS_H
+#define LUA_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lua.h>
+
+/**
+ * Execution metrics of an environment, accumulated over all the scripts it
+ * ran. Times are in ticks of the counter read by lua_metrics_ticks, the
+ * architectural counter on aarch64 and the monotonic clock in nanoseconds
+ * elsewhere.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct lua_env_metrics {
+	/* time spent compiling scripts, cache hits cost nothing */
+	uint64_t parse_ticks;
+	/* time spent running scripts */
+	uint64_t exec_ticks;
+	/* VM instructions, counted in steps of the hook period */
+	uint64_t instructions;
+	/* bytes allocated while compiling and running scripts */
+	uint64_t bytes_allocated;
+	/* peak memory use of the Lua state while the environment's scripts ran */
+	uint64_t peak_memory;
+	/* garbage collection cycles completed while the environment's scripts ran */
+	uint64_t gc_cycles;
+	/* scripts started by env_execute */
+	uint32_t execute_count;
+	/* slices the scripts ran in */
+	uint32_t slice_count;
+};
+
+/*
+ * Allocation counters of a Lua state whose allocator doesn't track them. The
+ * meter wraps the state's allocation function.
+ */
+struct lua_alloc_meter {
+	lua_Alloc alloc;
+	void *ud;
+	size_t in_use;
+	size_t peak;
+	uint64_t allocated;
+};
+
+/*
+ * Read the counter that times are measured with.
+ */
+uint64_t lua_metrics_ticks(void);
+
+/*
+ * Get the frequency of the counter in ticks per second.
+ */
+uint64_t lua_metrics_tick_frequency(void);
+
+/*
+ * Wrap the allocation function of L with the meter. The memory already in use
+ * is taken from the garbage collector.
+ */
+void lua_alloc_meter_attach(struct lua_alloc_meter *meter, lua_State *L);
+
+/*
+ * lua_CFunction that starts counting the completed garbage collection cycles of
+ * the Lua state, see lua_metrics_gc_cycles.
+ */
+int lua_metrics_open(lua_State *L);
+
+/*
+ * Get the number of garbage collection cycles completed since lua_metrics_open,
+ * including minor collections in generational mode.
+ */
+uint64_t lua_metrics_gc_cycles(lua_State *L);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_METRICS_H */
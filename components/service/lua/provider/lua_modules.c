@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <lauxlib.h>
+#include "lua_modules.h"
+
+/* Registry table mapping module names to their compiled main chunks */
+#define LUA_MODULES_KEY		"ts_modules"
+
+/* Metatable of the module environments, looks up missing keys in the global table */
+#define LUA_MODULE_ENV_META	"ts_module_env"
+
+/*
+ * require(name). Module initialization runs without yielding, a script isn't suspended by
+ * its instruction budget before the module is loaded. A suspended script would leave the
+ * module half initialized for other scripts of the Lua state.
+ */
+static int module_require(lua_State *L)
+{
+	const char *name = luaL_checkstring(L, 1);
+
+	lua_settop(L, 1);
+
+	/* 2: package.loaded */
+	luaL_getsubtable(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+	if (lua_getfield(L, 2, name) != LUA_TNIL)
+		return 1;
+	lua_pop(L, 1);
+
+	/* 3: compiled main chunk of the module */
+	if (lua_getfield(L, lua_upvalueindex(1), name) != LUA_TFUNCTION)
+		return luaL_error(L, "module '%s' not found", name);
+
+	/* Run the module in its own environment, its first upvalue is _ENV */
+	lua_newtable(L);
+	luaL_setmetatable(L, LUA_MODULE_ENV_META);
+	if (lua_setupvalue(L, 3, 1) == NULL)
+		lua_pop(L, 1);
+
+	lua_pushvalue(L, 1);
+	lua_call(L, 1, 1);
+
+	if (lua_isnil(L, 3)) {
+		lua_pop(L, 1);
+		lua_pushboolean(L, 1);
+	}
+
+	lua_pushvalue(L, 3);
+	lua_setfield(L, 2, name);
+
+	return 1;
+}
+
+int lua_modules_open(lua_State *L)
+{
+	luaL_getsubtable(L, LUA_REGISTRYINDEX, LUA_MODULES_KEY);
+	lua_pushcclosure(L, module_require, 1);
+	lua_setglobal(L, "require");
+
+	/* package.loaded is the table that luaL_requiref registers the standard libraries in */
+	lua_newtable(L);
+	luaL_getsubtable(L, LUA_REGISTRYINDEX, LUA_LOADED_TABLE);
+	lua_setfield(L, -2, "loaded");
+	lua_setglobal(L, "package");
+
+	if (luaL_newmetatable(L, LUA_MODULE_ENV_META)) {
+		lua_pushglobaltable(L);
+		lua_setfield(L, -2, "__index");
+	}
+	lua_pop(L, 1);
+
+	return 0;
+}
+
+int lua_modules_add(lua_State *L)
+{
+	const struct lua_module *module = (const struct lua_module *)lua_touserdata(L, 1);
+	const char *chunk_name = lua_pushfstring(L, "=%s", module->name);
+
+	/* Modules are part of the SP image, so they may be precompiled */
+	if (luaL_loadbufferx(L, (const char *)module->chunk, module->chunk_len, chunk_name,
+			     "bt") != LUA_OK)
+		return lua_error(L);
+
+	lua_getfield(L, LUA_REGISTRYINDEX, LUA_MODULES_KEY);
+	lua_insert(L, -2);
+	lua_setfield(L, -2, module->name);
+
+	return 0;
+}
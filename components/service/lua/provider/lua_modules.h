@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_MODULES_H
+#define LUA_MODULES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lua.h>
+
+/**
+ * Lua modules that are part of the SP image. Each module is compiled once per
+ * Lua state when it is added and scripts load it with require(name):
+ *
+ *   local helpers = require("helpers")
+ *
+ * The first require runs the module in a private environment that inherits
+ * the globals, so stray globals of the module don't leak into the global
+ * table. The value returned by the module, or true if it returned nothing, is
+ * cached in package.loaded and returned by later calls. Environments that
+ * share a Lua state share the loaded modules, so modules should not keep
+ * per-environment state. The standard libraries are found in package.loaded
+ * as well.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct lua_module {
+	const char *name;
+	/* Lua source or bytecode, must stay valid while the module is in use */
+	const uint8_t *chunk;
+	size_t chunk_len;
+};
+
+/*
+ * lua_CFunction that installs the require function and the package table as
+ * globals. Must be called before any module is added.
+ */
+int lua_modules_open(lua_State *L);
+
+/*
+ * lua_CFunction that compiles the module passed as a light userdata pointing to
+ * a struct lua_module and makes it available to require. Raises an error if
+ * the module doesn't compile.
+ */
+int lua_modules_add(lua_State *L);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_MODULES_H */
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lua_output.h"
+
+static void reverse(uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len / 2; i++) {
+		uint8_t tmp = data[i];
+
+		data[i] = data[len - 1 - i];
+		data[len - 1 - i] = tmp;
+	}
+}
+
+void lua_output_init(struct lua_output *output)
+{
+	output->data = NULL;
+	output->start = 0;
+	output->len = 0;
+	output->lost_len = 0;
+}
+
+void lua_output_deinit(struct lua_output *output)
+{
+	free(output->data);
+	lua_output_init(output);
+}
+
+bool lua_output_write(struct lua_output *output, const uint8_t *data, size_t len)
+{
+	if (!len)
+		return true;
+
+	if (!output->data) {
+		output->data = malloc(LUA_OUTPUT_BUFFER_SIZE);
+		if (!output->data)
+			return false;
+	}
+
+	/* Only the tail of an oversized write can be kept */
+	if (len > LUA_OUTPUT_BUFFER_SIZE) {
+		output->lost_len += output->len + len - LUA_OUTPUT_BUFFER_SIZE;
+		output->start = 0;
+		output->len = 0;
+		data += len - LUA_OUTPUT_BUFFER_SIZE;
+		len = LUA_OUTPUT_BUFFER_SIZE;
+	}
+
+	/* Make room by dropping the oldest output */
+	if (output->len + len > LUA_OUTPUT_BUFFER_SIZE) {
+		size_t overflow = output->len + len - LUA_OUTPUT_BUFFER_SIZE;
+
+		output->start = (output->start + overflow) % LUA_OUTPUT_BUFFER_SIZE;
+		output->len -= overflow;
+		output->lost_len += overflow;
+	}
+
+	size_t end = (output->start + output->len) % LUA_OUTPUT_BUFFER_SIZE;
+	size_t first_len = LUA_OUTPUT_BUFFER_SIZE - end;
+
+	if (first_len > len)
+		first_len = len;
+
+	memcpy(&output->data[end], data, first_len);
+	memcpy(output->data, &data[first_len], len - first_len);
+	output->len += len;
+
+	return true;
+}
+
+size_t lua_output_peek(struct lua_output *output, const uint8_t **data)
+{
+	if (!output->len) {
+		*data = NULL;
+		return 0;
+	}
+
+	/* Rotate wrapped output to the start of the buffer */
+	if (output->start + output->len > LUA_OUTPUT_BUFFER_SIZE) {
+		reverse(output->data, output->start);
+		reverse(&output->data[output->start], LUA_OUTPUT_BUFFER_SIZE - output->start);
+		reverse(output->data, LUA_OUTPUT_BUFFER_SIZE);
+		output->start = 0;
+	}
+
+	*data = &output->data[output->start];
+
+	return output->len;
+}
+
+void lua_output_consume(struct lua_output *output, size_t len)
+{
+	if (len >= output->len) {
+		output->start = 0;
+		output->len = 0;
+	} else {
+		output->start = (output->start + len) % LUA_OUTPUT_BUFFER_SIZE;
+		output->len -= len;
+	}
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_OUTPUT_H
+#define LUA_OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Captures the output a script prints so that it can be returned to the
+ * client in bulk instead of emitting a log message for every print call.
+ * The output is held in a ring buffer that is allocated on the first write.
+ * When the buffer is full the oldest output is overwritten and counted as
+ * lost.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The default size of the output ring buffer of an environment.  This may be
+ * overridden to meet the needs of a particular deployment.
+ */
+#ifndef LUA_OUTPUT_BUFFER_SIZE
+#define LUA_OUTPUT_BUFFER_SIZE		(1024)
+#endif
+
+struct lua_output {
+	uint8_t *data;
+	size_t start;
+	size_t len;
+	/* bytes overwritten before they were read */
+	size_t lost_len;
+};
+
+/*
+ * Initializes an empty lua_output, no buffer is allocated yet.
+ */
+void lua_output_init(struct lua_output *output);
+
+/*
+ * Releases the buffer and discards all output.
+ */
+void lua_output_deinit(struct lua_output *output);
+
+/*
+ * Append output, overwriting the oldest output if the buffer is full.  Returns
+ * false if the buffer couldn't be allocated.
+ */
+bool lua_output_write(struct lua_output *output, const uint8_t *data, size_t len);
+
+/*
+ * Get the buffered output as a single contiguous block, without consuming it.
+ * Returns the length of the output.
+ */
+size_t lua_output_peek(struct lua_output *output, const uint8_t **data);
+
+/*
+ * Consume the first len bytes of the buffered output.
+ */
+void lua_output_consume(struct lua_output *output, size_t len);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_OUTPUT_H */
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <qcbor/qcbor_encode.h>
+#include "lua_profiler.h"
+
+void lua_profiler_init(struct lua_profiler *profiler, int interval)
+{
+	profiler->interval = interval;
+	lua_profiler_reset(profiler);
+}
+
+void lua_profiler_reset(struct lua_profiler *profiler)
+{
+	profiler->countdown = profiler->interval;
+	profiler->sample_count = 0;
+	profiler->lost_count = 0;
+	profiler->num_frames = 0;
+	profiler->num_stacks = 0;
+}
+
+/* Index of the frame described by ar, added to the frame table if it is new */
+static int find_frame(struct lua_profiler *profiler, const lua_Debug *ar)
+{
+	const char *name = ar->name ? ar->name : (*ar->what == 'm' ? "main" : "?");
+	struct lua_profile_frame *frame = NULL;
+
+	for (size_t i = 0; i < profiler->num_frames; i++) {
+		frame = &profiler->frames[i];
+
+		if (frame->line == ar->currentline && frame->line_defined == ar->linedefined &&
+		    !strncmp(frame->name, name, sizeof(frame->name) - 1) &&
+		    !strcmp(frame->source, ar->short_src))
+			return (int)i;
+	}
+
+	if (profiler->num_frames >= LUA_PROFILE_MAX_FRAMES)
+		return -1;
+
+	frame = &profiler->frames[profiler->num_frames];
+	strncpy(frame->name, name, sizeof(frame->name) - 1);
+	frame->name[sizeof(frame->name) - 1] = '\0';
+	memcpy(frame->source, ar->short_src, sizeof(frame->source));
+	frame->line_defined = ar->linedefined;
+	frame->line = ar->currentline;
+
+	return (int)profiler->num_frames++;
+}
+
+static void take_sample(struct lua_profiler *profiler, lua_State *L)
+{
+	uint8_t frames[LUA_PROFILE_MAX_DEPTH];
+	uint8_t depth = 0;
+	lua_Debug ar;
+
+	profiler->sample_count++;
+
+	/* Level 0 is the innermost function, frames are stored outermost first */
+	for (int level = 0; depth < LUA_PROFILE_MAX_DEPTH && lua_getstack(L, level, &ar); level++) {
+		int frame = 0;
+
+		lua_getinfo(L, "Sln", &ar);
+
+		frame = find_frame(profiler, &ar);
+		if (frame < 0) {
+			profiler->lost_count++;
+			return;
+		}
+
+		frames[LUA_PROFILE_MAX_DEPTH - 1 - depth++] = (uint8_t)frame;
+	}
+
+	const uint8_t *stack_frames = &frames[LUA_PROFILE_MAX_DEPTH - depth];
+
+	for (size_t i = 0; i < profiler->num_stacks; i++) {
+		struct lua_profile_stack *stack = &profiler->stacks[i];
+
+		if (stack->depth == depth && !memcmp(stack->frames, stack_frames, depth)) {
+			stack->count++;
+			return;
+		}
+	}
+
+	if (profiler->num_stacks >= LUA_PROFILE_MAX_STACKS) {
+		profiler->lost_count++;
+		return;
+	}
+
+	struct lua_profile_stack *stack = &profiler->stacks[profiler->num_stacks++];
+
+	stack->count = 1;
+	stack->depth = depth;
+	memcpy(stack->frames, stack_frames, depth);
+}
+
+void lua_profiler_count(struct lua_profiler *profiler, lua_State *L, int instructions)
+{
+	profiler->countdown -= instructions;
+	if (profiler->countdown > 0)
+		return;
+
+	/* The overshoot counts towards the next interval */
+	profiler->countdown += profiler->interval;
+	take_sample(profiler, L);
+}
+
+lua_status_t lua_profiler_encode(const struct lua_profiler *profiler, uint8_t *buf,
+				 size_t buf_size, size_t *encoded_len)
+{
+	QCBOREncodeContext cbor;
+	UsefulBuf storage = { .ptr = buf, .len = buf_size };
+	UsefulBufC encoded = { 0 };
+
+	*encoded_len = 0;
+
+	/* Encoded like the results of a script that returns the profile as a table */
+	QCBOREncode_Init(&cbor, storage);
+	QCBOREncode_OpenArray(&cbor);
+	QCBOREncode_OpenMap(&cbor);
+	QCBOREncode_AddInt64ToMap(&cbor, "interval", profiler->interval);
+	QCBOREncode_AddInt64ToMap(&cbor, "samples", profiler->sample_count);
+	QCBOREncode_AddInt64ToMap(&cbor, "lost", profiler->lost_count);
+
+	QCBOREncode_OpenArrayInMap(&cbor, "frames");
+	for (size_t i = 0; i < profiler->num_frames; i++) {
+		const struct lua_profile_frame *frame = &profiler->frames[i];
+
+		QCBOREncode_OpenArray(&cbor);
+		QCBOREncode_AddSZString(&cbor, frame->name);
+		QCBOREncode_AddSZString(&cbor, frame->source);
+		QCBOREncode_AddInt64(&cbor, frame->line_defined);
+		QCBOREncode_AddInt64(&cbor, frame->line);
+		QCBOREncode_CloseArray(&cbor);
+	}
+	QCBOREncode_CloseArray(&cbor);
+
+	QCBOREncode_OpenArrayInMap(&cbor, "stacks");
+	for (size_t i = 0; i < profiler->num_stacks; i++) {
+		const struct lua_profile_stack *stack = &profiler->stacks[i];
+
+		QCBOREncode_OpenArray(&cbor);
+		QCBOREncode_AddInt64(&cbor, stack->count);
+		for (uint8_t j = 0; j < stack->depth; j++)
+			QCBOREncode_AddInt64(&cbor, stack->frames[j]);
+		QCBOREncode_CloseArray(&cbor);
+	}
+	QCBOREncode_CloseArray(&cbor);
+
+	QCBOREncode_CloseMap(&cbor);
+	QCBOREncode_CloseArray(&cbor);
+
+	switch (QCBOREncode_Finish(&cbor, &encoded)) {
+	case QCBOR_SUCCESS:
+		*encoded_len = encoded.len;
+		return LUA_SUCCESS;
+
+	case QCBOR_ERR_BUFFER_TOO_SMALL:
+		return LUA_ERROR_BUFFER_TOO_SMALL;
+
+	default:
+		return LUA_ERROR_GENERIC_ERROR;
+	}
+}
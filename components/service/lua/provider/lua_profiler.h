@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_PROFILER_H
+#define LUA_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <lua.h>
+#include "protocols/service/lua/status.h"
+
+/**
+ * Sampling profiler for the scripts of an environment. A count hook takes a
+ * sample every interval VM instructions by walking the call stack of the
+ * running script. Distinct frames, identified by function and current line,
+ * and distinct stacks of frames are counted in fixed size tables, samples that
+ * don't fit are counted as lost. The profile is encoded like the results of a
+ * script that returns it as a single table, a CBOR array holding the map:
+ *
+ *   {
+ *     "interval": instructions between samples,
+ *     "samples":  number of samples taken,
+ *     "lost":     samples that didn't fit in the tables,
+ *     "frames":   [ [name, source, line_defined, line], ... ],
+ *     "stacks":   [ [count, frame, ...], ... ]
+ *   }
+ *
+ * A stack lists indices into frames from the outermost to the innermost
+ * function. Stacks deeper than LUA_PROFILE_MAX_DEPTH keep their innermost
+ * frames. Every stack maps to a line of the folded format used by flame graph
+ * tools, the frame names joined by ';' followed by the count.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The default sizes of the profile tables.  These may be overridden to meet the
+ * needs of a particular deployment.
+ */
+#ifndef LUA_PROFILE_MAX_FRAMES
+#define LUA_PROFILE_MAX_FRAMES		(32)
+#endif
+
+#ifndef LUA_PROFILE_MAX_STACKS
+#define LUA_PROFILE_MAX_STACKS		(32)
+#endif
+
+#ifndef LUA_PROFILE_MAX_DEPTH
+#define LUA_PROFILE_MAX_DEPTH		(8)
+#endif
+
+#if LUA_PROFILE_MAX_FRAMES > 256
+#error "Frame indices of stacks are a single byte"
+#endif
+
+/* Function names are truncated to this length */
+#define LUA_PROFILE_NAME_LEN		(24)
+
+struct lua_profile_frame {
+	char name[LUA_PROFILE_NAME_LEN];
+	char source[LUA_IDSIZE];
+	int line_defined;
+	/* -1 for C functions */
+	int line;
+};
+
+struct lua_profile_stack {
+	uint32_t count;
+	uint8_t depth;
+	uint8_t frames[LUA_PROFILE_MAX_DEPTH];
+};
+
+struct lua_profiler {
+	/* instructions between samples */
+	int interval;
+	/* instructions left until the next sample */
+	int countdown;
+	uint32_t sample_count;
+	uint32_t lost_count;
+	size_t num_frames;
+	size_t num_stacks;
+	struct lua_profile_frame frames[LUA_PROFILE_MAX_FRAMES];
+	struct lua_profile_stack stacks[LUA_PROFILE_MAX_STACKS];
+};
+
+/*
+ * Initializes an empty profile.
+ */
+void lua_profiler_init(struct lua_profiler *profiler, int interval);
+
+/*
+ * Discards the samples taken so far.
+ */
+void lua_profiler_reset(struct lua_profiler *profiler);
+
+/*
+ * Counts the instructions run since the previous call and takes a sample of the
+ * call stack of L once another interval has passed. To be called from a hook
+ * that runs at most every interval instructions.
+ */
+void lua_profiler_count(struct lua_profiler *profiler, lua_State *L, int instructions);
+
+/*
+ * Encodes the profile as CBOR into buf. Returns LUA_ERROR_BUFFER_TOO_SMALL if it
+ * doesn't fit.
+ */
+lua_status_t lua_profiler_encode(const struct lua_profiler *profiler, uint8_t *buf,
+				 size_t buf_size, size_t *encoded_len);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_PROFILER_H */
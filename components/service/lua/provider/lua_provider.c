@@ -3,6 +3,8 @@
  * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
  */
 
+#include <limits.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <lua.h>
@@ -12,170 +14,1616 @@
 #include "protocols/rpc/common/packed-c/status.h"
 #include "protocols/service/lua/status.h"
 #include "protocols/service/lua/packed-c/lua_proto.h"
+#include "lua_cbor.h"
+#include "lua_metrics.h"
 #include "lua_provider.h"
 #include "lua_uuid.h"
 #include "trace.h"
 #include "util.h"
 
+/* Binary chunk version and format expected by lundump.c */
+#define LUA_BYTECODE_VERSION	((LUA_VERSION_NUM / 100) * 16 + LUA_VERSION_NUM % 100)
+#define LUA_BYTECODE_FORMAT	(0)
+
+/* Nesting of template tables copied into a clone, bounds the C stack used to copy them */
+#define LUA_CLONE_MAX_TABLE_DEPTH	(16)
+
 /* Service request handlers */
 static rpc_status_t env_create_handler(void *context, struct rpc_request *req);
+static rpc_status_t env_clone_handler(void *context, struct rpc_request *req);
 static rpc_status_t env_append_handler(void *context, struct rpc_request *req);
+static rpc_status_t env_append_bytecode_handler(void *context, struct rpc_request *req);
 static rpc_status_t env_execute_handler(void *context, struct rpc_request *req);
 static rpc_status_t env_delete_handler(void *context, struct rpc_request *req);
+static rpc_status_t env_run_handler(void *context, struct rpc_request *req);
+static rpc_status_t env_resume_handler(void *context, struct rpc_request *req);
+static rpc_status_t env_read_output_handler(void *context, struct rpc_request *req);
+static rpc_status_t env_profile_result_handler(void *context, struct rpc_request *req);
+static rpc_status_t env_stats_handler(void *context, struct rpc_request *req);
+
+/* Handler mapping table for service */
+static const struct service_handler handler_table[] = {
+	{TS_LUA_OPCODE_ENV_CREATE,  env_create_handler},
+	{TS_LUA_OPCODE_ENV_APPEND,  env_append_handler},
+	{TS_LUA_OPCODE_ENV_EXECUTE, env_execute_handler},
+	{TS_LUA_OPCODE_ENV_DELETE,  env_delete_handler},
+	{TS_LUA_OPCODE_ENV_APPEND_BYTECODE, env_append_bytecode_handler},
+	{TS_LUA_OPCODE_ENV_RUN,     env_run_handler},
+	{TS_LUA_OPCODE_ENV_RESUME,  env_resume_handler},
+	{TS_LUA_OPCODE_ENV_READ_OUTPUT, env_read_output_handler},
+	{TS_LUA_OPCODE_ENV_CLONE,   env_clone_handler},
+	{TS_LUA_OPCODE_ENV_PROFILE_RESULT, env_profile_result_handler},
+	{TS_LUA_OPCODE_ENV_STATS,   env_stats_handler}
+};
+
+/* Registry key of the environment whose script is running */
+static const char running_env_key;
+
+/*
+ * C-binding for Lua's print function following Lua's luaB_print implementation. The printed
+ * line is captured in the output buffer of the running script's environment. Without an
+ * environment, or if LUA_OUTPUT_TRACE is set, it is sent to the trace log with a single call.
+ */
+static int lua_log(lua_State *L) {
+	struct lua_provider *context = (struct lua_provider *)lua_touserdata(L, lua_upvalueindex(1));
+	luaL_Buffer line;
+	size_t len = 0;
+	bool captured = false;
+
+	/* Get number of arguments */
+	int n = lua_gettop(L);
+
+	luaL_buffinit(L, &line);
+	for (int i = 1; i <= n; i++) {
+		if (i > 1)
+			luaL_addchar(&line, '\t');
+
+		luaL_tolstring(L, i, NULL);
+		luaL_addvalue(&line);
+	}
+	luaL_pushresult(&line);
+
+	const char *s = lua_tolstring(L, -1, &len);
+
+	if (context->active_output != NULL)
+		captured = lua_output_write(context->active_output, (const uint8_t *)s, len) &&
+			   lua_output_write(context->active_output, (const uint8_t *)"\n", 1);
+
+	if (!captured || LUA_OUTPUT_TRACE)
+		ts_trace_printf("", 0, TRACE_LEVEL_NONE, "%s", s);
+
+	return 0;
+}
+
+/* Open the binding passed as the only argument and set its module table as a global */
+static int open_binding(lua_State *L)
+{
+	const struct lua_binding *binding = (const struct lua_binding *)lua_touserdata(L, 1);
+
+	lua_pushcfunction(L, binding->open);
+	lua_pushlightuserdata(L, binding->context);
+	lua_call(L, 1, 1);
+	lua_setglobal(L, binding->name);
+
+	return 0;
+}
+
+/*
+ * Load common libraries and global C bindings of the provider into a new Lua state. Runs in protected mode
+ * as a lua_CFunction, so running out of memory is reported instead of calling the panic
+ * handler.
+ */
+static int open_lua_state(lua_State *L)
+{
+	/* The provider is passed as the only argument */
+	struct lua_provider *context = (struct lua_provider *)lua_touserdata(L, 1);
+
+	/* Load common libraries into global environment */
+    luaL_requiref(L, "_G", luaopen_base, 1);
+    lua_pop(L, 1);
+    luaL_requiref(L, LUA_MATHLIBNAME, luaopen_math, 1);
+    lua_pop(L, 1);
+    luaL_requiref(L, LUA_STRLIBNAME, luaopen_string, 1);
+    lua_pop(L, 1);
+    luaL_requiref(L, LUA_TABLIBNAME, luaopen_table, 1);
+    lua_pop(L, 1);
+    luaL_requiref(L, LUA_COLIBNAME, luaopen_coroutine, 1);
+    lua_pop(L, 1);
+    luaL_requiref(L, LUA_UTF8LIBNAME, luaopen_utf8, 1);
+    lua_pop(L, 1);
+
+	/* Setup global C bindings */
+	/* Make print point to lua_log that uses ts_trace_printf for logging */
+	lua_pushlightuserdata(L, context);
+	lua_pushcclosure(L, lua_log, 1);
+	lua_setglobal(L, "print");
+
+	/* Binary data access without copying it to strings */
+	lua_pushcfunction(L, lua_buffer_open);
+	lua_pushlightuserdata(L, &context->request_window);
+	lua_call(L, 1, 1);
+	lua_setglobal(L, "buffer");
+
+	/* Native bindings registered by the deployment */
+	for (size_t i = 0; i < context->num_bindings; i++) {
+		lua_pushcfunction(L, open_binding);
+		lua_pushlightuserdata(L, &context->bindings[i]);
+		lua_call(L, 1, 0);
+	}
+
+	/* require() and the Lua modules registered by the deployment */
+	lua_pushcfunction(L, lua_modules_open);
+	lua_call(L, 0, 0);
+
+	for (size_t i = 0; i < context->num_modules; i++) {
+		lua_pushcfunction(L, lua_modules_add);
+		lua_pushlightuserdata(L, (void *)context->modules[i]);
+		lua_call(L, 1, 0);
+	}
+
+	/*
+	 * The hook of a running script finds its environment under this key. It is created
+	 * here so that updating it for every slice doesn't allocate.
+	 */
+	lua_pushboolean(L, 0);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &running_env_key);
+
+	/* Count garbage collection cycles for the environment metrics */
+	lua_pushcfunction(L, lua_metrics_open);
+	lua_call(L, 0, 0);
+
+    /* Create a metatable in registry. This is where environments will look up a key
+     * in case they don't find a it in their own table.
+	 */
+    if (luaL_newmetatable(L, "global_env_meta")) {
+        /* Set new metatable (global_env_meta) __index field to point to global table */
+        lua_pushglobaltable(L);
+        lua_setfield(L, -2, "__index");
+    }
+    lua_pop(L, 1);
+
+	return 0;
+}
+
+static void apply_gc_params(lua_State *L, const struct lua_gc_params *gc_params)
+{
+	if (gc_params->generational)
+		lua_gc(L, LUA_GCGEN, 0, 0);
+	else
+		lua_gc(L, LUA_GCINC, gc_params->pause, gc_params->stepmul, 0);
+}
+
+/*
+ * Create a Lua state that allocates from a private heap of env_heap_size bytes. On
+ * success the heap is returned through heap, it must be destroyed after closing the state.
+ */
+static lua_State *new_env_state(struct lua_provider *context, struct lua_env_heap **heap)
+{
+	lua_State *L = NULL;
+
+	*heap = lua_env_heap_create(context->env_heap_size);
+	if (*heap == NULL)
+		return NULL;
+
+	L = lua_newstate(lua_env_heap_alloc, *heap);
+	if (L != NULL) {
+		lua_pushcfunction(L, open_lua_state);
+		lua_pushlightuserdata(L, context);
+		if (lua_pcall(L, 1, 0, 0) == LUA_OK) {
+			apply_gc_params(L, &context->gc_params);
+
+			return L;
+		}
+
+		lua_close(L);
+	}
+
+	lua_env_heap_destroy(*heap);
+	*heap = NULL;
+
+	return NULL;
+}
+
+/* Create an environment table and return a registry reference to it, runs in protected mode */
+static int new_env_table(lua_State *L)
+{
+	/* Create new table for environment */
+	lua_newtable(L);
+
+	/* Set new table's metatable to global_env_meta that points to the global environment */
+	luaL_setmetatable(L, "global_env_meta");
+
+	/* Create and return reference to newly created table */
+	lua_pushinteger(L, luaL_ref(L, LUA_REGISTRYINDEX));
+
+	return 1;
+}
+
+static int frozen_env_newindex(lua_State *L)
+{
+	return luaL_error(L, "attempt to create global '%s' in a frozen environment",
+			  luaL_tolstring(L, 2, NULL));
+}
+
+/*
+ * Freeze the template environment table passed as the only argument, runs in protected
+ * mode. The template keeps looking up missing globals where it did before, but can't get
+ * new globals any more.
+ */
+static int freeze_env_table(lua_State *L)
+{
+	/* Metatable of the template, {__index = <previous __index>, __newindex = error} */
+	lua_newtable(L);
+	lua_getmetatable(L, 1);
+	lua_getfield(L, -1, "__index");
+	lua_setfield(L, -3, "__index");
+	lua_pop(L, 1);
+	lua_pushcfunction(L, frozen_env_newindex);
+	lua_setfield(L, -2, "__newindex");
+	lua_setmetatable(L, 1);
+
+	return 0;
+}
+
+/*
+ * Push a copy of the table at idx and of the tables nested in it. The copies table at
+ * index copies maps the tables copied so far to their copy, so tables reachable on several
+ * paths, including cycles, are copied once. Keys and metatables aren't copied.
+ */
+static void copy_table(lua_State *L, int idx, int copies, int depth)
+{
+	if (depth >= LUA_CLONE_MAX_TABLE_DEPTH)
+		luaL_error(L, "template table nested too deep to copy");
+
+	luaL_checkstack(L, 4, "template table nested too deep to copy");
+
+	lua_pushvalue(L, idx);
+	if (lua_rawget(L, copies) == LUA_TTABLE)
+		return;
+	lua_pop(L, 1);
+
+	lua_newtable(L);
+	int copy = lua_gettop(L);
+
+	lua_pushvalue(L, idx);
+	lua_pushvalue(L, copy);
+	lua_rawset(L, copies);
+
+	lua_pushnil(L);
+	while (lua_next(L, idx)) {
+		if (lua_type(L, -1) == LUA_TTABLE) {
+			copy_table(L, lua_gettop(L), copies, depth + 1);
+			lua_replace(L, -2);
+		}
+
+		lua_pushvalue(L, -2);
+		lua_insert(L, -2);
+		lua_rawset(L, copy);
+	}
+
+	if (lua_getmetatable(L, idx))
+		lua_setmetatable(L, copy);
+}
+
+/*
+ * __index of a clone, upvalue 1 is the template and upvalue 2 the clone's copies of its
+ * tables. Tables are copied into the clone on first use, so that changes to nested
+ * tables stay in the clone, e.g. config.limit = 1 when config is defined by the template.
+ * Only tables the template or the templates it was cloned from define are copied, globals
+ * they look up elsewhere, such as the libraries and _G, are shared.
+ */
+static int clone_env_index(lua_State *L)
+{
+	lua_pushvalue(L, lua_upvalueindex(1));
+	int env = lua_gettop(L);
+
+	/* Raw lookups, __index of a frozen template would add to the template */
+	for (;;) {
+		lua_pushvalue(L, 2);
+		if (lua_rawget(L, env) != LUA_TNIL)
+			break;
+
+		lua_pop(L, 1);
+
+		if (!lua_getmetatable(L, env))
+			return 0;
+
+		lua_getfield(L, -1, "__index");
+
+		if (lua_tocfunction(L, -1) != clone_env_index) {
+			/* Not defined by a template, look it up where the template does */
+			lua_pushvalue(L, 2);
+			lua_gettable(L, env);
+
+			return 1;
+		}
+
+		/* The template is a clone itself, continue with its template */
+		lua_getupvalue(L, -1, 1);
+		lua_replace(L, env);
+		lua_pop(L, 2);
+	}
+
+	if (lua_type(L, -1) != LUA_TTABLE)
+		return 1;
+
+	copy_table(L, lua_gettop(L), lua_upvalueindex(2), 0);
+
+	lua_pushvalue(L, 2);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, 1);
+
+	return 1;
+}
+
+/*
+ * Create the environment table of a clone of the template passed as the only argument and
+ * return a registry reference to it, runs in protected mode.
+ */
+static int new_clone_table(lua_State *L)
+{
+	lua_newtable(L);
+
+	/* {__index = clone_env_index} */
+	lua_createtable(L, 0, 1);
+	lua_pushvalue(L, 1);
+	lua_newtable(L);
+	lua_pushcclosure(L, clone_env_index, 2);
+	lua_setfield(L, -2, "__index");
+	lua_setmetatable(L, -2);
+
+	lua_pushinteger(L, luaL_ref(L, LUA_REGISTRYINDEX));
+
+	return 1;
+}
+
+static void init_env_entry(struct env_entry *entry, int32_t next)
+{
+	entry->handle = NIL;
+	entry->owner = NULL;
+	entry->lua_state = NULL;
+	entry->heap = NULL;
+	entry->lua_env_ref = LUA_REFNIL;
+	entry->lua_binder_ref = LUA_REFNIL;
+	entry->lua_thread_ref = LUA_REFNIL;
+	entry->chunk = NULL;
+	entry->is_frozen = false;
+	lua_script_init(&entry->script);
+	entry->is_bytecode = false;
+	lua_output_init(&entry->output);
+	entry->profiler = NULL;
+	entry->slice_budget = 0;
+	entry->hook_period = 0;
+	memset(&entry->metrics, 0, sizeof(entry->metrics));
+	entry->next = next;
+}
+
+static void release_env(struct env_entry *entry)
+{
+	/* Return the environment's resources to its owner's quota */
+	if (entry->owner != NULL) {
+		if (entry->lua_thread_ref != LUA_REFNIL)
+			entry->owner->suspended_count--;
+
+		entry->owner->script_bytes -= entry->script.len;
+		entry->owner->env_count--;
+	}
+
+	if (entry->heap != NULL) {
+		/* Closing the state runs pending finalizers, then the whole arena is released */
+		lua_close(entry->lua_state);
+		lua_env_heap_destroy(entry->heap);
+	} else {
+		/* Unref environment so GC can cleen it up */
+		luaL_unref(entry->lua_state, LUA_REGISTRYINDEX, entry->lua_env_ref);
+		luaL_unref(entry->lua_state, LUA_REGISTRYINDEX, entry->lua_binder_ref);
+		luaL_unref(entry->lua_state, LUA_REGISTRYINDEX, entry->lua_thread_ref);
+	}
+
+	/* Free script chunks, captured output and the profile */
+	lua_script_clear(&entry->script);
+	lua_output_deinit(&entry->output);
+	free(entry->profiler);
+
+	init_env_entry(entry, NIL);
+}
+
+/* Drop the appended script of an environment */
+static void clear_env_script(struct env_entry *entry)
+{
+	entry->owner->script_bytes -= entry->script.len;
+	lua_script_clear(&entry->script);
+	entry->is_bytecode = false;
+}
+
+/* Find the record of a caller, a caller without environments gets a free one */
+static struct lua_caller *get_caller(struct lua_provider *context, uint16_t source_id)
+{
+	struct lua_caller *free_caller = NULL;
+
+	for (size_t i = 0; i < LUA_MAX_CALLERS; ++i) {
+		struct lua_caller *caller = &context->callers[i];
+
+		if (caller->env_count == 0) {
+			if (free_caller == NULL)
+				free_caller = caller;
+		} else if (caller->source_id == source_id) {
+			return caller;
+		}
+	}
+
+	if (free_caller != NULL)
+		free_caller->source_id = source_id;
+	else
+		DMSG("Limit of %d callers reached.", LUA_MAX_CALLERS);
+
+	return free_caller;
+}
+
+/* Memory charged to a caller, see LUA_CALLER_MAX_MEMORY */
+static size_t caller_memory(const struct lua_provider *context, size_t env_count,
+			    size_t script_bytes)
+{
+	return env_count * (context->env_heap_size + LUA_OUTPUT_BUFFER_SIZE) + script_bytes;
+}
+
+static bool env_quota_available(const struct lua_provider *context,
+				const struct lua_caller *caller)
+{
+	if (caller->env_count >= LUA_CALLER_MAX_ENV_COUNT)
+		return false;
+
+	return LUA_CALLER_MAX_MEMORY == 0 ||
+	       caller_memory(context, caller->env_count + 1, caller->script_bytes) <=
+		       LUA_CALLER_MAX_MEMORY;
+}
+
+static bool script_quota_available(const struct lua_provider *context,
+				   const struct lua_caller *caller, size_t script_len)
+{
+	if (LUA_CALLER_MAX_SCRIPT_BYTES != 0 &&
+	    script_len > LUA_CALLER_MAX_SCRIPT_BYTES - caller->script_bytes)
+		return false;
+
+	return LUA_CALLER_MAX_MEMORY == 0 ||
+	       caller_memory(context, caller->env_count, caller->script_bytes + script_len) <=
+		       LUA_CALLER_MAX_MEMORY;
+}
+
+static int32_t generate_handle(struct lua_provider *context, const struct env_entry *entry)
+{
+	/* Handle includes rolling count value to protect against use of a stale handle */
+	int32_t new_handle = (int32_t)(entry - context->env_entries);
+
+	new_handle = (new_handle & 0xffff) | ((int32_t)(context->rolling_count & 0x7fff) << 16);
+	++context->rolling_count;
+	return new_handle;
+}
+
+static size_t index_from_handle(int32_t handle)
+{
+	return (size_t)handle & 0xffff;
+}
+
+/*
+ * Look up a live environment of the caller, NULL if the handle is invalid or stale. Other
+ * callers' environments are reported as missing as well.
+ */
+static struct env_entry *get_env_entry(struct lua_provider *context,
+				       const struct rpc_request *req, int32_t handle)
+{
+	size_t index = index_from_handle(handle);
+
+	if (handle < 0 || index >= context->env_capacity)
+		return NULL;
+
+	struct env_entry *entry = &context->env_entries[index];
+
+	if (entry->lua_env_ref == LUA_REFNIL || entry->handle != handle ||
+	    entry->owner->source_id != req->source_id)
+		return NULL;
+
+	return entry;
+}
+
+/* Link entries first..last - 1 into the free list */
+static void add_free_env_entries(struct lua_provider *context, size_t first, size_t last)
+{
+	for (size_t i = last; i > first; --i) {
+		init_env_entry(&context->env_entries[i - 1], context->free_env_entry_ind);
+		context->free_env_entry_ind = (int32_t)(i - 1);
+	}
+}
+
+/*
+ * Make sure that a free entry is available. A full table doubles in size up to
+ * LUA_MAX_ENV_COUNT entries, which moves the entries, so pointers to them must not be held
+ * across this call.
+ */
+static bool reserve_env_entry(struct lua_provider *context)
+{
+	size_t capacity = context->env_capacity * 2;
+	struct env_entry *entries = NULL;
+
+	if (context->free_env_entry_ind != NIL)
+		return true;
+
+	if (capacity > LUA_MAX_ENV_COUNT)
+		capacity = LUA_MAX_ENV_COUNT;
+
+	if (capacity <= context->env_capacity) {
+		DMSG("Limit of %d environments reached.", LUA_MAX_ENV_COUNT);
+		return false;
+	}
+
+	entries = realloc(context->env_entries, capacity * sizeof(*entries));
+	if (entries == NULL)
+		return false;
+
+	context->env_entries = entries;
+	add_free_env_entries(context, context->env_capacity, capacity);
+	context->env_capacity = capacity;
+
+	return true;
+}
+
+/* Take the entry found by reserve_env_entry for the caller and give it a new handle */
+static struct env_entry *take_env_entry(struct lua_provider *context, struct lua_caller *owner)
+{
+	struct env_entry *entry = &context->env_entries[context->free_env_entry_ind];
+
+	context->free_env_entry_ind = entry->next;
+
+	init_env_entry(entry, NIL);
+	entry->handle = generate_handle(context, entry);
+	entry->owner = owner;
+	owner->env_count++;
+
+	return entry;
+}
+
+static void free_env_entry(struct lua_provider *context, struct env_entry *entry)
+{
+	entry->next = context->free_env_entry_ind;
+	context->free_env_entry_ind = (int32_t)(entry - context->env_entries);
+}
+
+struct rpc_service_interface *lua_provider_init(struct lua_provider *context)
+{
+	const struct rpc_uuid service_uuid = { .uuid = TS_LUA_SERVICE_UUID };
+
+	if (context == NULL)
+		return NULL;
+
+	lua_provider_deinit(context);
+
+	memset(context->callers, 0, sizeof(context->callers));
+
+	/* Invalidates request views held by a previous Lua state */
+	lua_buffer_window_close(&context->request_window);
+
+	/* Initialize Lua */
+	context->lua_state = luaL_newstate();
+	if (context->lua_state == NULL)
+		return NULL;
+
+	/* Environments without a private heap share the allocation counters of the state */
+	lua_alloc_meter_attach(&context->alloc_meter, context->lua_state);
+
+	lua_pushcfunction(context->lua_state, open_lua_state);
+	lua_pushlightuserdata(context->lua_state, context);
+	if (lua_pcall(context->lua_state, 1, 0, 0) != LUA_OK) {
+		lua_close(context->lua_state);
+		context->lua_state = NULL;
+
+		return NULL;
+	}
+
+	context->gc_params.generational = LUA_GC_GENERATIONAL;
+	context->gc_params.pause = LUA_GC_PAUSE;
+	context->gc_params.stepmul = LUA_GC_STEPMUL;
+	context->gc_params.step_kb = LUA_GC_STEP_KB;
+	context->gc_env_ind = 0;
+
+	context->exec_budget = LUA_EXEC_INSTRUCTION_BUDGET;
+	context->env_heap_size = LUA_ENV_HEAP_SIZE;
+
+	apply_gc_params(context->lua_state, &context->gc_params);
+
+	/* Initialize compiled chunk cache */
+	lua_chunk_cache_init(&context->chunk_cache, context->lua_state,
+			     LUA_CHUNK_CACHE_BYTE_BUDGET);
+
+	/* Initialize environment table, it grows on demand */
+	context->env_entries = calloc(LUA_ENV_TABLE_INITIAL_SIZE, sizeof(struct env_entry));
+	if (context->env_entries == NULL) {
+		lua_chunk_cache_deinit(&context->chunk_cache);
+		lua_close(context->lua_state);
+		context->lua_state = NULL;
+
+		return NULL;
+	}
+
+	context->env_capacity = LUA_ENV_TABLE_INITIAL_SIZE;
+	context->free_env_entry_ind = NIL;
+	add_free_env_entries(context, 0, context->env_capacity);
+
+	context->active_output = NULL;
+	
+	service_provider_init(&context->base_provider, context, &service_uuid, handler_table,
+				  ARRAY_SIZE(handler_table));
+
+	return service_provider_get_rpc_interface(&context->base_provider);
+}
+
+void lua_provider_deinit(struct lua_provider *context)
+{
+	if (context->lua_state == NULL)
+		return;
+
+	for (size_t i = 0; i < context->env_capacity; ++i) {
+		if (context->env_entries[i].lua_env_ref != LUA_REFNIL)
+			release_env(&context->env_entries[i]);
+	}
+
+	lua_chunk_cache_deinit(&context->chunk_cache);
+	lua_close(context->lua_state);
+	context->lua_state = NULL;
+
+	service_provider_deinit(&context->base_provider);
+
+	free(context->env_entries);
+	context->env_entries = NULL;
+	context->env_capacity = 0;
+}
+
+void lua_provider_register_serializer(
+	struct lua_provider *context,
+	const struct lua_serializer *serializer)
+{
+	context->serializer = serializer;
+}
+
+bool lua_provider_register_binding(
+	struct lua_provider *context,
+	const char *name,
+	lua_CFunction open,
+	void *binding_context)
+{
+	if (context->num_bindings >= LUA_PROVIDER_MAX_BINDINGS)
+		return false;
+
+	struct lua_binding *binding = &context->bindings[context->num_bindings];
+
+	binding->name = name;
+	binding->open = open;
+	binding->context = binding_context;
+
+	/* Environments with their own Lua state open the binding when they are created */
+	if (context->lua_state != NULL) {
+		lua_pushcfunction(context->lua_state, open_binding);
+		lua_pushlightuserdata(context->lua_state, binding);
+		if (lua_pcall(context->lua_state, 1, 0, 0) != LUA_OK) {
+			EMSG("Failed to open Lua binding %s: %s", name,
+			     lua_tostring(context->lua_state, -1));
+			lua_pop(context->lua_state, 1);
+
+			return false;
+		}
+	}
+
+	context->num_bindings++;
+
+	return true;
+}
+
+bool lua_provider_register_module(
+	struct lua_provider *context,
+	const struct lua_module *module)
+{
+	if (context->num_modules >= LUA_PROVIDER_MAX_MODULES)
+		return false;
+
+	/* Compiled once in the shared state, environments with their own state compile it later */
+	if (context->lua_state != NULL) {
+		lua_pushcfunction(context->lua_state, lua_modules_add);
+		lua_pushlightuserdata(context->lua_state, (void *)module);
+		if (lua_pcall(context->lua_state, 1, 0, 0) != LUA_OK) {
+			EMSG("Failed to compile Lua module %s: %s", module->name,
+			     lua_tostring(context->lua_state, -1));
+			lua_pop(context->lua_state, 1);
+
+			return false;
+		}
+	}
+
+	context->modules[context->num_modules++] = module;
+
+	return true;
+}
+
+void lua_provider_set_gc_params(
+	struct lua_provider *context,
+	const struct lua_gc_params *gc_params)
+{
+	context->gc_params = *gc_params;
+
+	if (context->lua_state == NULL)
+		return;
+
+	apply_gc_params(context->lua_state, gc_params);
+
+	for (size_t i = 0; i < context->env_capacity; ++i) {
+		if (context->env_entries[i].heap != NULL)
+			apply_gc_params(context->env_entries[i].lua_state, gc_params);
+	}
+}
+
+void lua_provider_set_exec_budget(
+	struct lua_provider *context,
+	int exec_budget)
+{
+	/* Scripts suspended at the moment get the new budget from their next slice on */
+	context->exec_budget = exec_budget;
+}
+
+void lua_provider_set_env_heap_size(
+	struct lua_provider *context,
+	size_t env_heap_size)
+{
+	context->env_heap_size = env_heap_size;
+}
+
+void lua_provider_collect_garbage(struct lua_provider *context)
+{
+	if (context->lua_state == NULL || context->gc_params.step_kb <= 0)
+		return;
+
+	lua_gc(context->lua_state, LUA_GCSTEP, context->gc_params.step_kb);
+
+	/* Step at most one private state per call to bound the time taken */
+	for (size_t n = 0; n < context->env_capacity; ++n) {
+		struct env_entry *entry = &context->env_entries[context->gc_env_ind];
+
+		context->gc_env_ind = (context->gc_env_ind + 1) % context->env_capacity;
+
+		if (entry->heap != NULL) {
+			lua_gc(entry->lua_state, LUA_GCSTEP, context->gc_params.step_kb);
+			break;
+		}
+	}
+}
+
+void lua_provider_get_cache_stats(
+	const struct lua_provider *context,
+	struct lua_chunk_cache_stats *stats)
+{
+	lua_chunk_cache_get_stats(&context->chunk_cache, stats);
+}
+
+static const struct lua_serializer* get_lua_serializer(
+	struct lua_provider *context,
+	const struct rpc_request *req)
+{
+	(void) req;
+
+	return context->serializer;
+}
+
+/* Check whether a suspended script runs the cached chunk function */
+static bool is_chunk_running(const struct lua_provider *context, const void *chunk)
+{
+	for (size_t i = 0; i < context->env_capacity; ++i) {
+		const struct env_entry *entry = &context->env_entries[i];
+
+		if (entry->lua_thread_ref != LUA_REFNIL && entry->chunk == chunk)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Set the environment of the chunk function on top of the stack. A function
+ * that is held in the chunk cache is shared between executions, so its _ENV
+ * upvalue is joined with the environment's binder closure instead of being
+ * overwritten. This way closures created by earlier executions keep referring
+ * to their own environment.
+ */
+static bool bind_env(lua_State *L, struct env_entry *entry, bool shared)
+{
+	if (!shared) {
+		lua_rawgeti(L, LUA_REGISTRYINDEX, entry->lua_env_ref);
+		lua_setupvalue(L, -2, 1);
+
+		return true;
+	}
+
+	if (entry->lua_binder_ref == LUA_REFNIL) {
+		/* An empty chunk has a single upvalue: _ENV */
+		if (luaL_loadbuffer(L, "", 0, "=binder") != LUA_OK) {
+			lua_pop(L, 1);
+
+			return false;
+		}
+
+		lua_rawgeti(L, LUA_REGISTRYINDEX, entry->lua_env_ref);
+		lua_setupvalue(L, -2, 1);
+		entry->lua_binder_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+
+	lua_rawgeti(L, LUA_REGISTRYINDEX, entry->lua_binder_ref);
+	lua_upvaluejoin(L, -2, 1, -1, 1);
+	lua_pop(L, 1);
+
+	return true;
+}
+
+/*
+ * Create an environment owned by the caller of the request. On success the new entry is
+ * returned through new_entry, otherwise the status to report to the caller.
+ */
+static lua_status_t create_env(struct lua_provider *this_instance, const struct rpc_request *req,
+			       struct env_entry **new_entry)
+{
+	struct lua_caller *caller = get_caller(this_instance, req->source_id);
+	if (caller == NULL)
+		return LUA_ERROR_OUT_OF_FREE_ENVIRONMENTS;
+
+	if (!env_quota_available(this_instance, caller))
+		return LUA_ERROR_QUOTA_EXCEEDED;
+
+	/* Make sure there is a free slot in the environment table */
+	if (!reserve_env_entry(this_instance))
+		return LUA_ERROR_OUT_OF_FREE_ENVIRONMENTS;
+
+	struct lua_env_heap *heap = NULL;
+	lua_State *L = this_instance->lua_state;
+
+	/* With per-environment heaps the environment lives in its own Lua state */
+	if (this_instance->env_heap_size > 0) {
+		L = new_env_state(this_instance, &heap);
+		if (L == NULL)
+			return LUA_ERROR_OUT_OF_MEMORY;
+	}
+
+	lua_pushcfunction(L, new_env_table);
+	if (lua_pcall(L, 0, 1, 0) != LUA_OK) {
+		if (heap != NULL) {
+			lua_close(L);
+			lua_env_heap_destroy(heap);
+		} else {
+			lua_pop(L, 1);
+		}
+
+		return LUA_ERROR_OUT_OF_MEMORY;
+	}
+
+	int env_ref = (int)lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	/* Initialize environment entry */
+	struct env_entry *entry = take_env_entry(this_instance, caller);
+	entry->lua_state = L;
+	entry->heap = heap;
+	entry->lua_env_ref = env_ref;
+
+	*new_entry = entry;
+
+	return LUA_SUCCESS;
+}
+
+static rpc_status_t env_create_handler(void *context, struct rpc_request *req)
+{
+	struct lua_provider *this_instance = (struct lua_provider *)context;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+	struct env_entry *entry = NULL;
+
+	req->service_status = create_env(this_instance, req, &entry);
+	if (req->service_status != LUA_SUCCESS)
+		return RPC_SUCCESS;
+
+	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
+	if (serializer)
+		rpc_status = serializer->serialize_env_create_resp(&req->response, entry->handle);
+
+	return rpc_status;
+}
+
+static rpc_status_t env_clone_handler(void *context, struct rpc_request *req)
+{
+	struct lua_provider *this_instance = (struct lua_provider *)context;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+
+	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
+
+	int32_t template_index = -1;
+
+	if (serializer)
+		rpc_status = serializer->deserialize_env_clone_req(&req->request, &template_index);
+
+	if (rpc_status != RPC_SUCCESS) {
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
+
+		return RPC_SUCCESS;
+	}
+
+	struct lua_caller *caller = get_caller(this_instance, req->source_id);
+	if (caller == NULL) {
+		req->service_status = LUA_ERROR_OUT_OF_FREE_ENVIRONMENTS;
+
+		return RPC_SUCCESS;
+	}
+
+	if (!env_quota_available(this_instance, caller)) {
+		req->service_status = LUA_ERROR_QUOTA_EXCEEDED;
+
+		return RPC_SUCCESS;
+	}
+
+	/* Reserve first, growing the table moves the template's entry */
+	if (!reserve_env_entry(this_instance)) {
+		req->service_status = LUA_ERROR_OUT_OF_FREE_ENVIRONMENTS;
+
+		return RPC_SUCCESS;
+	}
+
+	struct env_entry *template_entry = get_env_entry(this_instance, req, template_index);
+	if (template_entry == NULL) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST;
+
+		return RPC_SUCCESS;
+	}
+	lua_State *L = template_entry->lua_state;
+
+	/* Clones share the template's Lua state, which a private heap doesn't allow */
+	if (template_entry->heap != NULL) {
+		DMSG("Environments with a private heap can't be cloned");
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
+
+		return RPC_SUCCESS;
+	}
+
+	if (template_entry->lua_thread_ref != LUA_REFNIL) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_BUSY;
+
+		return RPC_SUCCESS;
+	}
+
+	/* The first clone freezes the template */
+	if (!template_entry->is_frozen) {
+		lua_pushcfunction(L, freeze_env_table);
+		lua_rawgeti(L, LUA_REGISTRYINDEX, template_entry->lua_env_ref);
+		if (lua_pcall(L, 1, 0, 0) != LUA_OK) {
+			lua_pop(L, 1);
+			req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+
+			return RPC_SUCCESS;
+		}
+
+		template_entry->is_frozen = true;
+
+		/* Any script left in the buffer can't be executed any more */
+		clear_env_script(template_entry);
+	}
+
+	/* Tables of the template are only copied when the clone uses them */
+	lua_pushcfunction(L, new_clone_table);
+	lua_rawgeti(L, LUA_REGISTRYINDEX, template_entry->lua_env_ref);
+	if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
+		lua_pop(L, 1);
+		req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+
+		return RPC_SUCCESS;
+	}
+
+	int env_ref = (int)lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	/* Initialize environment entry */
+	struct env_entry *entry = take_env_entry(this_instance, caller);
+	entry->lua_state = L;
+	entry->lua_env_ref = env_ref;
+
+	req->service_status = LUA_SUCCESS;
+
+	return serializer->serialize_env_create_resp(&req->response, entry->handle);
+}
+
+/*
+ * Check the header of a binary chunk produced by lua_dump. Lua repeats these checks when
+ * loading the chunk, but rejecting incompatible bytecode on the first append saves the
+ * transfer of the remaining chunks. All bytecode is rejected unless LUA_BYTECODE_ENABLED.
+ */
+static bool is_valid_bytecode_header(const uint8_t *bytecode, size_t bytecode_len)
+{
+	static const char luac_data[] = "\x19\x93\r\n\x1a\n";
+	const size_t signature_len = sizeof(LUA_SIGNATURE) - 1;
+	const size_t data_len = sizeof(luac_data) - 1;
+	size_t offset = 0;
+
+	if (!LUA_BYTECODE_ENABLED)
+		return false;
+
+	/* Signature, version, format, LUAC_DATA and the size of Instruction, lua_Integer and
+	 * lua_Number */
+	if (bytecode_len < signature_len + 2 + data_len + 3)
+		return false;
+
+	if (memcmp(bytecode, LUA_SIGNATURE, signature_len))
+		return false;
+	offset += signature_len;
+
+	if (bytecode[offset++] != LUA_BYTECODE_VERSION)
+		return false;
+
+	if (bytecode[offset++] != LUA_BYTECODE_FORMAT)
+		return false;
+
+	if (memcmp(&bytecode[offset], luac_data, data_len))
+		return false;
+	offset += data_len;
+
+	return bytecode[offset] == sizeof(uint32_t) &&
+	       bytecode[offset + 1] == sizeof(lua_Integer) &&
+	       bytecode[offset + 2] == sizeof(lua_Number);
+}
+
+static void append_to_env(struct lua_provider *this_instance, struct rpc_request *req,
+			  int32_t env_index, const uint8_t *script, size_t script_len,
+			  bool is_bytecode)
+{
+	/* Stale handles of deleted environments are rejected */
+	struct env_entry *entry = get_env_entry(this_instance, req, env_index);
+	if (entry == NULL) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST;
+
+		return;
+	}
+
+	if (entry->is_frozen) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_FROZEN;
+
+		return;
+	}
+
+	/* Source and bytecode can't be mixed and bytecode must start with a valid header */
+	if (entry->script.len == 0) {
+		if (is_bytecode && !is_valid_bytecode_header(script, script_len)) {
+			req->service_status = LUA_ERROR_INVALID_BYTECODE;
+
+			return;
+		}
+	} else if (entry->is_bytecode != is_bytecode) {
+		req->service_status = LUA_ERROR_INVALID_BYTECODE;
+
+		return;
+	}
+
+	if (!script_quota_available(this_instance, entry->owner, script_len)) {
+		req->service_status = LUA_ERROR_QUOTA_EXCEEDED;
+
+		return;
+	}
+
+	/* Keep the new piece as a separate chunk, these are only joined by the Lua reader */
+	if (!lua_script_append(&entry->script, script, script_len)) {
+		req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+
+		return;
+	}
+
+	entry->owner->script_bytes += script_len;
+	entry->is_bytecode = is_bytecode;
+
+	req->service_status = LUA_SUCCESS;
+}
+
+static rpc_status_t env_append_handler(void *context, struct rpc_request *req)
+{
+	struct lua_provider *this_instance = (struct lua_provider *)context;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+
+	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
+
+	int32_t env_index = -1;
+	const uint8_t *script = NULL;
+	size_t script_len = 0;
+
+	if (serializer)
+		rpc_status = serializer->deserialize_env_append_req(&req->request, &env_index,
+			&script, &script_len);
+
+	if (rpc_status != RPC_SUCCESS) {
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
+
+		return RPC_SUCCESS;
+	}
+
+	append_to_env(this_instance, req, env_index, script, script_len, false);
+
+	return RPC_SUCCESS;
+}
+
+static rpc_status_t env_append_bytecode_handler(void *context, struct rpc_request *req)
+{
+	struct lua_provider *this_instance = (struct lua_provider *)context;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+
+	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
+
+	int32_t env_index = -1;
+	const uint8_t *bytecode = NULL;
+	size_t bytecode_len = 0;
+
+	if (serializer)
+		rpc_status = serializer->deserialize_env_append_bytecode_req(&req->request,
+			&env_index, &bytecode, &bytecode_len);
+
+	if (rpc_status != RPC_SUCCESS) {
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
+
+		return RPC_SUCCESS;
+	}
+
+	append_to_env(this_instance, req, env_index, bytecode, bytecode_len, true);
+
+	return RPC_SUCCESS;
+}
+
+/*
+ * Report the values a finished script returned, the count values on top of L's stack, as a
+ * CBOR array in the response. The response stays empty if the script returned nothing.
+ */
+static void serialize_results(lua_State *L, int count, struct rpc_request *req,
+			      const struct lua_serializer *serializer)
+{
+	struct rpc_buffer *resp_buf = &req->response;
+	const char *msg = NULL;
+	size_t encoded_len = 0;
+
+	if (count == 0) {
+		req->service_status = LUA_SUCCESS;
+		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+
+		return;
+	}
+
+	/* The results are useless if they don't fit in the response, so that's all to allocate */
+	uint8_t *encoded = (uint8_t *)malloc(resp_buf->size);
+	if (encoded == NULL) {
+		req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+
+		return;
+	}
+
+	req->service_status = lua_cbor_encode(L, -count, count, encoded, resp_buf->size,
+					      &encoded_len, &msg);
+	if (req->service_status == LUA_SUCCESS)
+		serializer->serialize_env_execute_resp(resp_buf, encoded, encoded_len);
+	else
+		serializer->serialize_env_execute_resp(resp_buf, (const uint8_t *)msg, strlen(msg));
+
+	free(encoded);
+}
+
+/* Check whether L is the thread that runs the environment's script */
+static bool is_script_thread(lua_State *L, const struct env_entry *entry)
+{
+	lua_rawgeti(L, LUA_REGISTRYINDEX, entry->lua_thread_ref);
+	bool is_own_thread = (lua_tothread(L, -1) == L);
+	lua_pop(L, 1);
+
+	return is_own_thread;
+}
+
+/*
+ * Count hook of running scripts. It counts the instructions, samples the call stack of
+ * profiled scripts and suspends the script once its instruction budget is used up. The
+ * hook is inherited by coroutines that the script creates.
+ */
+static void script_hook(lua_State *L, lua_Debug *ar)
+{
+	(void)ar;
+
+	lua_rawgetp(L, LUA_REGISTRYINDEX, &running_env_key);
+	struct env_entry *entry = (struct env_entry *)lua_touserdata(L, -1);
+	lua_pop(L, 1);
+
+	/* A coroutine of the script resumed from outside of a slice, e.g. by a finalizer */
+	if (entry == NULL)
+		return;
+
+	entry->metrics.instructions += (uint64_t)entry->hook_period;
+
+	if (entry->profiler != NULL)
+		lua_profiler_count(entry->profiler, L, entry->hook_period);
+
+	if (entry->slice_budget == 0)
+		return;
+
+	entry->slice_budget -= entry->hook_period;
+	if (entry->slice_budget <= 0) {
+		/* Stays non-zero until the script is suspended at a later hook */
+		entry->slice_budget = -1;
+
+		/*
+		 * Only the script's own thread is suspended. Yielding a coroutine that the
+		 * script created would return to the script's coroutine.resume instead, so
+		 * that coroutine is left to run until the script's thread gets control again.
+		 * Neither can be yielded across a C call, the script is suspended at a later
+		 * hook instead.
+		 */
+		if (is_script_thread(L, entry) && lua_isyieldable(L))
+			lua_yield(L, 0);
+	}
+}
+
+/*
+ * Move the chunk function passed as the only argument into a new coroutine and return a
+ * registry reference to the coroutine. Runs in protected mode.
+ */
+static int new_script_thread(lua_State *L)
+{
+	lua_State *co = lua_newthread(L);
 
-/* Handler mapping table for service */
-static const struct service_handler handler_table[] = {
-	{TS_LUA_OPCODE_ENV_CREATE,  env_create_handler},
-	{TS_LUA_OPCODE_ENV_APPEND,  env_append_handler},
-	{TS_LUA_OPCODE_ENV_EXECUTE, env_execute_handler},
-	{TS_LUA_OPCODE_ENV_DELETE,  env_delete_handler}
-};
+	lua_pushvalue(L, 1);
+	lua_xmove(L, co, 1);
 
-/* C-binding for Lua's print function following Lua's luaB_print implementation */
-static int lua_log(lua_State *L) {
-	/* Get number of arguments */
-    int n = lua_gettop(L);
-    for (int i = 1; i <= n; i++) {
-        size_t len;
-        const char *s = luaL_tolstring(L, i, &len);
-
-        if (i > 1)
-            ts_trace_printf("", 0, TRACE_LEVEL_NONE, "%s", "\t");
-        ts_trace_printf("", 0, TRACE_LEVEL_NONE, "%s", s);
-		
-        lua_pop(L, 1);
-    }
+	lua_pushinteger(L, luaL_ref(L, LUA_REGISTRYINDEX));
 
-	return 0;
+	return 1;
 }
 
-struct rpc_service_interface *lua_provider_init(struct lua_provider *context)
+/* Instruction budget of a slice of one of the caller's suspended scripts */
+static int slice_budget(int exec_budget, size_t suspended_count)
 {
-	const struct rpc_uuid service_uuid = { .uuid = TS_LUA_SERVICE_UUID };
+	size_t budget = (size_t)exec_budget / (suspended_count ? suspended_count : 1);
 
-	if (context == NULL)
-		return NULL;
+	return budget ? (int)budget : 1;
+}
 
-	if (context->lua_state != NULL)
-		lua_close(context->lua_state);
+/* Instructions between calls of the script hook, 0 if the hook isn't needed */
+static int hook_period(const struct env_entry *entry)
+{
+	int period = (entry->profiler != NULL) ? entry->profiler->interval :
+						 LUA_METRICS_INSTRUCTION_PERIOD;
 
-	/* Initialize Lua */
-	context->lua_state = luaL_newstate();
-	if (context->lua_state == NULL)
-		return NULL;
+	/* A shorter budget keeps the hook from overrunning it */
+	if (period > 0 && (entry->slice_budget == 0 || entry->slice_budget > period))
+		return period;
 
-	/* Load common libraries into global environment */
-    luaL_requiref(context->lua_state, "_G", luaopen_base, 1);
-    lua_pop(context->lua_state, 1);
-    luaL_requiref(context->lua_state, LUA_MATHLIBNAME, luaopen_math, 1);
-    lua_pop(context->lua_state, 1);
-    luaL_requiref(context->lua_state, LUA_STRLIBNAME, luaopen_string, 1);
-    lua_pop(context->lua_state, 1);
-    luaL_requiref(context->lua_state, LUA_TABLIBNAME, luaopen_table, 1);
-    lua_pop(context->lua_state, 1);
-    luaL_requiref(context->lua_state, LUA_COLIBNAME, luaopen_coroutine, 1);
-    lua_pop(context->lua_state, 1);
-    luaL_requiref(context->lua_state, LUA_UTF8LIBNAME, luaopen_utf8, 1);
-    lua_pop(context->lua_state, 1);
+	return entry->slice_budget;
+}
 
-	/* Setup global C bindings */
-	/* Make print point to lua_log that uses ts_trace_printf for logging */
-	lua_pushcfunction(context->lua_state, lua_log);
-	lua_setglobal(context->lua_state, "print");
+/* Counters of the environment's Lua state at the start of a measurement */
+struct metrics_snapshot {
+	uint64_t ticks;
+	uint64_t allocated;
+	uint64_t gc_cycles;
+};
 
-	/* TODO: Add binding for LIBSP & PSA API */
+static void begin_measurement(struct lua_provider *this_instance, struct env_entry *entry,
+			      struct metrics_snapshot *snapshot)
+{
+	if (entry->heap != NULL) {
+		snapshot->allocated = entry->heap->allocated;
+	} else {
+		snapshot->allocated = this_instance->alloc_meter.allocated;
+		this_instance->alloc_meter.peak = this_instance->alloc_meter.in_use;
+	}
 
-    /* Create a metatable in registry. This is where environments will look up a key
-     * in case they don't find a it in their own table.
-	 */
-    if (luaL_newmetatable(context->lua_state, "global_env_meta")) {
-        /* Set new metatable (global_env_meta) __index field to point to global table */
-        lua_pushglobaltable(context->lua_state);
-        lua_setfield(context->lua_state, -2, "__index");
-    }
-    lua_pop(context->lua_state, 1);
+	snapshot->gc_cycles = lua_metrics_gc_cycles(entry->lua_state);
+	snapshot->ticks = lua_metrics_ticks();
+}
 
-	/* Initialize environment pool */
-	struct env_entry *entry = context->env_entries;
-	for (int32_t i = 0; i < MAX_ENV_COUNT - 1; ++i, ++entry) {
-		entry->next = i + 1;
-		entry->lua_env_ref = LUA_REFNIL;
-		entry->script_buf = NULL;
-		entry->script_len = 0;
+/* Add the time and the resources used since begin_measurement to the metrics */
+static void end_measurement(struct lua_provider *this_instance, struct env_entry *entry,
+			    const struct metrics_snapshot *snapshot, uint64_t *ticks)
+{
+	struct lua_env_metrics *metrics = &entry->metrics;
+	uint64_t peak = 0;
+
+	*ticks += lua_metrics_ticks() - snapshot->ticks;
+
+	if (entry->heap != NULL) {
+		metrics->bytes_allocated += entry->heap->allocated - snapshot->allocated;
+		peak = entry->heap->peak;
+	} else {
+		metrics->bytes_allocated += this_instance->alloc_meter.allocated -
+					    snapshot->allocated;
+		peak = this_instance->alloc_meter.peak;
 	}
 
-	entry->next = NIL;
-	entry->lua_env_ref = LUA_REFNIL;
-	entry->script_buf = NULL;
-	entry->script_len = 0;
-
-	context->free_env_entry_ind = 0;
-	
-	service_provider_init(&context->base_provider, context, &service_uuid, handler_table,
-				  ARRAY_SIZE(handler_table));
+	if (peak > metrics->peak_memory)
+		metrics->peak_memory = peak;
 
-	return service_provider_get_rpc_interface(&context->base_provider);
+	metrics->gc_cycles += lua_metrics_gc_cycles(entry->lua_state) - snapshot->gc_cycles;
 }
 
-void lua_provider_register_serializer(
-	struct lua_provider *context,
-	const struct lua_serializer *serializer)
+/*
+ * Instruction budget of the next env_execute or env_resume slice of the environment's script,
+ * 0 for no limit. A caller's scripts share one budget per slice, so a caller that runs many
+ * scripts at once doesn't get more of the SP than a caller that runs one script.
+ */
+static int exec_budget(const struct lua_provider *this_instance, const struct env_entry *entry)
 {
-	context->serializer = serializer;
+	if (this_instance->exec_budget <= 0)
+		return 0;
+
+	return slice_budget(this_instance->exec_budget, entry->owner->suspended_count);
 }
 
-static const struct lua_serializer* get_lua_serializer(
-	struct lua_provider *context,
-	const struct rpc_request *req)
+/*
+ * Run the environment's script coroutine for one slice of at most budget instructions, 0 for
+ * no limit, and report the outcome in the response. The request's input is visible to the
+ * script for this slice only. The coroutine is released once the script has finished.
+ */
+static void resume_script(struct lua_provider *this_instance, lua_State *L,
+			  struct env_entry *entry, int budget, const uint8_t *input,
+			  size_t input_len, struct rpc_request *req,
+			  const struct lua_serializer *serializer)
 {
-	(void) req;
+	struct rpc_buffer *resp_buf = &req->response;
+	struct metrics_snapshot snapshot;
+	int nresults = 0;
 
-	return context->serializer;
+	/* The coroutine stays anchored by its registry reference */
+	lua_rawgeti(L, LUA_REGISTRYINDEX, entry->lua_thread_ref);
+	lua_State *co = lua_tothread(L, -1);
+	lua_pop(L, 1);
+
+	entry->slice_budget = budget;
+	entry->hook_period = hook_period(entry);
+
+	/* The hook finds the environment through the registry */
+	lua_pushlightuserdata(L, entry);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &running_env_key);
+
+	if (entry->hook_period > 0)
+		lua_sethook(co, script_hook, LUA_MASKCOUNT, entry->hook_period);
+	else
+		lua_sethook(co, NULL, 0, 0);
+
+	entry->metrics.slice_count++;
+	begin_measurement(this_instance, entry, &snapshot);
+
+	/* Capture what the script prints */
+	this_instance->active_output = &entry->output;
+	lua_buffer_window_open(&this_instance->request_window, input, input_len);
+	int status = lua_resume(co, L, 0, &nresults);
+	lua_buffer_window_close(&this_instance->request_window);
+	this_instance->active_output = NULL;
+
+	end_measurement(this_instance, entry, &snapshot, &entry->metrics.exec_ticks);
+
+	lua_pushboolean(L, 0);
+	lua_rawsetp(L, LUA_REGISTRYINDEX, &running_env_key);
+
+	if (status == LUA_YIELD) {
+		/* Drop any values the script passed to coroutine.yield */
+		lua_pop(co, nresults);
+
+		req->service_status = LUA_IN_PROGRESS;
+		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+
+		return;
+	}
+
+	if (status == LUA_OK) {
+		serialize_results(co, nresults, req, serializer);
+	} else {
+		const char *msg = lua_tostring(co, -1);
+		size_t msg_len = msg ? strlen(msg) : 0;
+
+		/* Exceeding the environment's heap is reported as running out of memory */
+		req->service_status = (status == LUA_ERRMEM) ? LUA_ERROR_OUT_OF_MEMORY :
+							       LUA_ERROR_INTERPRETER_ERROR;
+		serializer->serialize_env_execute_resp(resp_buf, (const uint8_t *)msg, msg_len);
+	}
+
+	/* The script has finished, let the GC reclaim the coroutine */
+	luaL_unref(L, LUA_REGISTRYINDEX, entry->lua_thread_ref);
+	entry->lua_thread_ref = LUA_REFNIL;
+	entry->chunk = NULL;
+	entry->owner->suspended_count--;
 }
 
-static rpc_status_t env_create_handler(void *context, struct rpc_request *req)
+static rpc_status_t env_execute_handler(void *context, struct rpc_request *req)
 {
 	struct lua_provider *this_instance = (struct lua_provider *)context;
 	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+	struct rpc_buffer *resp_buf = &req->response;
 
-	/* Get next free slot in environment buffer */
-	int32_t free_idx = this_instance->free_env_entry_ind;
-	if (free_idx == NIL) {
-		DMSG("Limit of %" PRIu8 " environments reached.", MAX_ENV_COUNT);
-		req->service_status = LUA_ERROR_OUT_OF_FREE_ENVIRONMENTS;
+	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
+
+	int32_t env_index = -1;
+	const uint8_t *input = NULL;
+	size_t input_len = 0;
+
+	if (serializer)
+		rpc_status = serializer->deserialize_env_execute_req(&req->request, &env_index,
+			&input, &input_len);
+
+	if (rpc_status != RPC_SUCCESS) {
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
 
 		return RPC_SUCCESS;
 	}
-	struct env_entry *entry = &this_instance->env_entries[free_idx];
 
-	/* Update next free index */
-	this_instance->free_env_entry_ind = entry->next;
+	/* Stale handles of deleted environments are rejected */
+	struct env_entry *entry = get_env_entry(this_instance, req, env_index);
+	if (entry == NULL) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST;
 
-	/* Create new table for environment */
-	lua_newtable(this_instance->lua_state);
+		return RPC_SUCCESS;
+	}
+	lua_State *L = entry->lua_state;
 
-	/* Set new table's metatable to global_env_meta that points to the global environment */
-	luaL_setmetatable(this_instance->lua_state, "global_env_meta");
+	/* A suspended script must run to completion or be deleted first */
+	if (entry->lua_thread_ref != LUA_REFNIL) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_BUSY;
 
-	/* Create and return reference to newly created table */
-	int env_ref = luaL_ref(this_instance->lua_state, LUA_REGISTRYINDEX);
+		return RPC_SUCCESS;
+	}
 
-	/* Initialize environment entry */
-	entry->next = NIL;
-	entry->lua_env_ref = env_ref;
-	entry->script_buf = NULL;
-	entry->script_len = 0;
+	/* Templates are read-only once cloned */
+	if (entry->is_frozen) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_FROZEN;
 
-	req->service_status = LUA_SUCCESS;
+		return RPC_SUCCESS;
+	}
+
+	/* Empty script buffer: success */
+	if (entry->script.len == 0) {
+		req->service_status = LUA_SUCCESS;
+		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+
+		return RPC_SUCCESS;
+	}
+
+	/*
+	 * Identical scripts compiled earlier are served from the chunk cache. The cache belongs
+	 * to the shared Lua state, environments with their own state always compile.
+	 */
+	bool use_cache = (entry->heap == NULL);
+	bool cached = use_cache &&
+		      lua_chunk_cache_lookup(&this_instance->chunk_cache, &entry->script);
+
+	/*
+	 * Every execution rebinds the environment of a cached function. While a suspended script
+	 * still runs the function that would switch the environment under its feet, so the
+	 * script is compiled again and the copy is not cached.
+	 */
+	if (cached && is_chunk_running(this_instance, lua_topointer(L, -1))) {
+		lua_pop(L, 1);
+		cached = false;
+		use_cache = false;
+	}
+
+	if (cached) {
+		clear_env_script(entry);
+	} else {
+		/* Pass script buffer to Lua for parsing and loading into VM stack */
+		char script_name[32] = { 0 };
+		snprintf(script_name, sizeof(script_name), "environment_%d", env_index);
+
+		/* Bytecode is only accepted through env_append_bytecode */
+		const char *mode = entry->is_bytecode ? "b" : "t";
+
+		struct metrics_snapshot snapshot;
+
+		begin_measurement(this_instance, entry, &snapshot);
+		int status = lua_script_load(L, &entry->script, script_name, mode);
+		end_measurement(this_instance, entry, &snapshot, &entry->metrics.parse_ticks);
+
+		if (status != LUA_OK) {
+			/* Recover error message from stack */
+			const char *msg = lua_tostring(L, -1);
+			size_t msg_len = msg ? strlen(msg) : 0;
+
+			req->service_status = (status == LUA_ERRMEM) ? LUA_ERROR_OUT_OF_MEMORY :
+								       LUA_ERROR_PARSER_ERROR;
+			serializer->serialize_env_execute_resp(resp_buf, (const uint8_t *)msg, msg_len);
+
+			lua_pop(L, 1);
+
+			return RPC_SUCCESS;
+		}
+
+		/*
+		 * Lua already successfully parsed the script and loaded it onto the stack. Hand
+		 * the script chunks over to the chunk cache or free them if they do not fit. They
+		 * no longer count against the owner's quota.
+		 */
+		entry->owner->script_bytes -= entry->script.len;
+		cached = use_cache &&
+			 lua_chunk_cache_insert(&this_instance->chunk_cache, &entry->script);
+		lua_script_clear(&entry->script);
+		entry->is_bytecode = false;
+	}
+
+	/* Setup script's environment */
+	if (!bind_env(L, entry, cached)) {
+		lua_pop(L, 1);
+
+		req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+
+		return RPC_SUCCESS;
+	}
+
+	const void *chunk = lua_topointer(L, -1);
+
+	/* Run the script as a coroutine so that it can be suspended */
+	lua_pushcfunction(L, new_script_thread);
+	lua_insert(L, -2);
+	if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
+		lua_pop(L, 1);
+
+		req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+
+		return RPC_SUCCESS;
+	}
+
+	entry->lua_thread_ref = (int)lua_tointeger(L, -1);
+	entry->chunk = cached ? chunk : NULL;
+	entry->owner->suspended_count++;
+	entry->metrics.execute_count++;
+	lua_pop(L, 1);
+
+	resume_script(this_instance, L, entry, exec_budget(this_instance, entry), input,
+		      input_len, req, serializer);
+
+	return RPC_SUCCESS;
+}
+
+static rpc_status_t env_resume_handler(void *context, struct rpc_request *req)
+{
+	struct lua_provider *this_instance = (struct lua_provider *)context;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
 
 	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
+
+	int32_t env_index = -1;
+	const uint8_t *input = NULL;
+	size_t input_len = 0;
+
 	if (serializer)
-		rpc_status = serializer->serialize_env_create_resp(&req->response, free_idx);
+		rpc_status = serializer->deserialize_env_resume_req(&req->request, &env_index,
+			&input, &input_len);
 
-	return rpc_status;
+	if (rpc_status != RPC_SUCCESS) {
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
+
+		return RPC_SUCCESS;
+	}
+
+	/* Stale handles of deleted environments are rejected */
+	struct env_entry *entry = get_env_entry(this_instance, req, env_index);
+	if (entry == NULL) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST;
+
+		return RPC_SUCCESS;
+	}
+
+	/* No suspended script: success */
+	if (entry->lua_thread_ref == LUA_REFNIL) {
+		req->service_status = LUA_SUCCESS;
+		serializer->serialize_env_execute_resp(&req->response, NULL, 0);
+
+		return RPC_SUCCESS;
+	}
+
+	resume_script(this_instance, entry->lua_state, entry, exec_budget(this_instance, entry),
+		      input, input_len, req, serializer);
+
+	return RPC_SUCCESS;
 }
 
-static rpc_status_t env_append_handler(void *context, struct rpc_request *req)
+static rpc_status_t env_read_output_handler(void *context, struct rpc_request *req)
 {
 	struct lua_provider *this_instance = (struct lua_provider *)context;
 	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
@@ -183,12 +1631,9 @@ static rpc_status_t env_append_handler(void *context, struct rpc_request *req)
 	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
 
 	int32_t env_index = -1;
-	const uint8_t *script = NULL;
-	size_t script_len = 0;
 
 	if (serializer)
-		rpc_status = serializer->deserialize_env_append_req(&req->request, &env_index,
-			&script, &script_len);
+		rpc_status = serializer->deserialize_env_read_output_req(&req->request, &env_index);
 
 	if (rpc_status != RPC_SUCCESS) {
 		req->service_status = LUA_ERROR_GENERIC_ERROR;
@@ -196,48 +1641,115 @@ static rpc_status_t env_append_handler(void *context, struct rpc_request *req)
 		return RPC_SUCCESS;
 	}
 
-	/* Validate environment index and check if it is initialized */
-	if (env_index < 0 || env_index >= MAX_ENV_COUNT ||
-		this_instance->env_entries[env_index].lua_env_ref == LUA_REFNIL) {
-
+	struct env_entry *entry = get_env_entry(this_instance, req, env_index);
+	if (entry == NULL) {
 		req->service_status = LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST;
 
 		return RPC_SUCCESS;
 	}
-	struct env_entry *entry = &this_instance->env_entries[env_index];
+	struct lua_output *output = &entry->output;
 
-	/* Reallocate script buffer so new chunk fits (maybe use different growth strategy?) */
-	size_t new_len = entry->script_len + script_len;
-	char *tmp = (char *)realloc(entry->script_buf, new_len + 1);
-	if (!tmp) {
-		req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+	const uint8_t *data = NULL;
+	size_t data_len = lua_output_peek(output, &data);
+	size_t written_len = 0;
+
+	rpc_status = serializer->serialize_env_read_output_resp(&req->response, data, data_len,
+								 (uint32_t)output->lost_len,
+								 &written_len);
+
+	if (rpc_status == RPC_SUCCESS) {
+		lua_output_consume(output, written_len);
+		output->lost_len = 0;
+		req->service_status = LUA_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
+static rpc_status_t env_profile_result_handler(void *context, struct rpc_request *req)
+{
+	struct lua_provider *this_instance = (struct lua_provider *)context;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+	struct rpc_buffer *resp_buf = &req->response;
+
+	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
+
+	int32_t env_index = -1;
+	uint32_t sample_interval = 0;
+
+	if (serializer)
+		rpc_status = serializer->deserialize_env_profile_result_req(&req->request,
+			&env_index, &sample_interval);
+
+	if (rpc_status != RPC_SUCCESS || sample_interval > INT_MAX) {
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
+
+		return RPC_SUCCESS;
+	}
+
+	struct env_entry *entry = get_env_entry(this_instance, req, env_index);
+	if (entry == NULL) {
+		req->service_status = LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST;
 
 		return RPC_SUCCESS;
 	}
 
-	/* Copy new chunk */
-	memcpy(tmp + entry->script_len, script, script_len);
+	uint8_t *encoded = NULL;
+	size_t encoded_len = 0;
+
+	if (entry->profiler != NULL) {
+		encoded = malloc(resp_buf->size);
+		if (encoded == NULL) {
+			req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+
+			return RPC_SUCCESS;
+		}
 
-	entry->script_buf = tmp;
-	entry->script_len = new_len;
+		lua_status_t status = lua_profiler_encode(entry->profiler, encoded,
+							  resp_buf->size, &encoded_len);
+		if (status != LUA_SUCCESS) {
+			free(encoded);
+			req->service_status = status;
+
+			return RPC_SUCCESS;
+		}
+	}
+
+	/* Apply the new interval, the next profile starts empty */
+	if (sample_interval == 0) {
+		free(entry->profiler);
+		entry->profiler = NULL;
+	} else if (entry->profiler != NULL) {
+		lua_profiler_init(entry->profiler, (int)sample_interval);
+	} else {
+		entry->profiler = malloc(sizeof(*entry->profiler));
+		if (entry->profiler == NULL) {
+			req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+
+			return RPC_SUCCESS;
+		}
+
+		lua_profiler_init(entry->profiler, (int)sample_interval);
+	}
 
 	req->service_status = LUA_SUCCESS;
+	rpc_status = serializer->serialize_env_execute_resp(resp_buf, encoded, encoded_len);
+	free(encoded);
 
-	return RPC_SUCCESS;
+	return rpc_status;
 }
 
-static rpc_status_t env_execute_handler(void *context, struct rpc_request *req)
+static rpc_status_t env_stats_handler(void *context, struct rpc_request *req)
 {
 	struct lua_provider *this_instance = (struct lua_provider *)context;
 	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
-	struct rpc_buffer *resp_buf = &req->response;
 
 	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
 
 	int32_t env_index = -1;
 
 	if (serializer)
-		rpc_status = serializer->deserialize_env_execute_req(&req->request, &env_index);
+		rpc_status = serializer->deserialize_env_stats_req(&req->request, &env_index);
 
 	if (rpc_status != RPC_SUCCESS) {
 		req->service_status = LUA_ERROR_GENERIC_ERROR;
@@ -245,66 +1757,130 @@ static rpc_status_t env_execute_handler(void *context, struct rpc_request *req)
 		return RPC_SUCCESS;
 	}
 
-	/* Validate environment index and check if it is initialized */
-	if (env_index < 0 || env_index >= MAX_ENV_COUNT ||
-		this_instance->env_entries[env_index].lua_env_ref == LUA_REFNIL) {
-
+	struct env_entry *entry = get_env_entry(this_instance, req, env_index);
+	if (entry == NULL) {
 		req->service_status = LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST;
 
 		return RPC_SUCCESS;
 	}
-	struct env_entry *entry = &this_instance->env_entries[env_index];
 
-	/* Empty script buffer: success */
-	if (!entry->script_buf || entry->script_len == 0) {
+	rpc_status = serializer->serialize_env_stats_resp(&req->response, &entry->metrics,
+							  lua_metrics_tick_frequency());
+
+	if (rpc_status == RPC_SUCCESS)
 		req->service_status = LUA_SUCCESS;
-		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+
+	return rpc_status;
+}
+
+/* Send the output captured from a script of a temporary environment to the trace log */
+static void trace_output(struct lua_output *output)
+{
+	const uint8_t *data = NULL;
+	size_t data_len = lua_output_peek(output, &data);
+
+	/* Already traced line by line */
+	if (LUA_OUTPUT_TRACE || data_len == 0)
+		return;
+
+	/* The trace adds a line break of its own */
+	if (data[data_len - 1] == '\n')
+		data_len--;
+
+	ts_trace_printf("", 0, TRACE_LEVEL_NONE, "%.*s", (int)data_len, (const char *)data);
+}
+
+static rpc_status_t env_run_handler(void *context, struct rpc_request *req)
+{
+	struct lua_provider *this_instance = (struct lua_provider *)context;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+	struct rpc_buffer *resp_buf = &req->response;
+	struct env_entry *entry = NULL;
+
+	const struct lua_serializer *serializer = get_lua_serializer(this_instance, req);
+
+	uint32_t flags = 0;
+	const uint8_t *script = NULL;
+	size_t script_len = 0;
+
+	/* Every path below reports its outcome through the serializer */
+	if (serializer == NULL) {
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
 
 		return RPC_SUCCESS;
 	}
 
-	/* Pass script buffer to Lua for parsing and loading into VM stack */
-	char script_name[32] = { 0 };
-	snprintf(script_name, sizeof(script_name), "environment_%d", env_index);
+	rpc_status = serializer->deserialize_env_run_req(&req->request, &flags, &script,
+							  &script_len);
+	if (rpc_status != RPC_SUCCESS) {
+		req->service_status = LUA_ERROR_GENERIC_ERROR;
 
-	if (luaL_loadbuffer(this_instance->lua_state, entry->script_buf, entry->script_len, script_name) != LUA_OK) {
-		/* Recover error message from stack */
-		const char *msg = lua_tostring(this_instance->lua_state, -1);
-		size_t msg_len = msg ? strlen(msg) : 0;
+		return RPC_SUCCESS;
+	}
 
-		req->service_status = LUA_ERROR_PARSER_ERROR;
-		serializer->serialize_env_execute_resp(resp_buf, (const uint8_t *)msg, msg_len);
+	bool is_bytecode = flags & TS_LUA_ENV_RUN_FLAG_BYTECODE;
+
+	if (is_bytecode && !is_valid_bytecode_header(script, script_len)) {
+		req->service_status = LUA_ERROR_INVALID_BYTECODE;
 
-		lua_pop(this_instance->lua_state, 1);
-		
 		return RPC_SUCCESS;
 	}
 
-	/* Free script buffer as Lua already successfully parsed it and loaded onto stack */
-	free(entry->script_buf);
-	entry->script_buf = NULL;
-	entry->script_len = 0;
+	/*
+	 * The script runs in a temporary environment of the caller, so it counts against the
+	 * caller's quota and is executed, measured and captured like any other script.
+	 */
+	req->service_status = create_env(this_instance, req, &entry);
+	if (req->service_status != LUA_SUCCESS)
+		return RPC_SUCCESS;
 
-	/* Setup script's environment */
-	lua_rawgeti(this_instance->lua_state, LUA_REGISTRYINDEX, entry->lua_env_ref);
-	lua_setupvalue(this_instance->lua_state, -2, 1);
+	lua_State *L = entry->lua_state;
 
-	/* Execute */
-	if (lua_pcall(this_instance->lua_state, 0, 0, 0) != LUA_OK) {
-		const char *msg = lua_tostring(this_instance->lua_state, -1);
+	/* The script is parsed straight from the request buffer */
+	int status = luaL_loadbufferx(L, (const char *)script, script_len, "run",
+				      is_bytecode ? "b" : "t");
+	if (status != LUA_OK) {
+		const char *msg = lua_tostring(L, -1);
 		size_t msg_len = msg ? strlen(msg) : 0;
 
-		req->service_status = LUA_ERROR_INTERPRETER_ERROR;
+		req->service_status = (status == LUA_ERRMEM) ? LUA_ERROR_OUT_OF_MEMORY :
+							       LUA_ERROR_PARSER_ERROR;
 		serializer->serialize_env_execute_resp(resp_buf, (const uint8_t *)msg, msg_len);
 
-		lua_pop(this_instance->lua_state, 1);
+		lua_pop(L, 1);
+		goto delete_env;
+	}
+
+	bind_env(L, entry, false);
 
-		return RPC_SUCCESS;
+	lua_pushcfunction(L, new_script_thread);
+	lua_insert(L, -2);
+	if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
+		lua_pop(L, 1);
+
+		req->service_status = LUA_ERROR_OUT_OF_MEMORY;
+		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+		goto delete_env;
 	}
 
-	/* Every step succeeded */
-	req->service_status = LUA_SUCCESS;
-	serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+	entry->lua_thread_ref = (int)lua_tointeger(L, -1);
+	entry->owner->suspended_count++;
+	lua_pop(L, 1);
+
+	/* Nothing can resume the temporary environment, so the script gets a single slice */
+	resume_script(this_instance, L, entry, LUA_RUN_INSTRUCTION_BUDGET, NULL, 0, req,
+		      serializer);
+
+	if (req->service_status == LUA_IN_PROGRESS) {
+		req->service_status = LUA_ERROR_BUDGET_EXCEEDED;
+		serializer->serialize_env_execute_resp(resp_buf, NULL, 0);
+	}
+
+	trace_output(&entry->output);
+
+delete_env:
+	release_env(entry);
+	free_env_entry(this_instance, entry);
 
 	return RPC_SUCCESS;
 }
@@ -327,28 +1903,16 @@ static rpc_status_t env_delete_handler(void *context, struct rpc_request *req)
 		return RPC_SUCCESS;
 	}
 
-	/* Validate environment index and check if it is initialized */
-	if (env_index < 0 || env_index >= MAX_ENV_COUNT ||
-		this_instance->env_entries[env_index].lua_env_ref == LUA_REFNIL) {
-
+	/* Stale handles of deleted environments are rejected */
+	struct env_entry *entry = get_env_entry(this_instance, req, env_index);
+	if (entry == NULL) {
 		req->service_status = LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST;
 
 		return RPC_SUCCESS;
 	}
-	struct env_entry *entry = &this_instance->env_entries[env_index];
-
-	/* Unref environment so GC can cleen it up */
-	luaL_unref(this_instance->lua_state, LUA_REGISTRYINDEX, entry->lua_env_ref);
-	entry->lua_env_ref = LUA_REFNIL;
-
-	/* Free script buffer */
-	free(entry->script_buf);
-	entry->script_buf = NULL;
-	entry->script_len = 0;
 
-	/* Update free indices */
-	entry->next = this_instance->free_env_entry_ind;
-	this_instance->free_env_entry_ind = env_index;
+	release_env(entry);
+	free_env_entry(this_instance, entry);
 
 	req->service_status = LUA_SUCCESS;
 
@@ -6,45 +6,374 @@
 #ifndef LUA_PROVIDER_H
 #define LUA_PROVIDER_H
 
+#include <stdbool.h>
 #include <lua.h>
 
 #include "components/rpc/common/endpoint/rpc_service_interface.h"
 #include "components/service/common/provider/service_provider.h"
 #include "serializer/lua_serializer.h"
+#include "lua_buffer.h"
+#include "lua_chunk_cache.h"
+#include "lua_env_heap.h"
+#include "lua_metrics.h"
+#include "lua_modules.h"
+#include "lua_output.h"
+#include "lua_profiler.h"
+#include "lua_script.h"
 #include "protocols/rpc/common/packed-c/encoding.h"
 
-#define MAX_ENV_COUNT ((uint8_t)(16))
 #define NIL (-1)
 
+/**
+ * The number of environments that fit in the environment table after
+ * lua_provider_init.  A full table doubles in size when another environment
+ * is created, up to LUA_MAX_ENV_COUNT.
+ */
+#ifndef LUA_ENV_TABLE_INITIAL_SIZE
+#define LUA_ENV_TABLE_INITIAL_SIZE (16)
+#endif
+
+/**
+ * The maximum number of environments that can exist at the same time.  The
+ * environment handles returned to clients hold a 16 bit table index, so the
+ * limit can't exceed 65536.
+ */
+#ifndef LUA_MAX_ENV_COUNT
+#define LUA_MAX_ENV_COUNT (256)
+#endif
+
+#if LUA_MAX_ENV_COUNT > 0x10000
+#error "LUA_MAX_ENV_COUNT exceeds the environment handle format"
+#endif
+
+#if LUA_ENV_TABLE_INITIAL_SIZE < 1 || LUA_ENV_TABLE_INITIAL_SIZE > LUA_MAX_ENV_COUNT
+#error "LUA_ENV_TABLE_INITIAL_SIZE must be between 1 and LUA_MAX_ENV_COUNT"
+#endif
+
+/**
+ * The size of the private heap of each environment in bytes.  When non-zero,
+ * every environment gets its own Lua state that allocates from an arena of
+ * this size, which also bounds the memory the environment can use.  Zero
+ * places all environments in one shared Lua state.  The size can be changed
+ * at run time with lua_provider_set_env_heap_size.
+ */
+#ifndef LUA_ENV_HEAP_SIZE
+#define LUA_ENV_HEAP_SIZE (0)
+#endif
+
+/**
+ * Set to 1 to accept precompiled bytecode from env_append_bytecode and env_run.
+ * Lua does not verify bytecode, it only checks the header, so malformed
+ * bytecode can corrupt the memory of the SP.  Only enable this where all
+ * clients are trusted.  By default bytecode is rejected with
+ * LUA_ERROR_INVALID_BYTECODE.  Modules built into the SP may be bytecode
+ * either way.
+ */
+#ifndef LUA_BYTECODE_ENABLED
+#define LUA_BYTECODE_ENABLED (0)
+#endif
+
+/**
+ * The default number of Lua VM instructions a script may run per env_execute
+ * or env_resume request, see lua_provider_set_exec_budget.  When the budget is
+ * used up the script is suspended and the caller has to resume it, so other
+ * callers are served in between.  Only clients that handle LUA_IN_PROGRESS can
+ * use a provider with a budget, so the default of zero lets scripts run to
+ * completion.
+ */
+#ifndef LUA_EXEC_INSTRUCTION_BUDGET
+#define LUA_EXEC_INSTRUCTION_BUDGET (0)
+#endif
+
+/**
+ * The number of Lua VM instructions a script run by env_run may take.  The
+ * temporary environment of env_run can't be resumed, so a script that uses up
+ * the budget fails with LUA_ERROR_BUDGET_EXCEEDED.  Zero lets scripts run to
+ * completion, which allows a single request to occupy the SP indefinitely.
+ */
+#ifndef LUA_RUN_INSTRUCTION_BUDGET
+#define LUA_RUN_INSTRUCTION_BUDGET (1000000)
+#endif
+
+/**
+ * The number of Lua VM instructions between calls of the hook that counts the
+ * instructions of a script for its environment metrics.  A shorter period
+ * makes the count more precise at the cost of more hook calls.  Zero counts
+ * instructions only in steps of the instruction budget.  While a script is
+ * profiled the hook runs at the sampling interval instead, or at the
+ * instruction budget if that is shorter.
+ */
+#ifndef LUA_METRICS_INSTRUCTION_PERIOD
+#define LUA_METRICS_INSTRUCTION_PERIOD (1000)
+#endif
+
+/**
+ * Set to 1 to copy the output that scripts print to the trace log as well as
+ * capturing it in the environment's output buffer.  The output of scripts run
+ * by env_run is sent to the trace log in one piece when the script ends, as
+ * there is no environment left to read it from.
+ */
+#ifndef LUA_OUTPUT_TRACE
+#define LUA_OUTPUT_TRACE (0)
+#endif
+
+/**
+ * Set to 1 to run the garbage collector of the Lua states in generational mode
+ * instead of the default incremental mode.  Generational mode suits scripts
+ * that create many short lived objects.
+ */
+#ifndef LUA_GC_GENERATIONAL
+#define LUA_GC_GENERATIONAL (0)
+#endif
+
+/**
+ * The collector pause and step multiplier of incremental mode in percent, see
+ * the Lua manual.  Zero keeps the Lua defaults.
+ */
+#ifndef LUA_GC_PAUSE
+#define LUA_GC_PAUSE (0)
+#endif
+
+#ifndef LUA_GC_STEPMUL
+#define LUA_GC_STEPMUL (0)
+#endif
+
+/**
+ * The amount of garbage collection work, in KiB of allocation, that
+ * lua_provider_collect_garbage does outside of script execution.  Zero
+ * disables these steps and leaves collection to the allocations of scripts.
+ * The SP steps before sending each response, so the work adds to the
+ * latency of every call and is disabled by default.
+ */
+#ifndef LUA_GC_STEP_KB
+#define LUA_GC_STEP_KB (0)
+#endif
+
+/**
+ * The maximum number of callers, identified by their FF-A source ID, that can
+ * own environments at the same time.
+ */
+#ifndef LUA_MAX_CALLERS
+#define LUA_MAX_CALLERS (8)
+#endif
+
+/**
+ * Limits of a single caller, so that one caller can't starve the others.
+ * LUA_CALLER_MAX_ENV_COUNT bounds the number of environments a caller owns and
+ * LUA_CALLER_MAX_SCRIPT_BYTES the size of the scripts appended to them but not
+ * executed yet.  LUA_CALLER_MAX_MEMORY bounds the memory charged to a caller:
+ * the pending scripts, plus the private heap and output buffer of each of its
+ * environments.  Zero disables the script and memory limits.
+ *
+ * Callers are told apart by their FF-A source ID, and all normal world
+ * processes reach the SP through the same FF-A endpoint, so the whole normal
+ * world is a single caller.  The defaults therefore only apply the global
+ * limits; tighter limits are meant for deployments where several secure
+ * partitions share the Lua SP.
+ */
+#ifndef LUA_CALLER_MAX_ENV_COUNT
+#define LUA_CALLER_MAX_ENV_COUNT LUA_MAX_ENV_COUNT
+#endif
+
+#ifndef LUA_CALLER_MAX_SCRIPT_BYTES
+#define LUA_CALLER_MAX_SCRIPT_BYTES (0)
+#endif
+
+#ifndef LUA_CALLER_MAX_MEMORY
+#define LUA_CALLER_MAX_MEMORY (0)
+#endif
+
+/**
+ * The maximum number of native bindings a deployment can register.
+ */
+#ifndef LUA_PROVIDER_MAX_BINDINGS
+#define LUA_PROVIDER_MAX_BINDINGS (4)
+#endif
+
+/**
+ * The maximum number of Lua modules a deployment can register.
+ */
+#ifndef LUA_PROVIDER_MAX_MODULES
+#define LUA_PROVIDER_MAX_MODULES (8)
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* Resources held by a caller */
+struct lua_caller {
+    /* FF-A source ID of the caller, valid if env_count is non-zero */
+    uint16_t source_id;
+    size_t env_count;
+    /* bytes of appended scripts that weren't executed yet */
+    size_t script_bytes;
+    /* environments with a suspended script */
+    size_t suspended_count;
+};
+
 struct env_entry {
+    /* handle of the environment, the table index tagged with a rolling count */
+    int32_t handle;
+    /* caller that created the environment, only it can use the environment */
+    struct lua_caller *owner;
+    /* Lua state holding the environment, its own or the shared one */
+    lua_State *lua_state;
+    /* private heap of the environment's own Lua state, NULL if shared */
+    struct lua_env_heap *heap;
     /* reference to the Lua environment table */
     int lua_env_ref;
-    /* contains concatenated script to be interpreted by Lua */
-    char *script_buf;
-    /* current script length in bytes */
-    size_t script_len;
+    /* reference to a closure whose _ENV upvalue is the environment table */
+    int lua_binder_ref;
+    /* reference to the coroutine of a suspended script */
+    int lua_thread_ref;
+    /* cached chunk function run by the suspended script, NULL if it isn't cached */
+    const void *chunk;
+    /* template environment that can't be appended to or executed any more */
+    bool is_frozen;
+    /* appended script chunks to be interpreted by Lua */
+    struct lua_script script;
+    /* script buffer holds precompiled bytecode instead of source */
+    bool is_bytecode;
+    /* output printed by scripts, read by env_read_output */
+    struct lua_output output;
+    /* sampling profiler of the scripts, NULL unless profiling is enabled */
+    struct lua_profiler *profiler;
+    /* instructions left in the current slice, 0 if the script has no budget */
+    int slice_budget;
+    /* instructions between calls of the hook of the running script */
+    int hook_period;
+    /* cost of the environment's scripts, read by env_stats */
+    struct lua_env_metrics metrics;
     /* link to next free index */
     int32_t next;
 };
 
+/* A native module that is made available to scripts as a global table */
+struct lua_binding {
+    const char *name;
+    /* called with context as a light userdata argument, returns the module table */
+    lua_CFunction open;
+    void *context;
+};
+
+/* Garbage collector settings of the provider's Lua states */
+struct lua_gc_params {
+    bool generational;
+    /* incremental mode only, 0 keeps the current value */
+    int pause;
+    int stepmul;
+    /* work done by each lua_provider_collect_garbage call, 0 disables it */
+    int step_kb;
+};
+
 struct lua_provider {
 	struct service_provider base_provider;
     const struct lua_serializer *serializer;
     lua_State *lua_state;
-    struct env_entry env_entries[MAX_ENV_COUNT];
+    struct lua_chunk_cache chunk_cache;
+    /* environment table, indexed by the low bits of environment handles */
+    struct env_entry *env_entries;
+    size_t env_capacity;
     int32_t free_env_entry_ind;
+    uint16_t rolling_count;
+    struct lua_caller callers[LUA_MAX_CALLERS];
+    /* output buffer of the environment whose script is running */
+    struct lua_output *active_output;
+    /* data of the request that runs a script, see buffer.request() */
+    struct lua_buffer_window request_window;
+    struct lua_binding bindings[LUA_PROVIDER_MAX_BINDINGS];
+    size_t num_bindings;
+    const struct lua_module *modules[LUA_PROVIDER_MAX_MODULES];
+    size_t num_modules;
+    struct lua_gc_params gc_params;
+    /* allocation counters of the shared Lua state */
+    struct lua_alloc_meter alloc_meter;
+    /* environment with its own Lua state that is collected next */
+    size_t gc_env_ind;
+    /* instructions per env_execute or env_resume slice, 0 for no limit */
+    int exec_budget;
+    /* size of the private heap of new environments, 0 to use the shared Lua state */
+    size_t env_heap_size;
 };
 
 struct rpc_service_interface *lua_provider_init(struct lua_provider *context);
 
+/*
+ * Delete all environments and close the Lua states. Registered bindings and modules
+ * are kept, the provider can be initialized again.
+ */
+void lua_provider_deinit(struct lua_provider *context);
+
 void lua_provider_register_serializer(
 	struct lua_provider *context,
 	const struct lua_serializer *serializer);
 
+/*
+ * Register a native binding, e.g. a wrapper for a service client, as the global
+ * table name in every Lua state of the provider. Bindings stay registered when
+ * the provider is re-initialized. Returns false if the limit of bindings is
+ * reached or the binding failed to open.
+ */
+bool lua_provider_register_binding(
+	struct lua_provider *context,
+	const char *name,
+	lua_CFunction open,
+	void *binding_context);
+
+/*
+ * Register a Lua module that scripts can load with require(module->name), see
+ * lua_modules.h. The module is compiled in the shared Lua state right away and in
+ * the state of every environment with a private heap when it is created. Modules stay
+ * registered when the provider is re-initialized, module must stay valid. Returns false
+ * if the limit of modules is reached or the module doesn't compile.
+ */
+bool lua_provider_register_module(
+	struct lua_provider *context,
+	const struct lua_module *module);
+
+/*
+ * Change the garbage collector settings of all Lua states, including the ones of
+ * environments created later. lua_provider_init resets them to the build time defaults.
+ */
+void lua_provider_set_gc_params(
+	struct lua_provider *context,
+	const struct lua_gc_params *gc_params);
+
+/*
+ * Change the number of instructions a script may run per env_execute or env_resume
+ * request, 0 lets scripts run to completion. lua_provider_init resets it to
+ * LUA_EXEC_INSTRUCTION_BUDGET.
+ */
+void lua_provider_set_exec_budget(
+	struct lua_provider *context,
+	int exec_budget);
+
+/*
+ * Change the size of the private heap of environments created later, 0 places them in the
+ * shared Lua state. The memory charged to callers assumes all their environments have
+ * heaps of this size, so it should be set before environments are created.
+ * lua_provider_init resets it to LUA_ENV_HEAP_SIZE.
+ */
+void lua_provider_set_env_heap_size(
+	struct lua_provider *context,
+	size_t env_heap_size);
+
+/*
+ * Do a bounded amount of garbage collection work while no script runs. The shared Lua
+ * state and one environment with its own state are stepped per call, taking turns.
+ * Intended to be called by the deployment between requests.
+ */
+void lua_provider_collect_garbage(struct lua_provider *context);
+
+/*
+ * Get the hit, miss and eviction counters of the chunk cache of the shared Lua state.
+ * lua_provider_init resets them.
+ */
+void lua_provider_get_cache_stats(
+	const struct lua_provider *context,
+	struct lua_chunk_cache_stats *stats);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lua_script.h"
+
+#define FNV1A_64_OFFSET_BASIS	(0xcbf29ce484222325ULL)
+#define FNV1A_64_PRIME		(0x00000100000001b3ULL)
+
+void lua_script_init(struct lua_script *script)
+{
+	script->head = NULL;
+	script->tail = NULL;
+	script->len = 0;
+}
+
+bool lua_script_append(struct lua_script *script, const uint8_t *data, size_t len)
+{
+	struct lua_script_chunk *chunk = NULL;
+
+	if (len == 0)
+		return true;
+
+	if (len > SIZE_MAX - sizeof(*chunk))
+		return false;
+
+	chunk = (struct lua_script_chunk *)malloc(sizeof(*chunk) + len);
+	if (!chunk)
+		return false;
+
+	chunk->next = NULL;
+	chunk->len = len;
+	memcpy(chunk->data, data, len);
+
+	if (script->tail)
+		script->tail->next = chunk;
+	else
+		script->head = chunk;
+
+	script->tail = chunk;
+	script->len += len;
+
+	return true;
+}
+
+void lua_script_clear(struct lua_script *script)
+{
+	struct lua_script_chunk *chunk = script->head;
+
+	while (chunk) {
+		struct lua_script_chunk *next = chunk->next;
+
+		free(chunk);
+		chunk = next;
+	}
+
+	lua_script_init(script);
+}
+
+void lua_script_move(struct lua_script *dst, struct lua_script *src)
+{
+	*dst = *src;
+	lua_script_init(src);
+}
+
+bool lua_script_equal(const struct lua_script *a, const struct lua_script *b)
+{
+	const struct lua_script_chunk *chunk_a = a->head;
+	const struct lua_script_chunk *chunk_b = b->head;
+	size_t offset_a = 0;
+	size_t offset_b = 0;
+
+	if (a->len != b->len)
+		return false;
+
+	/* Compare the overlapping parts of the current chunks */
+	while (chunk_a && chunk_b) {
+		size_t len = chunk_a->len - offset_a;
+
+		if (chunk_b->len - offset_b < len)
+			len = chunk_b->len - offset_b;
+
+		if (memcmp(&chunk_a->data[offset_a], &chunk_b->data[offset_b], len))
+			return false;
+
+		offset_a += len;
+		offset_b += len;
+
+		if (offset_a == chunk_a->len) {
+			chunk_a = chunk_a->next;
+			offset_a = 0;
+		}
+
+		if (offset_b == chunk_b->len) {
+			chunk_b = chunk_b->next;
+			offset_b = 0;
+		}
+	}
+
+	return true;
+}
+
+uint64_t lua_script_digest(const struct lua_script *script)
+{
+	uint64_t digest = FNV1A_64_OFFSET_BASIS;
+
+	for (const struct lua_script_chunk *chunk = script->head; chunk; chunk = chunk->next) {
+		for (size_t i = 0; i < chunk->len; i++) {
+			digest ^= chunk->data[i];
+			digest *= FNV1A_64_PRIME;
+		}
+	}
+
+	return digest;
+}
+
+static const char *read_chunk(lua_State *L, void *ud, size_t *size)
+{
+	const struct lua_script_chunk **chunk = (const struct lua_script_chunk **)ud;
+	const struct lua_script_chunk *current = *chunk;
+
+	(void)L;
+
+	if (!current) {
+		*size = 0;
+		return NULL;
+	}
+
+	*chunk = current->next;
+	*size = current->len;
+
+	return (const char *)current->data;
+}
+
+int lua_script_load(lua_State *L, const struct lua_script *script, const char *chunkname,
+		    const char *mode)
+{
+	const struct lua_script_chunk *chunk = script->head;
+
+	return lua_load(L, read_chunk, &chunk, chunkname, mode);
+}
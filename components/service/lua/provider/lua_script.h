@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LUA_SCRIPT_H
+#define LUA_SCRIPT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <lua.h>
+
+/**
+ * Scripts are uploaded in RPC sized pieces. Instead of growing one contiguous
+ * buffer on every append, each piece is kept in its own chunk and the chunk
+ * list is fed to lua_load through a lua_Reader. Every script byte is copied
+ * once and no allocation is larger than a single append.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct lua_script_chunk {
+	struct lua_script_chunk *next;
+	size_t len;
+	uint8_t data[];
+};
+
+struct lua_script {
+	struct lua_script_chunk *head;
+	struct lua_script_chunk *tail;
+	/* total script length in bytes */
+	size_t len;
+};
+
+/*
+ * Initializes an empty script.
+ */
+void lua_script_init(struct lua_script *script);
+
+/*
+ * Appends a copy of data to the end of the script. Returns false if out of memory.
+ */
+bool lua_script_append(struct lua_script *script, const uint8_t *data, size_t len);
+
+/*
+ * Frees all chunks, leaving an empty script.
+ */
+void lua_script_clear(struct lua_script *script);
+
+/*
+ * Moves all chunks of src to dst, leaving src empty. dst must be empty.
+ */
+void lua_script_move(struct lua_script *dst, struct lua_script *src);
+
+/*
+ * Returns true if the two scripts hold the same bytes, regardless of how they
+ * are split into chunks.
+ */
+bool lua_script_equal(const struct lua_script *a, const struct lua_script *b);
+
+/*
+ * Calculates the 64-bit FNV-1a digest of the script.
+ */
+uint64_t lua_script_digest(const struct lua_script *script);
+
+/*
+ * Loads the script as a Lua chunk with lua_load. Returns the lua_load status, the
+ * compiled function or the error message is pushed onto the stack.
+ */
+int lua_script_load(lua_State *L, const struct lua_script *script, const char *chunkname,
+		    const char *mode);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LUA_SCRIPT_H */
@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include "common/uuid/uuid.h"
 #include "components/rpc/common/endpoint/rpc_service_interface.h"
+#include "components/service/lua/provider/lua_metrics.h"
 
 /* Provides a common interface for parameter serialization operations
  * for the Lua service provider.  Allows alternative serialization
@@ -23,18 +24,67 @@ struct lua_serializer {
 	/* Operation: env_create */
 	rpc_status_t (*serialize_env_create_resp)(struct rpc_buffer *resp_buf, int32_t env_index);
 
+	/* Operation: env_clone, the response is serialized as for env_create */
+	rpc_status_t (*deserialize_env_clone_req)(const struct rpc_buffer *req_buf,
+		int32_t *template_index);
+
 	/* Operation: env_append */
 	rpc_status_t (*deserialize_env_append_req)(const struct rpc_buffer *req_buf,
 		int32_t *env_index,
 		const uint8_t **script,
 		size_t *script_len);
 
+	/* Operation: env_append_bytecode */
+	rpc_status_t (*deserialize_env_append_bytecode_req)(const struct rpc_buffer *req_buf,
+		int32_t *env_index,
+		const uint8_t **bytecode,
+		size_t *bytecode_len);
+
 	/* Operation: env_execute */
-	rpc_status_t (*deserialize_env_execute_req)(const struct rpc_buffer *req_buf, int32_t *env_index);
+	rpc_status_t (*deserialize_env_execute_req)(const struct rpc_buffer *req_buf,
+		int32_t *env_index,
+		const uint8_t **input,
+		size_t *input_len);
 
+	/* The payload is the error message on failure or the CBOR encoded results on success */
 	rpc_status_t (*serialize_env_execute_resp)(struct rpc_buffer *resp_buf,
-		const uint8_t *err_msg,
-		size_t err_len);
+		const uint8_t *payload,
+		size_t payload_len);
+
+	/* Operation: env_resume, the response is serialized as for env_execute */
+	rpc_status_t (*deserialize_env_resume_req)(const struct rpc_buffer *req_buf,
+		int32_t *env_index,
+		const uint8_t **input,
+		size_t *input_len);
+
+	/* Operation: env_run, the response is serialized as for env_execute */
+	rpc_status_t (*deserialize_env_run_req)(const struct rpc_buffer *req_buf,
+		uint32_t *flags,
+		const uint8_t **script,
+		size_t *script_len);
+
+	/* Operation: env_read_output */
+	rpc_status_t (*deserialize_env_read_output_req)(const struct rpc_buffer *req_buf,
+		int32_t *env_index);
+
+	rpc_status_t (*serialize_env_read_output_resp)(struct rpc_buffer *resp_buf,
+		const uint8_t *output,
+		size_t output_len,
+		uint32_t lost_len,
+		size_t *written_len);
+
+	/* Operation: env_profile_result, the response is serialized as for env_execute */
+	rpc_status_t (*deserialize_env_profile_result_req)(const struct rpc_buffer *req_buf,
+		int32_t *env_index,
+		uint32_t *sample_interval);
+
+	/* Operation: env_stats */
+	rpc_status_t (*deserialize_env_stats_req)(const struct rpc_buffer *req_buf,
+		int32_t *env_index);
+
+	rpc_status_t (*serialize_env_stats_resp)(struct rpc_buffer *resp_buf,
+		const struct lua_env_metrics *metrics,
+		uint64_t tick_frequency);
 
 	/* Operation: env_delete */
 	rpc_status_t (*deserialize_env_delete_req)(const struct rpc_buffer *req_buf, int32_t *env_index);
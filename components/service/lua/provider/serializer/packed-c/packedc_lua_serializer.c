@@ -28,6 +28,23 @@ rpc_status_t serialize_env_create_resp(struct rpc_buffer *resp_buf, int32_t env_
 	return rpc_status;
 }
 
+/* Operation: env_clone */
+rpc_status_t deserialize_env_clone_req(const struct rpc_buffer *req_buf,
+	int32_t *template_index)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INVALID_REQUEST_BODY;
+	struct ts_lua_env_clone_in recv_msg;
+	size_t expected_fixed_len = sizeof(struct ts_lua_env_clone_in);
+
+	if (expected_fixed_len <= req_buf->data_length) {
+		memcpy(&recv_msg, req_buf->data, expected_fixed_len);
+		*template_index = recv_msg.template_index;
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
 /* Operation: env_append */
 rpc_status_t deserialize_env_append_req(const struct rpc_buffer *req_buf,
 	int32_t *env_index,
@@ -52,8 +69,35 @@ rpc_status_t deserialize_env_append_req(const struct rpc_buffer *req_buf,
 	return rpc_status;
 }
 
+/* Operation: env_append_bytecode */
+rpc_status_t deserialize_env_append_bytecode_req(const struct rpc_buffer *req_buf,
+	int32_t *env_index,
+	const uint8_t **bytecode,
+	size_t *bytecode_len)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INVALID_REQUEST_BODY;
+	struct ts_lua_env_append_bytecode_in recv_msg;
+	size_t expected_fixed_len = sizeof(struct ts_lua_env_append_bytecode_in);
+
+	if (expected_fixed_len <= req_buf->data_length) {
+		memcpy(&recv_msg, req_buf->data, expected_fixed_len);
+
+		*env_index = recv_msg.env_index;
+
+		*bytecode = (const uint8_t *)req_buf->data + expected_fixed_len;
+		*bytecode_len = req_buf->data_length - expected_fixed_len;
+
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
 /* Operation: env_execute */
-rpc_status_t deserialize_env_execute_req(const struct rpc_buffer *req_buf, int32_t *env_index)
+rpc_status_t deserialize_env_execute_req(const struct rpc_buffer *req_buf,
+	int32_t *env_index,
+	const uint8_t **input,
+	size_t *input_len)
 {
 	rpc_status_t rpc_status = RPC_ERROR_INVALID_REQUEST_BODY;
 	struct ts_lua_env_execute_in recv_msg;
@@ -61,7 +105,12 @@ rpc_status_t deserialize_env_execute_req(const struct rpc_buffer *req_buf, int32
 
 	if (expected_fixed_len <= req_buf->data_length) {
 		memcpy(&recv_msg, req_buf->data, expected_fixed_len);
+
 		*env_index = recv_msg.env_index;
+
+		*input = (const uint8_t *)req_buf->data + expected_fixed_len;
+		*input_len = req_buf->data_length - expected_fixed_len;
+
 		rpc_status = RPC_SUCCESS;
 	}
 
@@ -69,17 +118,178 @@ rpc_status_t deserialize_env_execute_req(const struct rpc_buffer *req_buf, int32
 }
 
 rpc_status_t serialize_env_execute_resp(struct rpc_buffer *resp_buf,
-	const uint8_t *err_msg,
-	size_t err_len)
+	const uint8_t *payload,
+	size_t payload_len)
 {
 	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
 
-	if (err_len == 0) {
+	if (payload_len == 0) {
 		resp_buf->data_length = 0;
 		rpc_status = RPC_SUCCESS;
-	} else if (err_len <= resp_buf->size) {
-		memcpy(resp_buf->data, err_msg, err_len);
-		resp_buf->data_length = err_len;
+	} else if (payload_len <= resp_buf->size) {
+		memcpy(resp_buf->data, payload, payload_len);
+		resp_buf->data_length = payload_len;
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
+/* Operation: env_resume */
+rpc_status_t deserialize_env_resume_req(const struct rpc_buffer *req_buf,
+	int32_t *env_index,
+	const uint8_t **input,
+	size_t *input_len)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INVALID_REQUEST_BODY;
+	struct ts_lua_env_resume_in recv_msg;
+	size_t expected_fixed_len = sizeof(struct ts_lua_env_resume_in);
+
+	if (expected_fixed_len <= req_buf->data_length) {
+		memcpy(&recv_msg, req_buf->data, expected_fixed_len);
+
+		*env_index = recv_msg.env_index;
+
+		*input = (const uint8_t *)req_buf->data + expected_fixed_len;
+		*input_len = req_buf->data_length - expected_fixed_len;
+
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
+/* Operation: env_run */
+rpc_status_t deserialize_env_run_req(const struct rpc_buffer *req_buf,
+	uint32_t *flags,
+	const uint8_t **script,
+	size_t *script_len)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INVALID_REQUEST_BODY;
+	struct ts_lua_env_run_in recv_msg;
+	size_t expected_fixed_len = sizeof(struct ts_lua_env_run_in);
+
+	if (expected_fixed_len <= req_buf->data_length) {
+		memcpy(&recv_msg, req_buf->data, expected_fixed_len);
+
+		*flags = recv_msg.flags;
+
+		*script = (const uint8_t *)req_buf->data + expected_fixed_len;
+		*script_len = req_buf->data_length - expected_fixed_len;
+
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
+/* Operation: env_read_output */
+rpc_status_t deserialize_env_read_output_req(const struct rpc_buffer *req_buf,
+	int32_t *env_index)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INVALID_REQUEST_BODY;
+	struct ts_lua_env_read_output_in recv_msg;
+	size_t expected_fixed_len = sizeof(struct ts_lua_env_read_output_in);
+
+	if (expected_fixed_len <= req_buf->data_length) {
+		memcpy(&recv_msg, req_buf->data, expected_fixed_len);
+		*env_index = recv_msg.env_index;
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
+rpc_status_t serialize_env_read_output_resp(struct rpc_buffer *resp_buf,
+	const uint8_t *output,
+	size_t output_len,
+	uint32_t lost_len,
+	size_t *written_len)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+	struct ts_lua_env_read_output_out resp_msg;
+	size_t fixed_len = sizeof(struct ts_lua_env_read_output_out);
+
+	*written_len = 0;
+
+	if (fixed_len <= resp_buf->size) {
+		/* Return as much output as fits */
+		size_t len = resp_buf->size - fixed_len;
+
+		if (len > output_len)
+			len = output_len;
+
+		resp_msg.remaining_len = output_len - len;
+		resp_msg.lost_len = lost_len;
+
+		memcpy(resp_buf->data, &resp_msg, fixed_len);
+		memcpy((uint8_t *)resp_buf->data + fixed_len, output, len);
+		resp_buf->data_length = fixed_len + len;
+
+		*written_len = len;
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
+/* Operation: env_profile_result */
+rpc_status_t deserialize_env_profile_result_req(const struct rpc_buffer *req_buf,
+	int32_t *env_index,
+	uint32_t *sample_interval)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INVALID_REQUEST_BODY;
+	struct ts_lua_env_profile_result_in recv_msg;
+	size_t expected_fixed_len = sizeof(struct ts_lua_env_profile_result_in);
+
+	if (expected_fixed_len <= req_buf->data_length) {
+		memcpy(&recv_msg, req_buf->data, expected_fixed_len);
+		*env_index = recv_msg.env_index;
+		*sample_interval = recv_msg.sample_interval;
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
+/* Operation: env_stats */
+rpc_status_t deserialize_env_stats_req(const struct rpc_buffer *req_buf,
+	int32_t *env_index)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INVALID_REQUEST_BODY;
+	struct ts_lua_env_stats_in recv_msg;
+	size_t expected_fixed_len = sizeof(struct ts_lua_env_stats_in);
+
+	if (expected_fixed_len <= req_buf->data_length) {
+		memcpy(&recv_msg, req_buf->data, expected_fixed_len);
+		*env_index = recv_msg.env_index;
+		rpc_status = RPC_SUCCESS;
+	}
+
+	return rpc_status;
+}
+
+rpc_status_t serialize_env_stats_resp(struct rpc_buffer *resp_buf,
+	const struct lua_env_metrics *metrics,
+	uint64_t tick_frequency)
+{
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+	struct ts_lua_env_stats_out resp_msg;
+	size_t fixed_len = sizeof(struct ts_lua_env_stats_out);
+
+	if (fixed_len <= resp_buf->size) {
+		resp_msg.tick_frequency = tick_frequency;
+		resp_msg.parse_ticks = metrics->parse_ticks;
+		resp_msg.exec_ticks = metrics->exec_ticks;
+		resp_msg.instructions = metrics->instructions;
+		resp_msg.bytes_allocated = metrics->bytes_allocated;
+		resp_msg.peak_memory = metrics->peak_memory;
+		resp_msg.gc_cycles = metrics->gc_cycles;
+		resp_msg.execute_count = metrics->execute_count;
+		resp_msg.slice_count = metrics->slice_count;
+
+		memcpy(resp_buf->data, &resp_msg, fixed_len);
+		resp_buf->data_length = fixed_len;
 		rpc_status = RPC_SUCCESS;
 	}
 
@@ -109,9 +319,18 @@ const struct lua_serializer *packedc_lua_serializer_instance(void)
 	static const struct lua_serializer instance =
 	{
 		serialize_env_create_resp,
+		deserialize_env_clone_req,
 		deserialize_env_append_req,
+		deserialize_env_append_bytecode_req,
 		deserialize_env_execute_req,
 		serialize_env_execute_resp,
+		deserialize_env_resume_req,
+		deserialize_env_run_req,
+		deserialize_env_read_output_req,
+		serialize_env_read_output_resp,
+		deserialize_env_profile_result_req,
+		deserialize_env_stats_req,
+		serialize_env_stats_resp,
 		deserialize_env_delete_req
 	};
 
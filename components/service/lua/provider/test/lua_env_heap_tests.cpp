@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <cstring>
+#include <CppUTest/TestHarness.h>
+#include <service/lua/provider/lua_env_heap.h>
+
+/*
+ * Tests of the private heap of environments. Blocks larger than
+ * LUA_ENV_HEAP_SMALL_LIMIT are served from the address ordered free list,
+ * smaller ones are recycled through the size class free lists.
+ */
+TEST_GROUP(LuaEnvHeapTests)
+{
+	void setup()
+	{
+		m_heap = lua_env_heap_create(HEAP_SIZE);
+		CHECK_TRUE(m_heap);
+	}
+
+	void teardown()
+	{
+		lua_env_heap_destroy(m_heap);
+	}
+
+	void *alloc(size_t size)
+	{
+		return lua_env_heap_alloc(m_heap, NULL, 0, size);
+	}
+
+	void *realloc(void *ptr, size_t osize, size_t nsize)
+	{
+		return lua_env_heap_alloc(m_heap, ptr, osize, nsize);
+	}
+
+	void release(void *ptr, size_t size)
+	{
+		POINTERS_EQUAL(NULL, lua_env_heap_alloc(m_heap, ptr, size, 0));
+	}
+
+	static const size_t HEAP_SIZE = 8192;
+	/* Payload of a large block that takes 512 bytes of the arena with its header */
+	static const size_t LARGE_PAYLOAD = 496;
+	static const size_t LARGE_BLOCK = 512;
+
+	struct lua_env_heap *m_heap;
+};
+
+TEST(LuaEnvHeapTests, splitAndCoalesce)
+{
+	uint8_t *a = (uint8_t *)alloc(LARGE_PAYLOAD);
+	uint8_t *b = (uint8_t *)alloc(LARGE_PAYLOAD);
+	uint8_t *c = (uint8_t *)alloc(LARGE_PAYLOAD);
+
+	CHECK_TRUE(a && b && c);
+
+	/* Each block is split off the front of the free arena */
+	POINTERS_EQUAL(a + LARGE_BLOCK, b);
+	POINTERS_EQUAL(b + LARGE_BLOCK, c);
+	UNSIGNED_LONGS_EQUAL(3 * LARGE_BLOCK, m_heap->used);
+
+	/* The freed neighbours merge into one block that fits twice the payload */
+	release(b, LARGE_PAYLOAD);
+	release(a, LARGE_PAYLOAD);
+	UNSIGNED_LONGS_EQUAL(LARGE_BLOCK, m_heap->used);
+
+	uint8_t *d = (uint8_t *)alloc(2 * LARGE_BLOCK - 32);
+	POINTERS_EQUAL(a, d);
+
+	/* Freeing everything leaves a single block spanning the arena */
+	release(c, LARGE_PAYLOAD);
+	release(d, 2 * LARGE_BLOCK - 32);
+	UNSIGNED_LONGS_EQUAL(0, m_heap->used);
+
+	uint8_t *all = (uint8_t *)alloc(m_heap->arena_size - 32);
+	POINTERS_EQUAL(a, all);
+	release(all, m_heap->arena_size - 32);
+}
+
+TEST(LuaEnvHeapTests, smallBlocksAreRecycled)
+{
+	void *a = alloc(20);
+	void *b = alloc(20);
+
+	CHECK_TRUE(a && b);
+	release(a, 20);
+
+	/* A block of the same size class is reused */
+	POINTERS_EQUAL(a, alloc(24));
+
+	release(a, 24);
+	release(b, 20);
+	UNSIGNED_LONGS_EQUAL(0, m_heap->used);
+}
+
+TEST(LuaEnvHeapTests, reallocInPlaceAndMoving)
+{
+	uint8_t *a = (uint8_t *)alloc(20);
+	uint8_t *b = (uint8_t *)alloc(LARGE_PAYLOAD);
+
+	CHECK_TRUE(a && b);
+	memset(a, 0x5a, 20);
+
+	/* Growing within the slack of the block and shrinking keep the block */
+	POINTERS_EQUAL(a, realloc(a, 20, 30));
+	POINTERS_EQUAL(a, realloc(a, 30, 8));
+	POINTERS_EQUAL(a, realloc(a, 8, 20));
+
+	/* Growing beyond the block moves it and keeps the contents */
+	uint8_t *moved = (uint8_t *)realloc(a, 20, 200);
+	CHECK_TRUE(moved);
+	CHECK_TRUE(moved != a);
+
+	for (size_t i = 0; i < 20; i++)
+		UNSIGNED_LONGS_EQUAL(0x5a, moved[i]);
+
+	release(moved, 200);
+	release(b, LARGE_PAYLOAD);
+	UNSIGNED_LONGS_EQUAL(0, m_heap->used);
+}
+
+TEST(LuaEnvHeapTests, limitIsEnforced)
+{
+	m_heap->limit = 2 * LARGE_BLOCK;
+
+	void *a = alloc(LARGE_PAYLOAD);
+	void *b = alloc(LARGE_PAYLOAD);
+
+	CHECK_TRUE(a && b);
+
+	/* The arena has room, but the limit is reached */
+	POINTERS_EQUAL(NULL, alloc(20));
+	POINTERS_EQUAL(NULL, realloc(a, LARGE_PAYLOAD, 2 * LARGE_PAYLOAD));
+	UNSIGNED_LONGS_EQUAL(2 * LARGE_BLOCK, m_heap->used);
+
+	/* Shrinking never fails */
+	POINTERS_EQUAL(a, realloc(a, LARGE_PAYLOAD, 16));
+
+	release(a, 16);
+	POINTERS_EQUAL(a, alloc(LARGE_PAYLOAD));
+
+	release(a, LARGE_PAYLOAD);
+	release(b, LARGE_PAYLOAD);
+}
+
+TEST(LuaEnvHeapTests, arenaExhaustion)
+{
+	POINTERS_EQUAL(NULL, alloc(HEAP_SIZE));
+	POINTERS_EQUAL(NULL, alloc((size_t)-1));
+	UNSIGNED_LONGS_EQUAL(0, m_heap->used);
+
+	/* Blocks cached in the size class lists are coalesced when a large block is needed */
+	void *small[16];
+
+	for (size_t i = 0; i < 16; i++) {
+		small[i] = alloc(100);
+		CHECK_TRUE(small[i]);
+	}
+
+	for (size_t i = 0; i < 16; i++)
+		release(small[i], 100);
+
+	void *all = alloc(m_heap->arena_size - 32);
+	POINTERS_EQUAL(small[0], all);
+	release(all, m_heap->arena_size - 32);
+}
@@ -0,0 +1,538 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <CppUTest/TestHarness.h>
+#include <protocols/rpc/common/packed-c/status.h>
+#include <protocols/service/lua/status.h>
+#include <rpc/direct/direct_caller.h>
+#include <service/lua/client/lua_client.h>
+#include <service/lua/client/results/lua_results.h>
+#include <service/lua/provider/lua_provider.h>
+#include <service/lua/provider/lua_uuid.h>
+#include <service/lua/provider/serializer/packed-c/packedc_lua_serializer.h>
+
+/*
+ * Tests of the Lua provider through the Lua client. Each client has its own
+ * direct caller, so the provider sees them as different callers.
+ */
+TEST_GROUP(LuaProviderTests)
+{
+	void setup()
+	{
+		memset(&m_lua_provider, 0, sizeof(m_lua_provider));
+
+		struct rpc_service_interface *lua_iface = lua_provider_init(&m_lua_provider);
+		CHECK_TRUE(lua_iface);
+		lua_provider_register_serializer(&m_lua_provider,
+						 packedc_lua_serializer_instance());
+
+		for (unsigned int i = 0; i < NUM_CLIENTS; i++)
+			open_client(lua_iface, &m_clients[i]);
+	}
+
+	void teardown()
+	{
+		for (unsigned int i = 0; i < NUM_CLIENTS; i++)
+			close_client(&m_clients[i]);
+
+		lua_provider_deinit(&m_lua_provider);
+	}
+
+	struct test_client {
+		struct rpc_caller_interface caller;
+		struct rpc_caller_session session;
+		struct lua_client lua_client;
+	};
+
+	void open_client(struct rpc_service_interface *lua_iface, struct test_client *client)
+	{
+		const struct rpc_uuid service_uuid = { .uuid = TS_LUA_SERVICE_UUID };
+
+		memset(client, 0, sizeof(*client));
+
+		LONGS_EQUAL(RPC_SUCCESS, direct_caller_init(&client->caller, lua_iface));
+		LONGS_EQUAL(RPC_SUCCESS, rpc_caller_session_find_and_open(&client->session,
+									  &client->caller,
+									  &service_uuid, 4096));
+		lua_client_init(&client->lua_client, &client->session);
+	}
+
+	void close_client(struct test_client *client)
+	{
+		lua_client_deinit(&client->lua_client);
+		rpc_caller_session_close(&client->session);
+		direct_caller_deinit(&client->caller);
+	}
+
+	int32_t create_env(struct test_client *client)
+	{
+		int32_t env = -1;
+
+		LONGS_EQUAL(LUA_SUCCESS, env_create(&client->lua_client, &env));
+
+		return env;
+	}
+
+	void append(struct test_client *client, int32_t env, const char *script)
+	{
+		LONGS_EQUAL(LUA_SUCCESS, env_append(&client->lua_client, env,
+						    (const uint8_t *)script, strlen(script)));
+	}
+
+	/* Execute the appended script and resume it until it finishes */
+	lua_status_t run_to_completion(struct test_client *client, int32_t env,
+				       unsigned int *slices)
+	{
+		lua_status_t status = env_execute(&client->lua_client, env, NULL, 0,
+						  sizeof(m_payload), m_payload, &m_payload_len);
+
+		for (*slices = 1; status == LUA_IN_PROGRESS; (*slices)++)
+			status = env_resume(&client->lua_client, env, NULL, 0, sizeof(m_payload),
+					    m_payload, &m_payload_len);
+
+		return status;
+	}
+
+	/* Decode the single integer the last script returned */
+	int64_t integer_result()
+	{
+		struct lua_results results;
+		struct lua_result result;
+		size_t count = 0;
+
+		LONGS_EQUAL(LUA_SUCCESS, lua_results_init(&results, m_payload, m_payload_len,
+							  &count));
+		UNSIGNED_LONGS_EQUAL(1, count);
+		CHECK_TRUE(lua_results_next(&results, &result));
+		LONGS_EQUAL(LUA_RESULT_INTEGER, result.type);
+		LONGS_EQUAL(LUA_SUCCESS, lua_results_finish(&results));
+
+		return result.value.integer;
+	}
+
+	/* Decode the single boolean the last script returned */
+	bool boolean_result()
+	{
+		struct lua_results results;
+		struct lua_result result;
+		size_t count = 0;
+
+		LONGS_EQUAL(LUA_SUCCESS, lua_results_init(&results, m_payload, m_payload_len,
+							  &count));
+		UNSIGNED_LONGS_EQUAL(1, count);
+		CHECK_TRUE(lua_results_next(&results, &result));
+		LONGS_EQUAL(LUA_RESULT_BOOLEAN, result.type);
+		LONGS_EQUAL(LUA_SUCCESS, lua_results_finish(&results));
+
+		return result.value.boolean;
+	}
+
+	/* Decode the single string the last script returned */
+	std::string string_result()
+	{
+		struct lua_results results;
+		struct lua_result result;
+		size_t count = 0;
+
+		LONGS_EQUAL(LUA_SUCCESS, lua_results_init(&results, m_payload, m_payload_len,
+							  &count));
+		UNSIGNED_LONGS_EQUAL(1, count);
+		CHECK_TRUE(lua_results_next(&results, &result));
+		LONGS_EQUAL(LUA_RESULT_STRING, result.type);
+		LONGS_EQUAL(LUA_SUCCESS, lua_results_finish(&results));
+
+		return std::string((const char *)result.value.string.data, result.value.string.len);
+	}
+
+	static const unsigned int NUM_CLIENTS = 2;
+
+	struct lua_provider m_lua_provider;
+	struct test_client m_clients[NUM_CLIENTS];
+	uint8_t m_payload[1024];
+	size_t m_payload_len;
+};
+
+TEST(LuaProviderTests, scriptsRunToCompletionByDefault)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env = create_env(client);
+	unsigned int slices = 0;
+
+	append(client, env, "local n = 0 for i = 1, 1000000 do n = n + 1 end return n");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+	UNSIGNED_LONGS_EQUAL(1, slices);
+	LONGS_EQUAL(1000000, integer_result());
+}
+
+TEST(LuaProviderTests, budgetSuspendsScript)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env = create_env(client);
+	unsigned int slices = 0;
+
+	lua_provider_set_exec_budget(&m_lua_provider, 10000);
+
+	append(client, env, "local n = 0 for i = 1, 100000 do n = n + 1 end return n");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+	CHECK_TRUE(slices > 1);
+	LONGS_EQUAL(100000, integer_result());
+}
+
+TEST(LuaProviderTests, budgetDoesNotYieldScriptCoroutines)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env = create_env(client);
+	unsigned int slices = 0;
+
+	lua_provider_set_exec_budget(&m_lua_provider, 10000);
+
+	/* A generator only yields the values it produces, never to the provider */
+	append(client, env,
+	       "local gen = coroutine.wrap(function()\n"
+	       "  for i = 1, 50000 do coroutine.yield(i) end\n"
+	       "end)\n"
+	       "local sum = 0\n"
+	       "for i = 1, 50000 do sum = sum + gen() end\n"
+	       "return sum\n");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+	CHECK_TRUE(slices > 1);
+	LONGS_EQUAL(1250025000, integer_result());
+}
+
+TEST(LuaProviderTests, repeatedScriptIsCacheHit)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env = create_env(client);
+	struct lua_chunk_cache_stats stats;
+	unsigned int slices = 0;
+	const char *script = "return 42";
+
+	append(client, env, script);
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+
+	lua_provider_get_cache_stats(&m_lua_provider, &stats);
+	UNSIGNED_LONGS_EQUAL(0, stats.hits);
+	UNSIGNED_LONGS_EQUAL(1, stats.misses);
+
+	append(client, env, script);
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+	LONGS_EQUAL(42, integer_result());
+
+	lua_provider_get_cache_stats(&m_lua_provider, &stats);
+	UNSIGNED_LONGS_EQUAL(1, stats.hits);
+	UNSIGNED_LONGS_EQUAL(1, stats.misses);
+	UNSIGNED_LONGS_EQUAL(0, stats.evictions);
+}
+
+TEST(LuaProviderTests, privateHeapLimitsEnvironment)
+{
+	struct test_client *client = &m_clients[0];
+	unsigned int slices = 0;
+
+	lua_provider_set_env_heap_size(&m_lua_provider, 256 * 1024);
+
+	int32_t env = create_env(client);
+	struct env_entry *entry = &m_lua_provider.env_entries[env & 0xffff];
+
+	CHECK_TRUE(entry->heap);
+
+	/* Exhausting the private heap only fails the script of the environment */
+	append(client, env, "local t = {} for i = 1, 10000000 do t[i] = i end return #t");
+	LONGS_EQUAL(LUA_ERROR_OUT_OF_MEMORY, run_to_completion(client, env, &slices));
+
+	append(client, env, "return 1 + 1");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+	LONGS_EQUAL(2, integer_result());
+
+	/* Deleting the environment releases the whole arena */
+	LONGS_EQUAL(LUA_SUCCESS, env_delete(&client->lua_client, env));
+	POINTERS_EQUAL(NULL, entry->heap);
+	POINTERS_EQUAL(NULL, entry->lua_state);
+}
+
+TEST(LuaProviderTests, cachedScriptInterleavedInTwoEnvironments)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env_a = create_env(client);
+	int32_t env_b = create_env(client);
+	unsigned int slices = 0;
+	const char *script = "n = 0 for i = 1, 100000 do n = n + 1 end return tag .. n";
+
+	append(client, env_a, "tag = 'a'");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env_a, &slices));
+	append(client, env_b, "tag = 'b'");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env_b, &slices));
+
+	lua_provider_set_exec_budget(&m_lua_provider, 10000);
+
+	/* Suspend the script in environment a, then run the same script in environment b */
+	append(client, env_a, script);
+	LONGS_EQUAL(LUA_IN_PROGRESS, env_execute(&client->lua_client, env_a, NULL, 0,
+						 sizeof(m_payload), m_payload, &m_payload_len));
+
+	append(client, env_b, script);
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env_b, &slices));
+	STRCMP_EQUAL("b100000", string_result().c_str());
+
+	/* The suspended script still sees the globals of its own environment */
+	lua_status_t status = LUA_IN_PROGRESS;
+
+	while (status == LUA_IN_PROGRESS)
+		status = env_resume(&client->lua_client, env_a, NULL, 0, sizeof(m_payload),
+				    m_payload, &m_payload_len);
+
+	LONGS_EQUAL(LUA_SUCCESS, status);
+	STRCMP_EQUAL("a100000", string_result().c_str());
+
+	/* Running the cached script again in a finished environment is unaffected */
+	append(client, env_a, script);
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env_a, &slices));
+	STRCMP_EQUAL("a100000", string_result().c_str());
+}
+
+TEST(LuaProviderTests, unsupportedResultsAreEncodedAsNull)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env = create_env(client);
+	unsigned int slices = 0;
+	struct lua_results results;
+	struct lua_result result;
+	size_t count = 0;
+
+	/* The map entry with a function as key is left out */
+	append(client, env, "return print, { 1, print }, { [print] = 2, a = 3 }");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+
+	LONGS_EQUAL(LUA_SUCCESS, lua_results_init(&results, m_payload, m_payload_len, &count));
+	UNSIGNED_LONGS_EQUAL(3, count);
+
+	CHECK_TRUE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_RESULT_NIL, result.type);
+
+	CHECK_TRUE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_RESULT_ARRAY, result.type);
+	UNSIGNED_LONGS_EQUAL(2, result.value.count);
+	CHECK_TRUE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_RESULT_INTEGER, result.type);
+	LONGS_EQUAL(1, result.value.integer);
+	CHECK_TRUE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_RESULT_NIL, result.type);
+
+	CHECK_TRUE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_RESULT_MAP, result.type);
+	UNSIGNED_LONGS_EQUAL(1, result.value.count);
+	CHECK_TRUE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_RESULT_STRING, result.key_type);
+	LONGS_EQUAL(LUA_RESULT_INTEGER, result.type);
+	LONGS_EQUAL(3, result.value.integer);
+
+	CHECK_FALSE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_SUCCESS, lua_results_finish(&results));
+}
+
+TEST(LuaProviderTests, selfReferencingTablesAreEncodedAsNull)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env = create_env(client);
+	unsigned int slices = 0;
+	struct lua_results results;
+	struct lua_result result;
+	size_t count = 0;
+
+	append(client, env, "local t = {} for i = 1, 100 do t[i] = t end return t");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+
+	LONGS_EQUAL(LUA_SUCCESS, lua_results_init(&results, m_payload, m_payload_len, &count));
+	UNSIGNED_LONGS_EQUAL(1, count);
+
+	CHECK_TRUE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_RESULT_ARRAY, result.type);
+	UNSIGNED_LONGS_EQUAL(100, result.value.count);
+
+	for (unsigned int i = 0; i < 100; i++) {
+		CHECK_TRUE(lua_results_next(&results, &result));
+		LONGS_EQUAL(LUA_RESULT_NIL, result.type);
+	}
+
+	CHECK_FALSE(lua_results_next(&results, &result));
+	LONGS_EQUAL(LUA_SUCCESS, lua_results_finish(&results));
+}
+
+TEST(LuaProviderTests, sharedTablesStopAtFullBuffer)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env = create_env(client);
+	unsigned int slices = 0;
+
+	/* Expanded, the result has 100^12 leaves, encoding gives up once the response is full */
+	append(client, env,
+	       "local a = {} "
+	       "for d = 1, 12 do local b = {} for i = 1, 100 do b[i] = a end a = b end "
+	       "return a");
+	LONGS_EQUAL(LUA_ERROR_BUFFER_TOO_SMALL, run_to_completion(client, env, &slices));
+
+	/* The environment is still usable */
+	append(client, env, "return 7");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+	LONGS_EQUAL(7, integer_result());
+}
+
+TEST(LuaProviderTests, clonesCopyNestedTables)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t template_env = create_env(client);
+	int32_t env_a = -1;
+	int32_t env_b = -1;
+	unsigned int slices = 0;
+
+	append(client, template_env, "config = { limit = 1, nested = { x = 1 } }");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, template_env, &slices));
+
+	LONGS_EQUAL(LUA_SUCCESS, env_clone(&client->lua_client, template_env, &env_a));
+	LONGS_EQUAL(LUA_SUCCESS, env_clone(&client->lua_client, template_env, &env_b));
+
+	append(client, env_a, "config.nested.x = 5 return config.nested.x");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env_a, &slices));
+	LONGS_EQUAL(5, integer_result());
+
+	/* The change stays in the clone that made it */
+	append(client, env_b, "return config.nested.x");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env_b, &slices));
+	LONGS_EQUAL(1, integer_result());
+
+	append(client, env_a, "return config.nested.x + config.limit");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env_a, &slices));
+	LONGS_EQUAL(6, integer_result());
+}
+
+TEST(LuaProviderTests, clonesShareGlobalsTheTemplateDoesNotDefine)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t template_env = create_env(client);
+	int32_t env = -1;
+	int32_t nested_env = -1;
+	unsigned int slices = 0;
+
+	/* The functions see the template's environment */
+	append(client, template_env,
+	       "function template_string() return string end "
+	       "function template_g() return _G end");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, template_env, &slices));
+
+	LONGS_EQUAL(LUA_SUCCESS, env_clone(&client->lua_client, template_env, &env));
+
+	append(client, env,
+	       "return string == template_string() and _G == template_g() "
+	       "and rawget(_ENV, 'string') == nil and rawget(_ENV, '_G') == nil");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, env, &slices));
+	CHECK_TRUE(boolean_result());
+
+	/* The same holds for a clone of a clone */
+	LONGS_EQUAL(LUA_SUCCESS, env_clone(&client->lua_client, env, &nested_env));
+
+	append(client, nested_env, "return string == template_string() and _G == template_g()");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(client, nested_env, &slices));
+	CHECK_TRUE(boolean_result());
+}
+
+TEST(LuaProviderTests, staleHandleIsRejected)
+{
+	struct test_client *client = &m_clients[0];
+	int32_t env = create_env(client);
+
+	LONGS_EQUAL(LUA_SUCCESS, env_delete(&client->lua_client, env));
+
+	/* The new environment reuses the slot, but not the handle */
+	int32_t new_env = create_env(client);
+	CHECK_TRUE(new_env >= 0);
+	CHECK_TRUE(new_env != env);
+
+	LONGS_EQUAL(LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST,
+		    env_append(&client->lua_client, env, (const uint8_t *)"return 1", 8));
+	LONGS_EQUAL(LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST, env_delete(&client->lua_client, env));
+	LONGS_EQUAL(LUA_SUCCESS, env_delete(&client->lua_client, new_env));
+}
+
+TEST(LuaProviderTests, environmentsBelongToTheirCreator)
+{
+	struct test_client *owner = &m_clients[0];
+	struct test_client *other = &m_clients[1];
+	int32_t env = create_env(owner);
+	unsigned int slices = 0;
+
+	LONGS_EQUAL(LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST,
+		    env_append(&other->lua_client, env, (const uint8_t *)"return 1", 8));
+	LONGS_EQUAL(LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST,
+		    env_execute(&other->lua_client, env, NULL, 0, sizeof(m_payload), m_payload,
+				&m_payload_len));
+	LONGS_EQUAL(LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST, env_delete(&other->lua_client, env));
+
+	append(owner, env, "return 1");
+	LONGS_EQUAL(LUA_SUCCESS, run_to_completion(owner, env, &slices));
+	LONGS_EQUAL(1, integer_result());
+}
+
+TEST(LuaProviderTests, callerEnvironmentQuota)
+{
+	struct test_client *client = &m_clients[0];
+	std::vector<int32_t> envs;
+	int32_t env = -1;
+
+	for (unsigned int i = 0; i < LUA_CALLER_MAX_ENV_COUNT; i++)
+		envs.push_back(create_env(client));
+
+	LONGS_EQUAL(LUA_ERROR_QUOTA_EXCEEDED, env_create(&client->lua_client, &env));
+	LONGS_EQUAL(LUA_ERROR_QUOTA_EXCEEDED, env_clone(&client->lua_client, envs[0], &env));
+
+	/* Deleting an environment returns it to the quota */
+	LONGS_EQUAL(LUA_SUCCESS, env_delete(&client->lua_client, envs.back()));
+	envs.pop_back();
+	create_env(client);
+}
+
+TEST(LuaProviderTests, envRunReturnsResults)
+{
+	struct test_client *client = &m_clients[0];
+	const char *script = "return 6 * 7";
+
+	LONGS_EQUAL(LUA_SUCCESS, env_run(&client->lua_client, (const uint8_t *)script,
+					 strlen(script), 0, sizeof(m_payload), m_payload,
+					 &m_payload_len));
+	LONGS_EQUAL(42, integer_result());
+}
+
+TEST(LuaProviderTests, envRunFailsWhenBudgetIsExhausted)
+{
+	struct test_client *client = &m_clients[0];
+	const char *endless = "while true do end";
+	const char *script = "return 'done'";
+
+	LONGS_EQUAL(LUA_ERROR_BUDGET_EXCEEDED,
+		    env_run(&client->lua_client, (const uint8_t *)endless, strlen(endless), 0,
+			    sizeof(m_payload), m_payload, &m_payload_len));
+
+	/* The temporary environment is gone, so the caller can run the next script */
+	LONGS_EQUAL(LUA_SUCCESS, env_run(&client->lua_client, (const uint8_t *)script,
+					 strlen(script), 0, sizeof(m_payload), m_payload,
+					 &m_payload_len));
+	STRCMP_EQUAL("done", string_result().c_str());
+}
+
+TEST(LuaProviderTests, envRunReportsSyntaxErrors)
+{
+	struct test_client *client = &m_clients[0];
+	const char *script = "return (";
+
+	LONGS_EQUAL(LUA_ERROR_PARSER_ERROR,
+		    env_run(&client->lua_client, (const uint8_t *)script, strlen(script), 0,
+			    sizeof(m_payload), m_payload, &m_payload_len));
+
+	/* The payload holds the error message */
+	CHECK_TRUE(m_payload_len > 0);
+}
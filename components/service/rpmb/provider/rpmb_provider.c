@@ -124,5 +124,5 @@ struct rpc_service_interface *rpmb_provider_init(struct rpmb_provider *context,
 
 void rpmb_provider_deinit(struct rpmb_provider *context)
 {
-	(void)context;
+	service_provider_deinit(&context->base_provider);
 }
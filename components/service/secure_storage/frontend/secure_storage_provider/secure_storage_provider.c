@@ -207,5 +207,5 @@ struct rpc_service_interface *secure_storage_provider_init(struct secure_storage
 
 void secure_storage_provider_deinit(struct secure_storage_provider *context)
 {
-	(void)context;
+	service_provider_deinit(&context->base_provider);
 }
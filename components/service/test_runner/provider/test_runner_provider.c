@@ -50,7 +50,7 @@ struct rpc_service_interface *test_runner_provider_init(struct test_runner_provi
 
 void test_runner_provider_deinit(struct test_runner_provider *context)
 {
-	(void)context;
+	service_provider_deinit(&context->base_provider);
 }
 
 void test_runner_provider_register_serializer(
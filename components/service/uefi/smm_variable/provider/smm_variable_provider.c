@@ -57,6 +57,7 @@ struct rpc_service_interface *smm_variable_provider_init(struct smm_variable_pro
 void smm_variable_provider_deinit(struct smm_variable_provider *context)
 {
 	uefi_variable_store_deinit(&context->variable_store);
+	service_provider_deinit(&context->base_provider);
 }
 
 static efi_status_t sanitize_access_variable_param(struct rpc_request *req, size_t *param_len)
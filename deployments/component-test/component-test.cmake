@@ -1,5 +1,5 @@
 #-------------------------------------------------------------------------------
-# Copyright (c) 2020-2024, Arm Limited and Contributors. All rights reserved.
+# Copyright (c) 2020-2025, Arm Limited and Contributors. All rights reserved.
 #
 # SPDX-License-Identifier: BSD-3-Clause
 #
@@ -56,6 +56,7 @@ add_components(
 		"components/service/common/provider/test"
 		"components/service/locator"
 		"components/service/locator/interface"
+		"components/service/locator/session_pool"
 		"components/service/locator/test"
 		"components/service/locator/standalone"
 		"components/service/locator/standalone/services/crypto"
@@ -67,6 +68,7 @@ add_components(
 		"components/service/locator/standalone/services/fwu"
 		"components/service/locator/standalone/services/rpmb"
 		"components/service/locator/standalone/services/smm-variable"
+		"components/service/locator/standalone/services/lua"
 		"components/service/attestation/include"
 		"components/service/attestation/claims"
 		"components/service/attestation/claims/sources/boot_seed_generator"
@@ -203,6 +205,12 @@ add_components(
 		"components/service/test_runner/provider/serializer/packed-c"
 		"components/service/test_runner/provider/backend/null"
 		"components/service/uefi/smm_variable/provider"
+		"components/service/lua/provider"
+		"components/service/lua/provider/serializer/packed-c"
+		"components/service/lua/provider/test"
+		"components/service/lua/client"
+		"components/service/lua/client/results"
+		"components/service/lua/bindings/bench"
 		"components/service/uefi/smm_variable/backend"
 		"components/service/uefi/smm_variable/backend/test"
 		"components/media/disk"
@@ -257,10 +265,18 @@ target_compile_definitions(component-test PRIVATE
 include(${TS_ROOT}/external/qcbor/qcbor.cmake)
 target_link_libraries(component-test PRIVATE qcbor)
 
+# Lua
+include(${TS_ROOT}/external/lua/lua.cmake)
+target_link_libraries(component-test PRIVATE lua_static)
+
 # t_cose
 include(${TS_ROOT}/external/t_cose/t_cose.cmake)
 target_link_libraries(component-test PRIVATE t_cose)
 
+# Threads for the service session pool
+find_package(Threads REQUIRED)
+target_link_libraries(component-test PRIVATE Threads::Threads)
+
 #-------------------------------------------------------------------------------
 #  Define install content.
 #
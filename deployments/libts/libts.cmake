@@ -42,8 +42,16 @@ add_components(
 		"components/rpc/common/interface"
 		"components/service/locator"
 		"components/service/locator/interface"
+		"components/service/locator/session_pool"
 )
 
+#-------------------------------------------------------------------------------
+#  The service session pool is shared between the threads of a client
+#
+#-------------------------------------------------------------------------------
+find_package(Threads REQUIRED)
+target_link_libraries(ts PRIVATE Threads::Threads)
+
 #-------------------------------------------------------------------------------
 #  Define public interfaces for library
 #
@@ -0,0 +1,62 @@
+#-------------------------------------------------------------------------------
+# Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+#-------------------------------------------------------------------------------
+
+#-------------------------------------------------------------------------------
+#  The base build file shared between deployments of 'lua-bench' for
+#  different environments.  Measures the latency and throughput of the Lua
+#  service running in a remote processing environment.
+#-------------------------------------------------------------------------------
+
+#-------------------------------------------------------------------------------
+#  Use libts for locating and accessing services. An appropriate version of
+#  libts will be imported for the environment in which tests are
+#  deployed.
+#-------------------------------------------------------------------------------
+if (COVERAGE)
+	set(LIBTS_BUILD_TYPE "DEBUGCOVERAGE" CACHE STRING "Libts build type" FORCE)
+endif()
+
+include(${TS_ROOT}/deployments/libts/libts-import.cmake)
+target_link_libraries(lua-bench PRIVATE libts::ts)
+
+#-------------------------------------------------------------------------------
+#  The throughput test runs the client from several threads
+#
+#-------------------------------------------------------------------------------
+find_package(Threads REQUIRED)
+target_link_libraries(lua-bench PRIVATE Threads::Threads)
+
+#-------------------------------------------------------------------------------
+#  Common main for all deployments
+#
+#-------------------------------------------------------------------------------
+target_sources(lua-bench PRIVATE
+	"${CMAKE_CURRENT_LIST_DIR}/lua-bench.cpp"
+)
+
+#-------------------------------------------------------------------------------
+#  Components that are common across all deployments
+#
+#-------------------------------------------------------------------------------
+add_components(
+	TARGET "lua-bench"
+	BASE_DIR ${TS_ROOT}
+	COMPONENTS
+		"components/common/tlv"
+		"components/service/common/include"
+		"components/service/common/client"
+		"components/service/lua/client"
+)
+
+#-------------------------------------------------------------------------------
+#  Define install content.
+#
+#-------------------------------------------------------------------------------
+if (CMAKE_INSTALL_PREFIX_INITIALIZED_TO_DEFAULT)
+	set(CMAKE_INSTALL_PREFIX ${CMAKE_BINARY_DIR}/install CACHE PATH "location to install build output to." FORCE)
+endif()
+install(TARGETS lua-bench RUNTIME DESTINATION ${TS_ENV}/bin)
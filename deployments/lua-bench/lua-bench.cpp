@@ -0,0 +1,482 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "service/lua/client/lua_client.h"
+#include "protocols/service/lua/status.h"
+#include "service_locator.h"
+
+/*
+ * Benchmark client for the Lua service. The latency sweep times every create, append,
+ * execute and delete call for each combination of script size, append chunk size and
+ * number of live environments. The throughput test runs complete scripts from several
+ * threads, each with its own RPC session. Results are written to stdout as JSON or CSV.
+ */
+
+using bench_clock = std::chrono::steady_clock;
+
+struct bench_options {
+	std::vector<size_t> script_sizes { 128, 1024, 8192 };
+	std::vector<size_t> chunk_sizes { 64, 512, 4096 };
+	std::vector<size_t> env_counts { 1, 8, 32 };
+	std::vector<size_t> thread_counts { 1, 2, 4 };
+	size_t iterations = 10;
+	size_t throughput_script_size = 1024;
+	double duration_s = 2.0;
+	bool csv = false;
+};
+
+struct latency_stats {
+	size_t count;
+	double min_us;
+	double mean_us;
+	double p50_us;
+	double p99_us;
+	double max_us;
+};
+
+static std::vector<size_t> parse_list(const char *arg)
+{
+	std::vector<size_t> values;
+	std::stringstream ss(arg);
+	std::string item;
+
+	while (std::getline(ss, item, ',')) {
+		size_t value = std::strtoul(item.c_str(), NULL, 0);
+
+		if (value)
+			values.push_back(value);
+	}
+
+	return values;
+}
+
+static void print_usage(const char *name)
+{
+	std::cerr << "Usage: " << name << " [options]\n"
+		  << "  --script-sizes LIST   script sizes in bytes (128,1024,8192)\n"
+		  << "  --chunk-sizes LIST    append chunk sizes in bytes (64,512,4096)\n"
+		  << "  --env-counts LIST     number of live environments (1,8,32)\n"
+		  << "  --iterations N        repetitions per combination (10)\n"
+		  << "  --threads LIST        thread counts of the throughput test (1,2,4)\n"
+		  << "  --throughput-size N   script size of the throughput test (1024)\n"
+		  << "  --duration SECONDS    duration of each throughput run (2)\n"
+		  << "  --format json|csv     output format (json)\n";
+}
+
+static bool parse_options(int argc, char *argv[], struct bench_options *options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string opt = argv[i];
+
+		if (opt == "--help" || i + 1 >= argc)
+			return false;
+
+		const char *value = argv[++i];
+
+		if (opt == "--script-sizes")
+			options->script_sizes = parse_list(value);
+		else if (opt == "--chunk-sizes")
+			options->chunk_sizes = parse_list(value);
+		else if (opt == "--env-counts")
+			options->env_counts = parse_list(value);
+		else if (opt == "--threads")
+			options->thread_counts = parse_list(value);
+		else if (opt == "--iterations")
+			options->iterations = std::strtoul(value, NULL, 0);
+		else if (opt == "--throughput-size")
+			options->throughput_script_size = std::strtoul(value, NULL, 0);
+		else if (opt == "--duration")
+			options->duration_s = std::strtod(value, NULL);
+		else if (opt == "--format" && (!std::strcmp(value, "json") ||
+					       !std::strcmp(value, "csv")))
+			options->csv = !std::strcmp(value, "csv");
+		else
+			return false;
+	}
+
+	return !options->script_sizes.empty() && !options->chunk_sizes.empty() &&
+	       !options->env_counts.empty() && !options->thread_counts.empty() &&
+	       options->iterations && options->throughput_script_size &&
+	       options->duration_s > 0;
+}
+
+/* A script of exactly size bytes that does some arithmetic and returns the result */
+static std::string make_script(size_t size)
+{
+	const std::string head = "local x = 0\n";
+	const std::string step = "x = x + 1\n";
+	const std::string tail = "return x\n";
+	std::string script = head;
+
+	while (script.size() + step.size() + tail.size() <= size)
+		script += step;
+
+	/* Pad with a comment, or newlines if there is no room for one */
+	if (script.size() + tail.size() < size) {
+		size_t pad = size - script.size() - tail.size();
+
+		if (pad >= 3)
+			script += "--" + std::string(pad - 3, '-') + "\n";
+		else
+			script += std::string(pad, '\n');
+	}
+
+	return script + tail;
+}
+
+static double elapsed_us(bench_clock::time_point start)
+{
+	return std::chrono::duration<double, std::micro>(bench_clock::now() - start).count();
+}
+
+static latency_stats get_stats(std::vector<double> &samples)
+{
+	latency_stats stats = { };
+
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+
+	double sum = 0;
+	for (double sample : samples)
+		sum += sample;
+
+	stats.count = samples.size();
+	stats.min_us = samples.front();
+	stats.max_us = samples.back();
+	stats.mean_us = sum / samples.size();
+	stats.p50_us = samples[(samples.size() - 1) / 2];
+	stats.p99_us = samples[(samples.size() - 1) * 99 / 100];
+
+	return stats;
+}
+
+class bench_output {
+public:
+	bench_output(bool csv) :
+		m_csv(csv),
+		m_first(true)
+	{
+		if (m_csv)
+			std::cout << "test,op,script_size,chunk_size,env_count,threads,count,"
+				     "min_us,mean_us,p50_us,p99_us,max_us,seconds,scripts_per_sec" <<
+				     std::endl;
+		else
+			std::cout << "[" << std::endl;
+	}
+
+	~bench_output()
+	{
+		if (!m_csv)
+			std::cout << std::endl << "]" << std::endl;
+	}
+
+	void latency(const char *op, size_t script_size, size_t chunk_size, size_t env_count,
+		     const latency_stats &stats)
+	{
+		if (m_csv) {
+			std::cout << "latency," << op << "," << script_size << "," << chunk_size <<
+				     "," << env_count << ",1," << stats.count << "," <<
+				     stats.min_us << "," << stats.mean_us << "," << stats.p50_us <<
+				     "," << stats.p99_us << "," << stats.max_us << ",," << std::endl;
+			return;
+		}
+
+		begin_record();
+		std::cout << "{\"test\": \"latency\", \"op\": \"" << op << "\", \"script_size\": " <<
+			     script_size << ", \"chunk_size\": " << chunk_size <<
+			     ", \"env_count\": " << env_count << ", \"count\": " << stats.count <<
+			     ", \"min_us\": " << stats.min_us << ", \"mean_us\": " << stats.mean_us <<
+			     ", \"p50_us\": " << stats.p50_us << ", \"p99_us\": " << stats.p99_us <<
+			     ", \"max_us\": " << stats.max_us << "}";
+	}
+
+	void throughput(size_t script_size, size_t threads, size_t scripts, double seconds)
+	{
+		double rate = scripts / seconds;
+
+		if (m_csv) {
+			std::cout << "throughput,script," << script_size << ",,," << threads << "," <<
+				     scripts << ",,,,,," << seconds << "," << rate << std::endl;
+			return;
+		}
+
+		begin_record();
+		std::cout << "{\"test\": \"throughput\", \"script_size\": " << script_size <<
+			     ", \"threads\": " << threads << ", \"count\": " << scripts <<
+			     ", \"seconds\": " << seconds << ", \"scripts_per_sec\": " << rate << "}";
+	}
+
+private:
+	void begin_record()
+	{
+		if (!m_first)
+			std::cout << "," << std::endl;
+		std::cout << "  ";
+		m_first = false;
+	}
+
+	bool m_csv;
+	bool m_first;
+};
+
+static void log_error(const char *op, lua_status_t status)
+{
+	std::cerr << op << " failed (status=" << status << ")" << std::endl;
+}
+
+/* Run the environment's script to completion, resuming it while it is suspended */
+static lua_status_t execute_script(struct lua_client *client, int32_t env)
+{
+	uint8_t payload_buf[256];
+	size_t payload_len = 0;
+	lua_status_t status = env_execute(client, env, NULL, 0, sizeof(payload_buf),
+					  payload_buf, &payload_len);
+
+	while (status == LUA_IN_PROGRESS)
+		status = env_resume(client, env, NULL, 0, sizeof(payload_buf),
+				    payload_buf, &payload_len);
+
+	return status;
+}
+
+static lua_status_t append_script(struct lua_client *client, int32_t env,
+				  const std::string &script, size_t chunk_size,
+				  std::vector<double> *samples)
+{
+	const uint8_t *data = reinterpret_cast<const uint8_t *>(script.data());
+
+	for (size_t pos = 0; pos < script.size(); pos += chunk_size) {
+		size_t len = std::min(chunk_size, script.size() - pos);
+		bench_clock::time_point start = bench_clock::now();
+		lua_status_t status = env_append(client, env, data + pos, len);
+
+		if (samples)
+			samples->push_back(elapsed_us(start));
+
+		if (status != LUA_SUCCESS)
+			return status;
+	}
+
+	return LUA_SUCCESS;
+}
+
+/*
+ * Time each call of the script life cycle with env_count environments alive. Scripts are
+ * executed right after they are appended so that only one script buffer is charged to the
+ * caller's quota at a time.
+ */
+static bool run_latency(struct lua_client *client, const struct bench_options &options,
+			size_t script_size, size_t chunk_size, size_t env_count,
+			bench_output &output)
+{
+	const std::string script = make_script(script_size);
+	std::vector<double> create, append, execute, del;
+	std::vector<int32_t> envs;
+	lua_status_t status = LUA_SUCCESS;
+
+	for (size_t iter = 0; iter < options.iterations && status == LUA_SUCCESS; iter++) {
+		for (size_t i = 0; i < env_count; i++) {
+			int32_t env = -1;
+			bench_clock::time_point start = bench_clock::now();
+
+			status = env_create(client, &env);
+			create.push_back(elapsed_us(start));
+			if (status != LUA_SUCCESS) {
+				log_error("env_create", status);
+				break;
+			}
+
+			envs.push_back(env);
+		}
+
+		for (size_t i = 0; i < envs.size() && status == LUA_SUCCESS; i++) {
+			status = append_script(client, envs[i], script, chunk_size, &append);
+			if (status != LUA_SUCCESS) {
+				log_error("env_append", status);
+				break;
+			}
+
+			bench_clock::time_point start = bench_clock::now();
+
+			status = execute_script(client, envs[i]);
+			execute.push_back(elapsed_us(start));
+			if (status != LUA_SUCCESS)
+				log_error("env_execute", status);
+		}
+
+		/* Delete whatever was created even if the iteration failed */
+		for (int32_t env : envs) {
+			bench_clock::time_point start = bench_clock::now();
+			lua_status_t delete_status = env_delete(client, env);
+
+			del.push_back(elapsed_us(start));
+			if (delete_status != LUA_SUCCESS) {
+				log_error("env_delete", delete_status);
+				status = delete_status;
+			}
+		}
+
+		envs.clear();
+	}
+
+	output.latency("create", script_size, chunk_size, env_count, get_stats(create));
+	output.latency("append", script_size, chunk_size, env_count, get_stats(append));
+	output.latency("execute", script_size, chunk_size, env_count, get_stats(execute));
+	output.latency("delete", script_size, chunk_size, env_count, get_stats(del));
+
+	return status == LUA_SUCCESS;
+}
+
+/* Run complete scripts in a loop until the deadline, returns the number of scripts run */
+static size_t run_scripts(struct lua_client *client, const std::string &script,
+			  bench_clock::time_point deadline, std::atomic<bool> *failed)
+{
+	size_t count = 0;
+
+	while (bench_clock::now() < deadline && !failed->load()) {
+		int32_t env = -1;
+		lua_status_t status = env_create(client, &env);
+
+		if (status != LUA_SUCCESS) {
+			log_error("env_create", status);
+			failed->store(true);
+			break;
+		}
+
+		status = append_script(client, env, script, script.size(), NULL);
+		if (status == LUA_SUCCESS)
+			status = execute_script(client, env);
+
+		lua_status_t delete_status = env_delete(client, env);
+
+		if (status != LUA_SUCCESS || delete_status != LUA_SUCCESS) {
+			log_error("script", status != LUA_SUCCESS ? status : delete_status);
+			failed->store(true);
+			break;
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
+static bool run_throughput(struct service_context *service_context,
+			   const struct bench_options &options, size_t thread_count,
+			   bench_output &output)
+{
+	const std::string script = make_script(options.throughput_script_size);
+	std::vector<struct rpc_caller_session *> sessions;
+	std::vector<struct lua_client> clients(thread_count);
+	std::vector<size_t> counts(thread_count, 0);
+	std::vector<std::thread> threads;
+	std::atomic<bool> failed(false);
+
+	/* Sessions are opened up front so that the threads only measure Lua calls */
+	for (size_t i = 0; i < thread_count; i++) {
+		struct rpc_caller_session *session = service_context_open(service_context);
+
+		if (!session) {
+			std::cerr << "Failed to open RPC session " << i << std::endl;
+			failed.store(true);
+			break;
+		}
+
+		sessions.push_back(session);
+		lua_client_init(&clients[i], session);
+	}
+
+	bench_clock::time_point start = bench_clock::now();
+	bench_clock::time_point deadline = start + std::chrono::duration_cast<bench_clock::duration>(
+		std::chrono::duration<double>(options.duration_s));
+
+	for (size_t i = 0; i < sessions.size() && !failed.load(); i++)
+		threads.emplace_back([&, i]() {
+			counts[i] = run_scripts(&clients[i], script, deadline, &failed);
+		});
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	double seconds = elapsed_us(start) / 1e6;
+	size_t total = 0;
+
+	for (size_t count : counts)
+		total += count;
+
+	for (size_t i = 0; i < sessions.size(); i++) {
+		lua_client_deinit(&clients[i]);
+		service_context_close(service_context, sessions[i]);
+	}
+
+	if (!failed.load())
+		output.throughput(options.throughput_script_size, thread_count, total, seconds);
+
+	return !failed.load();
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_options options;
+
+	if (!parse_options(argc, argv, &options)) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	service_locator_init();
+
+	struct service_context *service_context = service_locator_query("sn:trustedfirmware.org:lua:0");
+	if (!service_context) {
+		std::cerr << "Failed to locate Lua service." << std::endl;
+		return 1;
+	}
+
+	struct rpc_caller_session *session = service_context_open(service_context);
+	if (!session) {
+		std::cerr << "Failed to open RPC session to Lua service." << std::endl;
+		service_context_relinquish(service_context);
+		return 1;
+	}
+
+	struct lua_client client;
+	lua_client_init(&client, session);
+
+	bool success = true;
+
+	{
+		bench_output output(options.csv);
+
+		for (size_t script_size : options.script_sizes)
+			for (size_t chunk_size : options.chunk_sizes)
+				for (size_t env_count : options.env_counts)
+					success &= run_latency(&client, options, script_size,
+							       chunk_size, env_count, output);
+
+		lua_client_deinit(&client);
+		service_context_close(service_context, session);
+
+		for (size_t thread_count : options.thread_counts)
+			success &= run_throughput(service_context, options, thread_count, output);
+	}
+
+	service_context_relinquish(service_context);
+
+	return success ? 0 : 1;
+}
@@ -23,6 +23,20 @@ endif()
 include(${TS_ROOT}/deployments/libts/libts-import.cmake)
 target_link_libraries(lua-demo PRIVATE libts::ts)
 
+#-------------------------------------------------------------------------------
+#  Lua library for compiling scripts to bytecode on the host
+#
+#-------------------------------------------------------------------------------
+include(${TS_ROOT}/external/lua/lua.cmake)
+target_link_libraries(lua-demo PRIVATE lua_static)
+
+#-------------------------------------------------------------------------------
+#  QCBOR for decoding the values returned by scripts
+#
+#-------------------------------------------------------------------------------
+include(${TS_ROOT}/external/qcbor/qcbor.cmake)
+target_link_libraries(lua-demo PRIVATE qcbor)
+
 #-------------------------------------------------------------------------------
 #  Common main for all deployments
 #
@@ -43,6 +57,8 @@ add_components(
 		"components/service/common/include"
 		"components/service/common/client"
 		"components/service/lua/client"
+		"components/service/lua/client/compiler"
+		"components/service/lua/client/results"
 )
 
 #-------------------------------------------------------------------------------
@@ -6,22 +6,142 @@
 
 #include <iostream>
 #include <string>
+#include <cstdlib>
 #include <cstring>
 
 #include "service/lua/client/lua_client.h"
+#include "service/lua/client/compiler/lua_compiler.h"
+#include "service/lua/client/results/lua_results.h"
 #include "protocols/service/lua/status.h"
 #include "service_locator.h"
 
 
-static void run_lua_test(struct lua_client *client, const char *script, const char *test_name)
+static void log_result(const char *test_name, const std::string &operation, int status,
+		       const std::string &msg = "")
+{
+	std::ostream &os = (status == LUA_SUCCESS ? std::cout : std::cerr);
+	os << "[" << test_name << "]" << operation << (status == LUA_SUCCESS ? " succeeded" : " failed") <<
+		  " (status=" << status << ")";
+	if (!msg.empty()) os << ": " << msg;
+	os << std::endl;
+}
+
+/* Print the values returned by a script, table entries are indented below their table */
+static void print_results(const uint8_t *payload, size_t payload_len, const char *test_name)
+{
+	struct lua_results results;
+	struct lua_result result;
+	size_t count = 0;
+
+	lua_status_t status = lua_results_init(&results, payload, payload_len, &count);
+	if (status != LUA_SUCCESS) {
+		log_result(test_name, "lua_results_init", status);
+		return;
+	}
+
+	while (lua_results_next(&results, &result)) {
+		std::cout << "[" << test_name << "] " << std::string(2 * result.depth, ' ');
+
+		if (result.key_type == LUA_RESULT_INTEGER)
+			std::cout << "[" << result.key.integer << "] = ";
+		else if (result.key_type == LUA_RESULT_STRING)
+			std::cout << std::string(reinterpret_cast<const char *>(result.key.string.data),
+						 result.key.string.len) << " = ";
+
+		switch (result.type) {
+		case LUA_RESULT_NIL:
+			std::cout << "nil";
+			break;
+		case LUA_RESULT_BOOLEAN:
+			std::cout << (result.value.boolean ? "true" : "false");
+			break;
+		case LUA_RESULT_INTEGER:
+			std::cout << result.value.integer;
+			break;
+		case LUA_RESULT_NUMBER:
+			std::cout << result.value.number;
+			break;
+		case LUA_RESULT_STRING:
+			std::cout << '"' << std::string(reinterpret_cast<const char *>(
+						result.value.string.data), result.value.string.len) << '"';
+			break;
+		case LUA_RESULT_ARRAY:
+			std::cout << "array of " << result.value.count;
+			break;
+		case LUA_RESULT_MAP:
+			std::cout << "map of " << result.value.count;
+			break;
+		}
+
+		std::cout << std::endl;
+	}
+
+	status = lua_results_finish(&results);
+	if (status != LUA_SUCCESS)
+		log_result(test_name, "lua_results_finish", status);
+}
+
+/* Log the outcome of running a script, the payload is the results or the error message */
+static void log_execution(const char *test_name, const std::string &operation,
+			  lua_status_t status, const uint8_t *payload, size_t payload_len)
+{
+	if (status == LUA_SUCCESS) {
+		log_result(test_name, operation, status);
+		print_results(payload, payload_len, test_name);
+	} else {
+		log_result(test_name, operation, status,
+			   std::string(reinterpret_cast<const char *>(payload), payload_len));
+	}
+}
+
+/*
+ * Execute the environment's script, resuming it until it is no longer suspended. The input
+ * is sent with every slice as the script can only access it during a request.
+ */
+static lua_status_t execute_script(struct lua_client *client, int32_t env, const uint8_t *input,
+				   size_t input_len, uint8_t *payload_buf,
+				   size_t payload_buf_size, size_t *payload_len)
+{
+	lua_status_t status = env_execute(client, env, input, input_len, payload_buf_size,
+					  payload_buf, payload_len);
+
+	while (status == LUA_IN_PROGRESS)
+		status = env_resume(client, env, input, input_len, payload_buf_size, payload_buf,
+				    payload_len);
+
+	return status;
+}
+
+/* Print the output captured from the environment's scripts */
+static void print_output(struct lua_client *client, int32_t env, const char *test_name)
+{
+	uint8_t out_buf[256];
+	size_t out_len = 0;
+	size_t remaining_len = 0;
+	size_t lost_len = 0;
+
+	do {
+		lua_status_t status = env_read_output(client, env, sizeof(out_buf), out_buf, &out_len,
+						      &remaining_len, &lost_len);
+		if (status != LUA_SUCCESS) {
+			log_result(test_name, "env_read_output", status);
+			return;
+		}
+
+		if (lost_len)
+			std::cout << "[" << test_name << "] " << lost_len << " bytes of output lost" <<
+				     std::endl;
+
+		std::cout.write(reinterpret_cast<char *>(out_buf), out_len);
+	} while (remaining_len);
+}
+
+static void run_lua_test(struct lua_client *client, const char *script, const char *test_name,
+			 const uint8_t *input = NULL, size_t input_len = 0)
 {
 	auto log = [test_name](const std::string &operation, int status, const std::string &msg = "")
 	{
-		std::ostream &os = (status == LUA_SUCCESS ? std::cout : std::cerr);
-		os << "[" << test_name << "]" << operation << (status == LUA_SUCCESS ? " succeeded" : " failed") <<
-			  " (status=" << status << ")";
-		if (!msg.empty()) os << ": " << msg;
-		os << std::endl;
+		log_result(test_name, operation, status, msg);
 	};
 
 	int32_t env = -1;
@@ -33,11 +153,165 @@ static void run_lua_test(struct lua_client *client, const char *script, const ch
 						std::strlen(script));
 	log("env_append", status);
 
-	uint8_t err_buf[512];
-	size_t err_len = 0;
-	status = env_execute(client, env, sizeof(err_buf), err_buf, &err_len);
-	std::string msg(reinterpret_cast<char *>(err_buf), err_len);
-	log("env_execute", status, msg);
+	uint8_t payload_buf[512];
+	size_t payload_len = 0;
+	status = execute_script(client, env, input, input_len, payload_buf, sizeof(payload_buf),
+				&payload_len);
+	log_execution(test_name, "env_execute", status, payload_buf, payload_len);
+	print_output(client, env, test_name);
+
+	status = env_delete(client, env);
+	log("env_delete", status);
+}
+
+static void run_lua_bytecode_test(struct lua_client *client, const char *script,
+				  const char *test_name)
+{
+	auto log = [test_name](const std::string &operation, int status, const std::string &msg = "")
+	{
+		log_result(test_name, operation, status, msg);
+	};
+
+	/* Compile on the host so the SP doesn't have to parse the script */
+	uint8_t *bytecode = NULL;
+	size_t bytecode_len = 0;
+	char compile_err[512] = { 0 };
+	lua_status_t status = lua_compile_script(script, std::strlen(script), true, &bytecode,
+						 &bytecode_len, sizeof(compile_err), compile_err);
+	log("lua_compile_script", status, compile_err);
+	if (status != LUA_SUCCESS)
+		return;
+
+	int32_t env = -1;
+	status = env_create(client, &env);
+	log("env_create", status);
+
+	status = env_append_bytecode(client, env, bytecode, bytecode_len);
+	log("env_append_bytecode", status);
+	free(bytecode);
+
+	/* Providers only accept bytecode when built with LUA_BYTECODE_ENABLED */
+	if (status == LUA_ERROR_INVALID_BYTECODE) {
+		std::cout << "[" << test_name << "] bytecode is disabled in the provider" <<
+			     std::endl;
+		log("env_delete", env_delete(client, env));
+		return;
+	}
+
+	uint8_t payload_buf[512];
+	size_t payload_len = 0;
+	status = execute_script(client, env, NULL, 0, payload_buf, sizeof(payload_buf),
+				&payload_len);
+	log_execution(test_name, "env_execute", status, payload_buf, payload_len);
+	print_output(client, env, test_name);
+
+	status = env_delete(client, env);
+	log("env_delete", status);
+}
+
+static void run_lua_single_call_test(struct lua_client *client, const char *script,
+				     const char *test_name)
+{
+	uint8_t payload_buf[512];
+	size_t payload_len = 0;
+	lua_status_t status = env_run(client, reinterpret_cast<const uint8_t *>(script),
+				      std::strlen(script), 0, sizeof(payload_buf), payload_buf,
+				      &payload_len);
+	log_execution(test_name, "env_run", status, payload_buf, payload_len);
+}
+
+/*
+ * Run the prelude once in a template environment and the scripts in clones of it, which
+ * don't have to parse and execute the prelude again.
+ */
+static void run_lua_template_test(struct lua_client *client, const char *prelude,
+				  const char *const scripts[], size_t num_scripts,
+				  const char *test_name)
+{
+	auto log = [test_name](const std::string &operation, int status, const std::string &msg = "")
+	{
+		log_result(test_name, operation, status, msg);
+	};
+
+	int32_t template_env = -1;
+	lua_status_t status = env_create(client, &template_env);
+	log("env_create", status);
+
+	status = env_append(client, template_env, reinterpret_cast<const uint8_t *>(prelude),
+			    std::strlen(prelude));
+	log("env_append", status);
+
+	uint8_t payload_buf[512];
+	size_t payload_len = 0;
+	status = execute_script(client, template_env, NULL, 0, payload_buf, sizeof(payload_buf),
+				&payload_len);
+	log_execution(test_name, "prelude", status, payload_buf, payload_len);
+
+	for (size_t i = 0; i < num_scripts; i++) {
+		int32_t env = -1;
+		status = env_clone(client, template_env, &env);
+		log("env_clone", status);
+
+		status = env_append(client, env, reinterpret_cast<const uint8_t *>(scripts[i]),
+				    std::strlen(scripts[i]));
+		log("env_append", status);
+
+		status = execute_script(client, env, NULL, 0, payload_buf, sizeof(payload_buf),
+					&payload_len);
+		log_execution(test_name, "env_execute", status, payload_buf, payload_len);
+		print_output(client, env, test_name);
+
+		status = env_delete(client, env);
+		log("env_delete", status);
+	}
+
+	status = env_delete(client, template_env);
+	log("env_delete", status);
+}
+
+/*
+ * Profile the script and print the profile, sampling every 100 VM instructions, and the
+ * metrics of its environment
+ */
+static void run_lua_profile_test(struct lua_client *client, const char *script,
+				 const char *test_name)
+{
+	auto log = [test_name](const std::string &operation, int status, const std::string &msg = "")
+	{
+		log_result(test_name, operation, status, msg);
+	};
+
+	int32_t env = -1;
+	lua_status_t status = env_create(client, &env);
+	log("env_create", status);
+
+	uint8_t payload_buf[2048];
+	size_t payload_len = 0;
+	status = env_profile_result(client, env, 100, sizeof(payload_buf), payload_buf,
+				    &payload_len);
+	log("env_profile_result", status);
+
+	status = env_append(client, env, reinterpret_cast<const uint8_t *>(script),
+			    std::strlen(script));
+	log("env_append", status);
+
+	status = execute_script(client, env, NULL, 0, payload_buf, sizeof(payload_buf),
+				&payload_len);
+	log_execution(test_name, "env_execute", status, payload_buf, payload_len);
+
+	/* Disables profiling again */
+	status = env_profile_result(client, env, 0, sizeof(payload_buf), payload_buf,
+				    &payload_len);
+	log_execution(test_name, "env_profile_result", status, payload_buf, payload_len);
+
+	struct lua_env_stats stats;
+	status = env_stats(client, env, &stats);
+	log("env_stats", status,
+	    "parse " + std::to_string(stats.parse_ns) + " ns, exec " +
+	    std::to_string(stats.exec_ns) + " ns, " + std::to_string(stats.instructions) +
+	    " instructions, " + std::to_string(stats.bytes_allocated) + " bytes allocated, peak " +
+	    std::to_string(stats.peak_memory) + " bytes, " + std::to_string(stats.gc_cycles) +
+	    " gc cycles, " + std::to_string(stats.slice_count) + " slices");
 
 	status = env_delete(client, env);
 	log("env_delete", status);
@@ -104,6 +378,74 @@ int main()
 	)";
 	run_lua_test(&m_lua_client, test_script_4, "test_script_4");
 
+	/* Test 5: precompiled bytecode */
+	run_lua_bytecode_test(&m_lua_client, test_script_1, "test_script_5");
+
+	/* Test 6: single call run */
+	run_lua_single_call_test(&m_lua_client, test_script_2, "test_script_6");
+
+	/* Test 7: structured results */
+	const char *test_script_7 = R"(
+		local squares = {}
+		for i = 1, 5 do
+			squares[i] = i * i
+		end
+		return "squares", squares, { count = #squares, mean = 11.0, ok = true }
+	)";
+	run_lua_test(&m_lua_client, test_script_7, "test_script_7");
+
+	/* Test 8: binary input read in place */
+	const char *test_script_8 = R"(
+		local input = buffer.request()
+		local sum = 0
+		for i = 1, #input do
+			sum = sum + input[i]
+		end
+		local header = buffer.new(8)
+		header:copy(1, input:sub(1, 4))
+		header:set32(5, sum, true)
+		return #input, sum, input:get32(1), header
+	)";
+	uint8_t input[256];
+	for (size_t i = 0; i < sizeof(input); i++)
+		input[i] = static_cast<uint8_t>(i);
+	run_lua_test(&m_lua_client, test_script_8, "test_script_8", input, sizeof(input));
+
+	/* Test 9: environments cloned from a template */
+	const char *test_prelude_9 = R"(
+		function check(name, cond)
+			print(("%s: %s"):format(name, cond and "pass" or "FAIL"))
+			return cond
+		end
+		limits = { min = 1, max = 100 }
+	)";
+	const char *const test_scripts_9[] = {
+		"return check('in range', 42 >= limits.min and 42 <= limits.max)",
+		"limits = { min = 50, max = 60 } return check('own limits', limits.min == 50)",
+		"return check('template untouched', limits.min == 1)",
+	};
+	run_lua_template_test(&m_lua_client, test_prelude_9, test_scripts_9,
+			      sizeof(test_scripts_9) / sizeof(test_scripts_9[0]), "test_script_9");
+
+	/* Test 10: profiling */
+	const char *test_script_10 = R"(
+		local function fib(n)
+			if n < 2 then
+				return n
+			end
+			return fib(n - 1) + fib(n - 2)
+		end
+		local function squares(n)
+			local sum = 0
+			for i = 1, n do
+				sum = sum + i * i
+			end
+			return sum
+		end
+		return fib(15), squares(2000)
+	)";
+	run_lua_profile_test(&m_lua_client, test_script_10, "test_script_10");
+
 	/* Cleanup */
 	lua_client_deinit(&m_lua_client);
 	service_context_close(m_service_context, m_rpc_session);
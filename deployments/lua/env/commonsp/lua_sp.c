@@ -12,12 +12,45 @@
 
 #include "components/service/lua/provider/lua_provider.h"
 #include "components/service/lua/provider/serializer/packed-c/packedc_lua_serializer.h"
+#include "components/service/lua/bindings/bench/lua_bench_binding.h"
 #include "components/service/log/factory/log_factory.h"
+#include "config/interface/config_store.h"
 #include "config/loader/sp/sp_config_loader.h"
 #include "config/ramstore/config_ramstore.h"
 #include "components/rpc/ts_rpc/endpoint/sp/ts_rpc_endpoint_sp.h"
 
+#ifdef CFG_ENABLE_LUA_BINDINGS
+#include "components/service/lua/bindings/block_store/lua_block_store_binding.h"
+#include "components/service/lua/bindings/psa_crypto/lua_psa_crypto_binding.h"
+#include "components/service/lua/bindings/secure_storage/lua_secure_storage_binding.h"
+#include "service/block_storage/factory/client/block_store_factory.h"
+#include "service/crypto/client/psa/psa_crypto_client.h"
+#include "service/secure_storage/factory/storage_factory.h"
+#include "service_locator.h"
+#include "psa/crypto.h"
+
+static void register_bindings(struct lua_provider *lua_provider);
+#endif
+
+/*
+ * Initial and maximal number of client shared memories the RPC endpoint keeps retrieved. Each
+ * RPC session of a client retrieves its own shared memory, so every open session takes a slot.
+ */
+#ifndef LUA_SP_SHARED_MEMORY_COUNT
+#define LUA_SP_SHARED_MEMORY_COUNT	(16)
+#endif
+
+#ifndef LUA_SP_SHARED_MEMORY_LIMIT
+#define LUA_SP_SHARED_MEMORY_LIMIT	(256)
+#endif
+
+/* Generated by lua.cmake from LUA_PRELOAD_MODULES */
+extern const struct lua_module lua_preload_modules[];
+
 static bool sp_init(uint16_t *own_sp_id);
+static void register_modules(struct lua_provider *lua_provider);
+static void load_gc_params(struct lua_provider *lua_provider);
+static void load_exec_budget(struct lua_provider *lua_provider);
 
 void __noreturn sp_main(union ffa_boot_info *boot_info)
 {
@@ -51,12 +84,31 @@ void __noreturn sp_main(union ffa_boot_info *boot_info)
 	lua_provider_register_serializer(&lua_provider,
 						packedc_lua_serializer_instance());
 
-	rpc_status = ts_rpc_endpoint_sp_init(&rpc_endpoint, 1, 16);
+	load_gc_params(&lua_provider);
+	load_exec_budget(&lua_provider);
+
+	if (!lua_provider_register_binding(&lua_provider, "bench", lua_bench_binding_open, NULL))
+		EMSG("Failed to register Lua bench binding");
+
+#ifdef CFG_ENABLE_LUA_BINDINGS
+	register_bindings(&lua_provider);
+#endif
+
+	register_modules(&lua_provider);
+
+	rpc_status = ts_rpc_endpoint_sp_init(&rpc_endpoint, 1, LUA_SP_SHARED_MEMORY_COUNT);
 	if (rpc_status != RPC_SUCCESS) {
 		EMSG("Failed to initialize RPC endpoint: %d", rpc_status);
 		goto fatal_error;
 	}
 
+	rpc_status = ts_rpc_endpoint_sp_configure_shared_memory(&rpc_endpoint,
+								LUA_SP_SHARED_MEMORY_LIMIT);
+	if (rpc_status != RPC_SUCCESS) {
+		EMSG("Failed to configure RPC endpoint: %d", rpc_status);
+		goto fatal_error;
+	}
+
 	rpc_status = ts_rpc_endpoint_sp_add_service(&rpc_endpoint, lua_iface);
 	if (rpc_status != RPC_SUCCESS) {
 		EMSG("Failed to add service to RPC endpoint: %d", rpc_status);
@@ -73,6 +125,13 @@ void __noreturn sp_main(union ffa_boot_info *boot_info)
 	while (1) {
 		ts_rpc_endpoint_sp_receive(&rpc_endpoint, &req_msg, &resp_msg);
 
+		/*
+		 * The direct response only returns with the next request, so the SP has no idle
+		 * time of its own. Garbage collected here delays the response, which is why the
+		 * step is disabled unless LUA_GC_STEP_KB is set.
+		 */
+		lua_provider_collect_garbage(&lua_provider);
+
 		result = sp_msg_send_direct_resp(&resp_msg, &req_msg);
 		if (result != SP_RESULT_OK) {
 			EMSG("Failed to send direct response %d", result);
@@ -112,6 +171,108 @@ ffa_result ffa_vm_destroyed_handler(uint16_t vm_id, uint64_t handle)
 	return FFA_OK;
 }
 
+static void register_modules(struct lua_provider *lua_provider)
+{
+	for (const struct lua_module *module = lua_preload_modules; module->name; module++) {
+		if (lua_provider_register_module(lua_provider, module))
+			IMSG("Lua module %s registered", module->name);
+		else
+			EMSG("Failed to register Lua module %s", module->name);
+	}
+}
+
+static bool query_parameter(const char *name, uint32_t *value)
+{
+	return config_store_query(CONFIG_CLASSIFIER_PARAMETER, name, 0, value, sizeof(*value));
+}
+
+/*
+ * The build time defaults of the garbage collector can be overridden by the
+ * arm,sp-parameters node of the SP manifest.
+ */
+static void load_gc_params(struct lua_provider *lua_provider)
+{
+	struct lua_gc_params gc_params = lua_provider->gc_params;
+	uint32_t value = 0;
+
+	if (query_parameter("lua-gc-generational", &value))
+		gc_params.generational = (value != 0);
+
+	if (query_parameter("lua-gc-pause", &value))
+		gc_params.pause = (int)value;
+
+	if (query_parameter("lua-gc-stepmul", &value))
+		gc_params.stepmul = (int)value;
+
+	if (query_parameter("lua-gc-step-kb", &value))
+		gc_params.step_kb = (int)value;
+
+	lua_provider_set_gc_params(lua_provider, &gc_params);
+
+	IMSG("Lua GC: %s mode, step %d KiB", gc_params.generational ? "generational" : "incremental",
+	     gc_params.step_kb);
+}
+
+/*
+ * Scripts run to completion unless the arm,sp-parameters node of the SP manifest
+ * or LUA_EXEC_INSTRUCTION_BUDGET gives them an instruction budget. All clients
+ * must then handle LUA_IN_PROGRESS.
+ */
+static void load_exec_budget(struct lua_provider *lua_provider)
+{
+	uint32_t value = 0;
+
+	if (query_parameter("lua-exec-budget", &value) && value <= INT32_MAX)
+		lua_provider_set_exec_budget(lua_provider, (int)value);
+
+	IMSG("Lua instruction budget: %d", lua_provider->exec_budget);
+}
+
+#ifdef CFG_ENABLE_LUA_BINDINGS
+/*
+ * Bindings let scripts call other services without a Normal World round trip per
+ * operation. They are optional, a binding is skipped if its service can't be located.
+ */
+static void register_bindings(struct lua_provider *lua_provider)
+{
+	struct block_store *block_store = NULL;
+	struct storage_backend *storage_backend = NULL;
+	struct service_context *crypto_service_context = NULL;
+	struct rpc_caller_session *crypto_session = NULL;
+
+	service_locator_init();
+
+	block_store = client_block_store_factory_create(
+		"sn:ffa:63646e80-eb52-462f-ac4f-8cdf3987519c:0");
+	if (block_store && lua_provider_register_binding(lua_provider, "block_store",
+							 lua_block_store_binding_open,
+							 block_store))
+		IMSG("Lua block_store binding registered");
+	else
+		IMSG("Lua block_store binding not available");
+
+	crypto_service_context =
+		service_locator_query("sn:ffa:d9df52d5-16a2-4bb2-9aa4-d26d3b84e8c0:0");
+	if (crypto_service_context)
+		crypto_session = service_context_open(crypto_service_context);
+
+	if (crypto_session && psa_crypto_client_init(crypto_session) == PSA_SUCCESS &&
+	    psa_crypto_init() == PSA_SUCCESS &&
+	    lua_provider_register_binding(lua_provider, "psa", lua_psa_crypto_binding_open, NULL))
+		IMSG("Lua psa binding registered");
+	else
+		IMSG("Lua psa binding not available");
+
+	storage_backend = storage_factory_create(storage_factory_security_class_INTERNAL_TRUSTED);
+	if (storage_backend && lua_provider_register_binding(lua_provider, "storage",
+							     lua_secure_storage_binding_open,
+							     storage_backend))
+		IMSG("Lua storage binding registered");
+	else
+		IMSG("Lua storage binding not available");
+}
+#endif
+
 static bool sp_init(uint16_t *own_id)
 {
 	sp_result sp_res = SP_RESULT_INTERNAL_ERROR;
@@ -38,3 +38,38 @@ target_link_libraries(lua PRIVATE lua_static)
 target_sources(lua PRIVATE
 	${CMAKE_CURRENT_LIST_DIR}/lua_sp.c
 )
+
+#-------------------------------------------------------------------------------
+# Lua bindings for the block storage, crypto and secure storage services. Each
+# binding is registered if its service can be located when the SP boots.
+#
+#-------------------------------------------------------------------------------
+set(CFG_ENABLE_LUA_BINDINGS OFF CACHE BOOL "Enable Lua bindings for service clients")
+
+if (CFG_ENABLE_LUA_BINDINGS)
+	add_components(TARGET "lua"
+		BASE_DIR ${TS_ROOT}
+		COMPONENTS
+			"components/common/uuid"
+			"components/service/locator"
+			"components/service/locator/interface"
+			"components/service/locator/sp"
+			"components/service/locator/sp/ffa"
+			"components/service/block_storage/block_store"
+			"components/service/block_storage/block_store/client"
+			"components/service/block_storage/factory/client"
+			"components/service/crypto/include"
+			"components/service/crypto/client/psa"
+			"components/service/secure_storage/include"
+			"components/service/secure_storage/backend/null_store"
+			"components/service/secure_storage/backend/secure_storage_client"
+			"components/service/secure_storage/factory/sp/rot_store"
+			"components/service/lua/bindings/block_store"
+			"components/service/lua/bindings/psa_crypto"
+			"components/service/lua/bindings/secure_storage"
+	)
+
+	target_compile_definitions(lua PRIVATE
+		CFG_ENABLE_LUA_BINDINGS
+	)
+endif()
@@ -12,6 +12,7 @@ add_components(TARGET "lua"
 		components/service/common/include
 		components/service/common/client
 		components/service/common/provider
+		components/service/lua/bindings/bench
 		components/service/lua/provider
 		components/service/lua/provider/serializer/packed-c
 		protocols/rpc/common/packed-c
@@ -21,3 +22,108 @@ target_include_directories(lua PRIVATE
 	${TS_ROOT}
 	${TS_ROOT}/components
 )
+
+#-------------------------------------------------------------------------------
+#  QCBOR for encoding the values returned by scripts
+#
+#-------------------------------------------------------------------------------
+include(${TS_ROOT}/external/qcbor/qcbor.cmake)
+target_link_libraries(lua PRIVATE qcbor)
+
+#-------------------------------------------------------------------------------
+#  Lua provider options
+#
+#-------------------------------------------------------------------------------
+set(LUA_MAX_ENV_COUNT "256" CACHE STRING
+	"Maximum number of Lua environments that can exist at the same time")
+# The whole normal world is a single caller, as all its clients share one FF-A endpoint
+set(LUA_CALLER_MAX_ENV_COUNT "${LUA_MAX_ENV_COUNT}" CACHE STRING
+	"Maximum number of Lua environments of a single caller")
+set(LUA_CALLER_MAX_SCRIPT_BYTES "0" CACHE STRING
+	"Maximum size of the unexecuted scripts of a single caller in bytes, 0 for no limit")
+set(LUA_CALLER_MAX_MEMORY "0" CACHE STRING
+	"Maximum memory charged to a single caller in bytes, 0 for no limit")
+set(LUA_ENV_HEAP_SIZE "0" CACHE STRING
+	"Private heap size of each Lua environment in bytes, 0 to share one Lua state")
+set(LUA_BYTECODE_ENABLED "0" CACHE STRING
+	"Set to 1 to accept precompiled bytecode from clients, only safe if all clients are trusted")
+set(LUA_EXEC_INSTRUCTION_BUDGET "0" CACHE STRING
+	"Lua instructions run per execute or resume request, 0 to run scripts to completion")
+set(LUA_RUN_INSTRUCTION_BUDGET "1000000" CACHE STRING
+	"Lua instructions a script run by env_run may take, 0 to run scripts to completion")
+set(LUA_CHUNK_CACHE_BYTE_BUDGET "65536" CACHE STRING
+	"Size of the scripts kept by the compiled chunk cache in bytes, 0 to disable the cache")
+set(LUA_OUTPUT_TRACE "0" CACHE STRING
+	"Set to 1 to copy the output of Lua scripts to the trace log")
+set(LUA_GC_GENERATIONAL "0" CACHE STRING
+	"Set to 1 to run the Lua garbage collector in generational mode")
+set(LUA_GC_STEP_KB "0" CACHE STRING
+	"Lua garbage collection work done before each response in KiB, 0 to disable")
+
+target_compile_definitions(lua PRIVATE
+	LUA_MAX_ENV_COUNT=${LUA_MAX_ENV_COUNT}
+	LUA_CALLER_MAX_ENV_COUNT=${LUA_CALLER_MAX_ENV_COUNT}
+	LUA_CALLER_MAX_SCRIPT_BYTES=${LUA_CALLER_MAX_SCRIPT_BYTES}
+	LUA_CALLER_MAX_MEMORY=${LUA_CALLER_MAX_MEMORY}
+	LUA_ENV_HEAP_SIZE=${LUA_ENV_HEAP_SIZE}
+	LUA_BYTECODE_ENABLED=${LUA_BYTECODE_ENABLED}
+	LUA_EXEC_INSTRUCTION_BUDGET=${LUA_EXEC_INSTRUCTION_BUDGET}
+	LUA_RUN_INSTRUCTION_BUDGET=${LUA_RUN_INSTRUCTION_BUDGET}
+	LUA_CHUNK_CACHE_BYTE_BUDGET=${LUA_CHUNK_CACHE_BYTE_BUDGET}
+	LUA_OUTPUT_TRACE=${LUA_OUTPUT_TRACE}
+	LUA_GC_GENERATIONAL=${LUA_GC_GENERATIONAL}
+	LUA_GC_STEP_KB=${LUA_GC_STEP_KB}
+)
+
+#-------------------------------------------------------------------------------
+#  Lua modules built into the SP image
+#
+#  Each file is embedded into the generated lua_preload_modules.c and scripts
+#  load it with require("<file name without extension>"). The files may hold
+#  Lua source or bytecode produced by luac.
+#
+#-------------------------------------------------------------------------------
+set(LUA_PRELOAD_MODULES "" CACHE STRING "List of Lua module files to build into the SP")
+
+set(_preload_file "${CMAKE_CURRENT_BINARY_DIR}/lua_preload_modules.c")
+set(_preload_arrays "")
+set(_preload_entries "")
+set(_preload_index 0)
+
+foreach(_module IN LISTS LUA_PRELOAD_MODULES)
+	get_filename_component(_module_path "${_module}" ABSOLUTE)
+	get_filename_component(_module_name "${_module}" NAME_WE)
+
+	if (NOT EXISTS "${_module_path}")
+		message(FATAL_ERROR "Lua module ${_module_path} does not exist")
+	endif()
+
+	# Regenerate the list when a module changes
+	set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${_module_path}")
+
+	file(READ "${_module_path}" _module_hex HEX)
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," _module_bytes "${_module_hex}")
+
+	# The 0 terminator keeps the array valid C for an empty module, it isn't part of it
+	string(APPEND _preload_arrays
+		"static const uint8_t module_${_preload_index}[] = { ${_module_bytes}0x00 };\n")
+	string(APPEND _preload_entries
+		"\t{ \"${_module_name}\", module_${_preload_index}, sizeof(module_${_preload_index}) - 1 },\n")
+
+	math(EXPR _preload_index "${_preload_index} + 1")
+endforeach()
+
+file(CONFIGURE OUTPUT "${_preload_file}" CONTENT [=[
+/* Generated by lua.cmake from LUA_PRELOAD_MODULES, do not edit */
+
+#include <stdint.h>
+#include "components/service/lua/provider/lua_modules.h"
+
+@_preload_arrays@
+/* Terminated by an entry without a name */
+const struct lua_module lua_preload_modules[] = {
+@_preload_entries@	{ 0 }
+};
+]=] @ONLY)
+
+target_sources(lua PRIVATE "${_preload_file}")
@@ -0,0 +1,60 @@
+#-------------------------------------------------------------------------------
+# Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+#-------------------------------------------------------------------------------
+
+#-------------------------------------------------------------------------------
+#  The base build file shared between deployments of 'session-bench' for
+#  different environments.  Measures how the rate of service calls scales
+#  with the number of client threads, using a pool of RPC sessions or a
+#  single shared session.
+#-------------------------------------------------------------------------------
+
+#-------------------------------------------------------------------------------
+#  Use libts for locating and accessing services. An appropriate version of
+#  libts will be imported for the environment in which tests are
+#  deployed.
+#-------------------------------------------------------------------------------
+if (COVERAGE)
+	set(LIBTS_BUILD_TYPE "DEBUGCOVERAGE" CACHE STRING "Libts build type" FORCE)
+endif()
+
+include(${TS_ROOT}/deployments/libts/libts-import.cmake)
+target_link_libraries(session-bench PRIVATE libts::ts)
+
+#-------------------------------------------------------------------------------
+#  The benchmark calls the service from several threads
+#
+#-------------------------------------------------------------------------------
+find_package(Threads REQUIRED)
+target_link_libraries(session-bench PRIVATE Threads::Threads)
+
+#-------------------------------------------------------------------------------
+#  Common main for all deployments
+#
+#-------------------------------------------------------------------------------
+target_sources(session-bench PRIVATE
+	"${CMAKE_CURRENT_LIST_DIR}/session-bench.cpp"
+)
+
+#-------------------------------------------------------------------------------
+#  Components that are common across all deployments
+#
+#-------------------------------------------------------------------------------
+add_components(
+	TARGET "session-bench"
+	BASE_DIR ${TS_ROOT}
+	COMPONENTS
+		"components/common/tlv"
+)
+
+#-------------------------------------------------------------------------------
+#  Define install content.
+#
+#-------------------------------------------------------------------------------
+if (CMAKE_INSTALL_PREFIX_INITIALIZED_TO_DEFAULT)
+	set(CMAKE_INSTALL_PREFIX ${CMAKE_BINARY_DIR}/install CACHE PATH "location to install build output to." FORCE)
+endif()
+install(TARGETS session-bench RUNTIME DESTINATION ${TS_ENV}/bin)
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/tlv/tlv.h"
+#include "protocols/service/crypto/packed-c/generate_random.h"
+#include "protocols/service/crypto/packed-c/opcodes.h"
+#include "rpc_caller_session.h"
+#include "service_locator.h"
+#include "service_session_pool.h"
+
+/*
+ * Measures how the rate of calls to a service scales with the number of client threads.
+ * Each thread calls generate_random of the crypto service in a loop. In the shared mode all
+ * threads take turns on a single RPC session behind a mutex. In the pool mode each call runs
+ * on a session acquired from a service_session_pool, so calls of different threads only
+ * contend where the service itself serializes them. Results are written to stdout as JSON or
+ * CSV.
+ */
+
+using bench_clock = std::chrono::steady_clock;
+
+struct bench_options {
+	std::vector<size_t> thread_counts { 1, 2, 4, 8 };
+	size_t num_sessions = 0;
+	size_t random_size = 32;
+	double duration_s = 2.0;
+	bool csv = false;
+};
+
+static std::vector<size_t> parse_list(const char *arg)
+{
+	std::vector<size_t> values;
+	std::stringstream ss(arg);
+	std::string item;
+
+	while (std::getline(ss, item, ',')) {
+		size_t value = std::strtoul(item.c_str(), NULL, 0);
+
+		if (value)
+			values.push_back(value);
+	}
+
+	return values;
+}
+
+static void print_usage(const char *name)
+{
+	std::cerr << "Usage: " << name << " [options]\n"
+		  << "  --threads LIST        thread counts (1,2,4,8)\n"
+		  << "  --sessions N          sessions of the pool, 0 for one per thread (0)\n"
+		  << "  --random-size N       bytes requested by each call (32)\n"
+		  << "  --duration SECONDS    duration of each run (2)\n"
+		  << "  --format json|csv     output format (json)\n";
+}
+
+static bool parse_options(int argc, char *argv[], struct bench_options *options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string opt = argv[i];
+
+		if (opt == "--help" || i + 1 >= argc)
+			return false;
+
+		const char *value = argv[++i];
+
+		if (opt == "--threads")
+			options->thread_counts = parse_list(value);
+		else if (opt == "--sessions")
+			options->num_sessions = std::strtoul(value, NULL, 0);
+		else if (opt == "--random-size")
+			options->random_size = std::strtoul(value, NULL, 0);
+		else if (opt == "--duration")
+			options->duration_s = std::strtod(value, NULL);
+		else if (opt == "--format" && (!std::strcmp(value, "json") ||
+					       !std::strcmp(value, "csv")))
+			options->csv = !std::strcmp(value, "csv");
+		else
+			return false;
+	}
+
+	return !options->thread_counts.empty() && options->random_size &&
+	       options->duration_s > 0;
+}
+
+class bench_output {
+public:
+	bench_output(bool csv) :
+		m_csv(csv),
+		m_first(true)
+	{
+		if (m_csv)
+			std::cout << "mode,threads,sessions,calls,seconds,calls_per_sec" << std::endl;
+		else
+			std::cout << "[" << std::endl;
+	}
+
+	~bench_output()
+	{
+		if (!m_csv)
+			std::cout << std::endl << "]" << std::endl;
+	}
+
+	void result(const char *mode, size_t threads, size_t sessions, size_t calls,
+		    double seconds)
+	{
+		double rate = calls / seconds;
+
+		if (m_csv) {
+			std::cout << mode << "," << threads << "," << sessions << "," << calls <<
+				     "," << seconds << "," << rate << std::endl;
+			return;
+		}
+
+		if (!m_first)
+			std::cout << "," << std::endl;
+		m_first = false;
+
+		std::cout << "  {\"mode\": \"" << mode << "\", \"threads\": " << threads <<
+			     ", \"sessions\": " << sessions << ", \"calls\": " << calls <<
+			     ", \"seconds\": " << seconds << ", \"calls_per_sec\": " << rate << "}";
+	}
+
+private:
+	bool m_csv;
+	bool m_first;
+};
+
+static bool generate_random(struct rpc_caller_session *session, size_t size)
+{
+	struct ts_crypto_generate_random_in req_msg = { };
+	uint8_t *req_buf = NULL;
+	uint8_t *resp_buf = NULL;
+	size_t resp_len = 0;
+	service_status_t service_status = 0;
+	rpc_status_t rpc_status = RPC_ERROR_INTERNAL;
+	rpc_call_handle handle = NULL;
+
+	handle = rpc_caller_session_begin(session, &req_buf, sizeof(req_msg),
+					  tlv_required_space(size));
+	if (!handle)
+		return false;
+
+	req_msg.size = size;
+	memcpy(req_buf, &req_msg, sizeof(req_msg));
+
+	rpc_status = rpc_caller_session_invoke(handle, TS_CRYPTO_OPCODE_GENERATE_RANDOM,
+					       &resp_buf, &resp_len, &service_status);
+
+	rpc_caller_session_end(handle);
+
+	return rpc_status == RPC_SUCCESS && service_status == 0;
+}
+
+/*
+ * Runs thread_count threads that make calls until the deadline, call_fn makes a single call.
+ * Returns the number of calls made or 0 if any of them failed.
+ */
+template<typename call_fn_t>
+static size_t run_threads(size_t thread_count, const struct bench_options &options,
+			  call_fn_t call_fn, double *seconds)
+{
+	std::vector<size_t> counts(thread_count, 0);
+	std::vector<std::thread> threads;
+	std::atomic<bool> failed(false);
+
+	bench_clock::time_point start = bench_clock::now();
+	bench_clock::time_point deadline = start + std::chrono::duration_cast<bench_clock::duration>(
+		std::chrono::duration<double>(options.duration_s));
+
+	for (size_t i = 0; i < thread_count; i++)
+		threads.emplace_back([&, i]() {
+			while (bench_clock::now() < deadline && !failed.load()) {
+				if (!call_fn()) {
+					failed.store(true);
+					break;
+				}
+
+				counts[i]++;
+			}
+		});
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	*seconds = std::chrono::duration<double>(bench_clock::now() - start).count();
+
+	if (failed.load()) {
+		std::cerr << "generate_random failed" << std::endl;
+		return 0;
+	}
+
+	size_t total = 0;
+
+	for (size_t count : counts)
+		total += count;
+
+	return total;
+}
+
+/* All threads share one session, the way a client without a pool has to call */
+static bool run_shared(struct service_context *service_context, const struct bench_options &options,
+		       size_t thread_count, bench_output &output)
+{
+	struct rpc_caller_session *session = service_context_open(service_context);
+	std::mutex session_mutex;
+	double seconds = 0;
+
+	if (!session) {
+		std::cerr << "Failed to open RPC session" << std::endl;
+		return false;
+	}
+
+	size_t calls = run_threads(thread_count, options, [&]() {
+		std::lock_guard<std::mutex> lock(session_mutex);
+
+		return generate_random(session, options.random_size);
+	}, &seconds);
+
+	service_context_close(service_context, session);
+
+	if (calls)
+		output.result("shared", thread_count, 1, calls, seconds);
+
+	return calls != 0;
+}
+
+/* Every call acquires a session from the pool and releases it afterwards */
+static bool run_pool(struct service_context *service_context, const struct bench_options &options,
+		     size_t thread_count, bench_output &output)
+{
+	size_t num_sessions = options.num_sessions ? options.num_sessions : thread_count;
+	struct service_session_pool *pool = service_session_pool_create(service_context,
+									 num_sessions);
+	double seconds = 0;
+
+	if (!pool) {
+		std::cerr << "Failed to create a pool of " << num_sessions << " sessions" << std::endl;
+		return false;
+	}
+
+	size_t calls = run_threads(thread_count, options, [&]() {
+		struct rpc_caller_session *session = service_session_pool_acquire(pool);
+		bool success = generate_random(session, options.random_size);
+
+		service_session_pool_release(pool, session);
+
+		return success;
+	}, &seconds);
+
+	service_session_pool_destroy(pool);
+
+	if (calls)
+		output.result("pool", thread_count, num_sessions, calls, seconds);
+
+	return calls != 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_options options;
+
+	if (!parse_options(argc, argv, &options)) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	service_locator_init();
+
+	struct service_context *service_context =
+		service_locator_query("sn:trustedfirmware.org:crypto:0");
+	if (!service_context) {
+		std::cerr << "Failed to locate crypto service." << std::endl;
+		return 1;
+	}
+
+	bool success = true;
+
+	{
+		bench_output output(options.csv);
+
+		for (size_t thread_count : options.thread_counts) {
+			success &= run_shared(service_context, options, thread_count, output);
+			success &= run_pool(service_context, options, thread_count, output);
+		}
+	}
+
+	service_context_relinquish(service_context);
+
+	return success ? 0 : 1;
+}
@@ -50,6 +50,18 @@ if(TARGET openlibm)
 	unset_saved_properties(OPENLIBM)
 endif()
 
+# The clock(), time() and stdio stubs added to luaconf.h are only needed in SP
+# environments. Hosted environments (e.g. a client compiling scripts to bytecode)
+# get these from libc, so disable the stubs for both Lua and its users.
+if ((TS_ENV STREQUAL "linux-pc") OR (TS_ENV STREQUAL "arm-linux"))
+	include(${TS_ROOT}/tools/cmake/common/PropertyCopy.cmake)
+
+	set(_lua_hosted_defs CLOCK_DEFINED TIME_DEFINED IO_DEFINED)
+	translate_value_as_property(VALUE "${_lua_hosted_defs}"
+		PROPERTY INTERFACE_COMPILE_DEFINITIONS
+		RES _lua_hosted_fragment)
+endif()
+
 include(${TS_ROOT}/tools/cmake/common/LazyFetch.cmake REQUIRED)
 LazyFetch_MakeAvailable(DEP_NAME lua
 	FETCH_OPTIONS "${GIT_OPTIONS}"
@@ -59,6 +71,7 @@ LazyFetch_MakeAvailable(DEP_NAME lua
 )
 unset(_libc_fragment)
 unset(_openlibm_fragment)
+unset(_lua_hosted_fragment)
 
 
 # Create an imported target to abstract the build system.
@@ -71,4 +84,9 @@ endif()
 if(TARGET openlibm)
     target_link_libraries(lua_static INTERFACE openlibm)
 endif()
+if(_lua_hosted_defs)
+	set_property(TARGET lua_static PROPERTY INTERFACE_COMPILE_DEFINITIONS ${_lua_hosted_defs})
+	target_link_libraries(lua_static INTERFACE m)
+	unset(_lua_hosted_defs)
+endif()
 set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${LUA_INSTALL_DIR}/lib/${CMAKE_STATIC_LIBRARY_PREFIX}lua_static${CMAKE_STATIC_LIBRARY_SUFFIX}")
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2025, Arm Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef PROTOCOLS_RPC_COMMON_BATCH_H
+#define PROTOCOLS_RPC_COMMON_BATCH_H
+
+#include <stdint.h>
+
+/*
+ * Defines a batch envelope that carries several independent requests to the
+ * same service in a single RPC call.  Every service built on service_provider
+ * handles the batch opcode.  The sub-requests are dispatched in order, as if
+ * they had been called one by one, and their responses are packed into the
+ * response of the batch call.
+ *
+ * Request:  ts_rpc_batch_hdr, then count times ts_rpc_batch_req_entry
+ *           followed by the request parameters of the sub-request.
+ * Response: ts_rpc_batch_hdr, then count times ts_rpc_batch_resp_entry
+ *           followed by the response parameters of the sub-request.
+ *
+ * Every entry starts at a multiple of TS_RPC_BATCH_ALIGNMENT bytes from the
+ * start of the buffer, the parameters are padded accordingly.  Batches can't
+ * be nested.
+ */
+#define TS_RPC_OPCODE_BATCH         (0xffffu)
+
+/*
+ * Opcodes from TS_RPC_OPCODE_RESERVED_BASE up are reserved for operations that
+ * service_provider handles for every service, such as TS_RPC_OPCODE_BATCH.
+ * Services can't define handlers for them.
+ */
+#define TS_RPC_OPCODE_RESERVED_BASE (0xff00u)
+
+#define TS_RPC_BATCH_ALIGNMENT      (8u)
+
+struct __attribute__ ((__packed__)) ts_rpc_batch_hdr
+{
+    /*
+     * The number of entries that follow.  The response may hold fewer entries
+     * than the request if the response buffer filled up, the remaining
+     * sub-requests were not dispatched.
+     */
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct __attribute__ ((__packed__)) ts_rpc_batch_req_entry
+{
+    /*
+     * Identifies the requested operation of the service.
+     */
+    uint16_t opcode;
+    uint16_t reserved;
+
+    /*
+     * Specifies the length in bytes of the request parameters.
+     */
+    uint32_t param_len;
+};
+
+struct __attribute__ ((__packed__)) ts_rpc_batch_resp_entry
+{
+    /*
+     * Returns the RPC layer status of the sub-request.  Only if it is
+     * RPC_SUCCESS should the service status and parameters be considered.
+     */
+    int32_t rpc_status;
+
+    /*
+     * Specifies the length in bytes of the response parameters.
+     */
+    uint32_t param_len;
+
+    /*
+     * Returns the service specific status of the sub-request.
+     */
+    int64_t service_status;
+};
+
+#endif /* PROTOCOLS_RPC_COMMON_BATCH_H */
@@ -13,7 +13,17 @@
  * \brief env_create operation
  *
  * Create a new Lua environment for script isolation.
- * On success env_index is an index identifying the new environment.
+ * On success env_index is a handle identifying the new environment, which is
+ * passed as env_index to the other operations. Handles are not indices, they
+ * carry a generation count so that the handle of a deleted environment isn't
+ * accepted for a new environment that reuses its slot. Handles are never
+ * negative.
+ * An environment belongs to the caller that created it, identified by its FF-A
+ * source ID. Other callers get LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST for it.
+ * All normal world clients share the source ID of the normal world, so they
+ * can use each other's environments and share one quota.
+ * Creating or cloning more environments or appending more script than the
+ * caller's quota allows fails with LUA_ERROR_QUOTA_EXCEEDED.
  * On failure env_index will be -1.
  ****************************************/
 
@@ -21,6 +31,30 @@ struct __attribute__((__packed__)) ts_lua_env_create_out {
     int32_t env_index;
 };
 
+/****************************************
+ * \brief env_clone operation
+ *
+ * Create a new Lua environment that inherits the globals of a template
+ * environment, typically one that executed a prelude defining helpers.
+ * Globals missing in the new environment are looked up in the template, and
+ * assignments land in the new environment. Tables are copied into the new
+ * environment, including the tables nested in them, when the new environment
+ * first uses them, so changing them doesn't affect the template or other
+ * clones. Tables nested deeper than 16 levels can't be copied and fail the
+ * script using them. The response is the same as for env_create.
+ * The template is frozen by its first clone: appending to or executing it
+ * fails with LUA_ERROR_ENVIRONMENT_FROZEN and functions defined by the
+ * template can't create globals in it. These functions keep using the
+ * globals of the template, so their assignments to existing globals and the
+ * tables they change are visible to all clones. A template with a
+ * suspended script fails with LUA_ERROR_ENVIRONMENT_BUSY. Environments with a
+ * private heap can't be cloned.
+ ****************************************/
+
+struct __attribute__((__packed__)) ts_lua_env_clone_in {
+    int32_t template_index;
+};
+
 /****************************************
  * \brief env_append operation
  *
@@ -31,22 +65,146 @@ struct __attribute__((__packed__)) ts_lua_env_append_in {
     int32_t env_index;
 };
 
+/****************************************
+ * \brief env_append_bytecode operation
+ *
+ * Append precompiled Lua bytecode, as produced by lua_dump, to the specified
+ * environment's script buffer. The first chunk must start with a bytecode header
+ * matching the provider's Lua version and number formats. An environment's script
+ * buffer holds either source or bytecode, never both. Bytecode is loaded in binary
+ * only mode by env_execute. Providers reject all bytecode with
+ * LUA_ERROR_INVALID_BYTECODE unless they are built with LUA_BYTECODE_ENABLED.
+ ****************************************/
+struct __attribute__((__packed__)) ts_lua_env_append_bytecode_in {
+    int32_t env_index;
+};
+
 /****************************************
  * \brief env_execute operation
  *
  * Call Lua's parser & interpreter on the environment's script buffer.
  * The return value of the parser or interpreter (if parser succeeds) will be in service_status.
  * In case of error the error message will be returned in the payload.
+ * When the script finishes, the values it returned are encoded in the payload as a
+ * CBOR array. The payload is empty if the script returned no values. Values
+ * without a CBOR counterpart, such as functions, are encoded as null. Results
+ * that exceed the encoder's limits fail with LUA_ERROR_UNSUPPORTED_RESULT,
+ * results that don't fit in the response with LUA_ERROR_BUFFER_TOO_SMALL.
+ * Providers configured with an instruction budget run the script in slices of a
+ * limited number of instructions, by default it runs to completion. If the script
+ * is suspended at the end of a slice service_status is LUA_IN_PROGRESS and the
+ * script must be continued by env_resume. Executing a new script while one is
+ * suspended fails with LUA_ERROR_ENVIRONMENT_BUSY.
+ * Data following the fixed size message is input for the script, which it reads
+ * through buffer.request() without copying while this request is processed.
  ****************************************/
 
 struct __attribute__((__packed__)) ts_lua_env_execute_in {
     int32_t env_index;
 };
 
+/****************************************
+ * \brief env_resume operation
+ *
+ * Continue the script suspended in the specified environment for another slice.
+ * The response is the same as for env_execute. Resuming an environment without a
+ * suspended script succeeds without doing anything. Input for the script may follow
+ * the fixed size message as for env_execute.
+ ****************************************/
+
+struct __attribute__((__packed__)) ts_lua_env_resume_in {
+    int32_t env_index;
+};
+
+/****************************************
+ * \brief env_run operation
+ *
+ * Execute the script carried in the request payload in a temporary environment
+ * that is deleted afterwards. Combines env_create, env_append, env_execute and
+ * env_delete in a single call, so the script must fit in one request. The temporary
+ * environment counts against the caller's quota. The response is the same as for
+ * env_execute, except that the script can't be resumed: a script that doesn't finish
+ * within its instruction budget fails with LUA_ERROR_BUDGET_EXCEEDED. The output of
+ * the script is sent to the provider's trace log.
+ ****************************************/
+
+/* Payload is bytecode (lua_dump output) instead of source, see env_append_bytecode */
+#define TS_LUA_ENV_RUN_FLAG_BYTECODE (1u << 0)
+
+struct __attribute__((__packed__)) ts_lua_env_run_in {
+    uint32_t flags;
+};
+
+/****************************************
+ * \brief env_read_output operation
+ *
+ * Read and consume the output printed by scripts of the specified environment.
+ * The output is returned in the payload, as much as fits into the response.
+ * remaining_len is the length of the output left to read. lost_len is the length
+ * of output that was overwritten since the previous read because the
+ * environment's output buffer was full.
+ ****************************************/
+
+struct __attribute__((__packed__)) ts_lua_env_read_output_in {
+    int32_t env_index;
+};
+
+struct __attribute__((__packed__)) ts_lua_env_read_output_out {
+    uint32_t remaining_len;
+    uint32_t lost_len;
+};
+
+/****************************************
+ * \brief env_profile_result operation
+ *
+ * Return the profile of the specified environment's scripts sampled since the
+ * previous call, then set the sampling interval for later slices of its
+ * scripts. A non-zero sample_interval enables profiling, a sample of the call
+ * stack is taken every sample_interval VM instructions. Zero disables it and
+ * discards the profile. The payload is the profile encoded like the results
+ * of env_execute, a CBOR array holding a single map, see lua_profiler.h. It is
+ * empty if profiling wasn't enabled. If the profile doesn't
+ * fit in the response LUA_ERROR_BUFFER_TOO_SMALL is returned and neither the
+ * profile nor the interval is changed.
+ ****************************************/
+
+struct __attribute__((__packed__)) ts_lua_env_profile_result_in {
+    int32_t env_index;
+    uint32_t sample_interval;
+};
+
+/****************************************
+ * \brief env_stats operation
+ *
+ * Return the execution metrics of the specified environment, accumulated over
+ * all the scripts it ran. Times are in ticks of a counter running at
+ * tick_frequency ticks per second. Parsing time excludes scripts served from
+ * the compiled chunk cache. Instructions are counted in steps of the
+ * provider's hook period. Memory is counted in bytes of the environment's Lua
+ * state; for environments sharing the provider's state peak_memory is the peak
+ * of the shared state while the environment's scripts ran.
+ ****************************************/
+
+struct __attribute__((__packed__)) ts_lua_env_stats_in {
+    int32_t env_index;
+};
+
+struct __attribute__((__packed__)) ts_lua_env_stats_out {
+    uint64_t tick_frequency;
+    uint64_t parse_ticks;
+    uint64_t exec_ticks;
+    uint64_t instructions;
+    uint64_t bytes_allocated;
+    uint64_t peak_memory;
+    uint64_t gc_cycles;
+    uint32_t execute_count;
+    uint32_t slice_count;
+};
+
 /****************************************
  * \brief env_delete operation
  *
- * Delete the specified Lua environment.
+ * Delete the specified Lua environment. A suspended script is abandoned.
  ****************************************/
 
 struct __attribute__((__packed__)) ts_lua_env_delete_in {
@@ -59,5 +217,12 @@ struct __attribute__((__packed__)) ts_lua_env_delete_in {
 #define TS_LUA_OPCODE_ENV_APPEND    (TS_LUA_OPCODE_BASE + 1u)
 #define TS_LUA_OPCODE_ENV_EXECUTE   (TS_LUA_OPCODE_BASE + 2u)
 #define TS_LUA_OPCODE_ENV_DELETE    (TS_LUA_OPCODE_BASE + 3u)
+#define TS_LUA_OPCODE_ENV_APPEND_BYTECODE (TS_LUA_OPCODE_BASE + 4u)
+#define TS_LUA_OPCODE_ENV_RUN       (TS_LUA_OPCODE_BASE + 5u)
+#define TS_LUA_OPCODE_ENV_RESUME    (TS_LUA_OPCODE_BASE + 6u)
+#define TS_LUA_OPCODE_ENV_READ_OUTPUT (TS_LUA_OPCODE_BASE + 7u)
+#define TS_LUA_OPCODE_ENV_CLONE     (TS_LUA_OPCODE_BASE + 8u)
+#define TS_LUA_OPCODE_ENV_PROFILE_RESULT (TS_LUA_OPCODE_BASE + 9u)
+#define TS_LUA_OPCODE_ENV_STATS     (TS_LUA_OPCODE_BASE + 10u)
 
 #endif /* TS_LUA_PACKEDC_MESSAGES_H */
@@ -16,6 +16,7 @@ extern "C" {
 typedef int32_t lua_status_t;
 
 #define LUA_SUCCESS			                 ((lua_status_t) 0)
+#define LUA_IN_PROGRESS                      ((lua_status_t) 1)
 #define LUA_ERROR_GENERIC_ERROR              ((lua_status_t)-1)
 #define LUA_ERROR_OUT_OF_FREE_ENVIRONMENTS   ((lua_status_t)-2)
 #define LUA_ERROR_ENVIRONMENT_DOES_NOT_EXIST ((lua_status_t)-3)
@@ -23,6 +24,12 @@ typedef int32_t lua_status_t;
 #define LUA_ERROR_BUFFER_TOO_SMALL           ((lua_status_t)-5)
 #define LUA_ERROR_PARSER_ERROR               ((lua_status_t)-6)
 #define LUA_ERROR_INTERPRETER_ERROR          ((lua_status_t)-7)
+#define LUA_ERROR_INVALID_BYTECODE           ((lua_status_t)-8)
+#define LUA_ERROR_ENVIRONMENT_BUSY           ((lua_status_t)-9)
+#define LUA_ERROR_UNSUPPORTED_RESULT         ((lua_status_t)-10)
+#define LUA_ERROR_ENVIRONMENT_FROZEN         ((lua_status_t)-11)
+#define LUA_ERROR_QUOTA_EXCEEDED             ((lua_status_t)-12)
+#define LUA_ERROR_BUDGET_EXCEEDED            ((lua_status_t)-13)
 
 #ifdef __cplusplus
 }